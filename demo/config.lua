@@ -49,7 +49,9 @@ Cfg = {
                 timer      = 1000,
                 gridcell   = 20000,
                 property   = 5000,
-                collision  = 1000
+                collision  = 1000,
+                emitter    = 100,
+                stepparams = 1000
         },
         
         -- Distance around shape to check for simultaneous collisions.
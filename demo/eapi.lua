@@ -6,6 +6,12 @@
 -- meant to be called/accessed by user scripts) begin with two underscores.
 --
 
+--
+-- Functions and user arguments handed to the engine (step functions, timers,
+-- collision and input handlers) are stored here under integer IDs. The engine
+-- keeps a reference to this table and looks callbacks up directly, appending
+-- saved user arguments to the ones it supplies.
+--
 eapi.idToObjectMap = {}
 local lastID = 0
 
@@ -82,7 +88,11 @@ function eapi.Clear()
         input.UnbindAll()
         
         -- Clear client-side (script) state.
-        eapi.idToObjectMap = {}
+        -- The engine holds on to eapi.idToObjectMap, so empty it in place.
+        local idToObjectMap = eapi.idToObjectMap
+        for ID in pairs(idToObjectMap) do
+                idToObjectMap[ID] = nil
+        end
         lastID = 0
 end
 
@@ -148,12 +158,7 @@ function eapi.SetStepC(obj, stepFunc, ...)
         if argID ~= 0 then
                 eapi.idToObjectMap[argID] = nil
         end
-        
-        stepFuncID = nil
-        if stepFunc then
-                stepFuncID = GenID(stepFunc)
-        end
-        eapi.__SetStepC(obj, stepFuncID, GenArgID(arg))
+        eapi.__SetStepC(obj, stepFunc, ...)
 end
 
 --
@@ -276,41 +281,3 @@ function eapi.Collide(world, groupA, groupB, func, upd, priority, ...)
         eapi.__Collide(world, groupA, groupB, GenID(func), upd, priority,
                        GenArgID(arg))
 end
-
---
--- Whenever it's necessary to invoke a function if only its ID in the
--- `eapi.idToObjectMap` table is known, the engine calls eapi.__CallFunc() with
--- the function ID as argument.
---
--- funcID       ID that maps to a Lua function.
--- argID        ID of extra arguments that must be
---              looked up in `eapi.idToObjectMap`.
---              Zero means that there are no saved user arguments.
--- remove       Remove function from the eapi.idToObjectMap table once the
---              function has finished.
---
-function eapi.__CallFunc(funcID, argID, remove, ...)
-        local idToObjectMap = eapi.idToObjectMap
-        local func = idToObjectMap[funcID]
-        if argID == 0 then
-                if remove then
-                        idToObjectMap[funcID] = nil
-                end
-                return func(unpack(arg))
-        end
-        
-        local savedArgs = eapi.idToObjectMap[argID]
-        if remove then
-                idToObjectMap[funcID] = nil
-                idToObjectMap[argID] = nil
-        end
-        
-        -- Append `savedArgs` to `arg` because we cannot unpack() both in one
-        -- function call. (Doing `func(unpack(arg), unpack(savedArgs))` does not
-        -- work!).
-        local sz = #arg
-        for i, v in ipairs(savedArgs) do
-                arg[sz + i] = v
-        end
-        return func(unpack(arg))
-end
@@ -3,6 +3,9 @@
 
 /* Feature switches. */
 #define ENABLE_LUA              1
+#ifndef ENABLE_LUAJIT
+#define ENABLE_LUAJIT           0       /* Set by `make LUAJIT=1`. */
+#endif
 #define ENABLE_SQLITE           0
 #define ENABLE_SDL_VIDEO        1
 #define ENABLE_SDL2             0
@@ -20,13 +23,12 @@
 #define VISIBLE_TILES_MAX       4000
 #define GRID_VISITED_MAX        5000
 #define SHAPEGROUPS_MAX         20
-#define ACTIVE_BODIES_MAX       4000
-#define ACTIVE_SHAPES_MAX       4000
 #define ACTIVE_TILES_MAX        4000
 
 /*
  * If true, bodies do not go to sleep once they leave camera vicinity. All
- * bodies are always active.
+ * bodies are always active. This is only the default for new worlds; sleeping
+ * can be switched per world at runtime with eapi.AllowSleep().
  */
 #define ALL_NOCTURNAL 1
 
@@ -12,6 +12,7 @@ Cfg = {
 	windowWidth	= 800,
 	windowHeight	= 480,
 	screenBPP	= 0,
+	memoryOverlay	= false,	-- Show memory pool usage on screen.
 	
 	-- Sound.
 	channels	= 16,
@@ -47,7 +48,11 @@ Cfg = {
 		Skip = "Space",
 	},
 
-        -- Engine config.
+        -- Engine config. Pools start out with `poolsize` records and grow
+        -- by as many when they run out; `pooltrim` releases the extra memory
+        -- again when a world is destroyed.
+        pooltrim = true,
+        poolreport = false,     -- Print pool usage on exit (--pool-report).
         poolsize = {
                 world      = 12,
                 body       = 4000,
@@ -62,10 +67,20 @@ Cfg = {
                 timer      = 4000,
                 gridcell   = 50000,
                 property   = 20000,
-                collision  = 1000
+                collision  = 1000,
+                emitter    = 100,
+                stepparams = 1000
         },
         collision_dist = 1,
-        cam_vicinity_factor = 0.5
+        cam_vicinity_factor = 0.5,
+
+        -- Decoded images are kept in this file so that they need not be
+        -- decoded again on the next run. Remove to disable.
+        texcache = "texture.cache",
+
+        -- Textures and sounds used by each scene are listed in this file so
+        -- that they can be preloaded on the next run. Remove to disable.
+        manifest = "manifest.txt"
 }
 
 return Cfg
@@ -8,6 +8,12 @@
 
 require("input")
 
+--
+-- Functions and user arguments handed to the engine (step functions, timers,
+-- collision and input handlers) are stored here under integer IDs. The engine
+-- keeps a reference to this table and looks callbacks up directly, appending
+-- saved user arguments to the ones it supplies.
+--
 eapi.idToObjectMap = {}
 local lastID = 0
 
@@ -23,8 +29,22 @@ local lastID = 0
 --
 
 --
--- Predefined C step functions:
+-- Predefined C step functions (parameters follow the function in SetStepC):
 --      eapi.STEPFUNC_STD
+--      eapi.STEPFUNC_ROT       dvel, ivel=0, mult=1
+--      eapi.STEPFUNC_HOMING    target, turnRate, speed=0
+--      eapi.STEPFUNC_SINE      amplitude, frequency, phase=0
+--      eapi.STEPFUNC_ORBIT     angvel, radius=nil
+--      eapi.STEPFUNC_DRAG      k
+--      eapi.STEPFUNC_CHASE     lag, target=nil, offset=nil
+--
+
+--
+-- Emitter pattern presets (see NewEmitter in eapi_Lua.c):
+--      eapi.EMITTER_RING
+--      eapi.EMITTER_SPIRAL
+--      eapi.EMITTER_SPREAD
+--      eapi.EMITTER_WAVE
 --
 
 --
@@ -57,7 +77,11 @@ function eapi.Clear()
         eapi.__Clear()
         
         -- Clear client-side (script) state.
-        eapi.idToObjectMap = {}
+        -- The engine holds on to eapi.idToObjectMap, so empty it in place.
+        local idToObjectMap = eapi.idToObjectMap
+        for ID in pairs(idToObjectMap) do
+                idToObjectMap[ID] = nil
+        end
         lastID = 0
 end
 
@@ -78,12 +102,13 @@ function eapi.SetStep(obj, stepFunc, ...)
         if stepFunc then
                 stepFuncID = GenID(stepFunc)
         end
-        eapi.__SetStep(obj, stepFuncID, GenArgID(arg))
+        eapi.__SetStep(obj, stepFuncID, GenArgID({ ... }))
 end
 
 --
 -- Set an object's step function. Unlike SetStep(), `stepFunc` must not refer to
--- a Lua function but should be a C function pointer instead.
+-- a Lua function but should be a C function pointer instead. Step function
+-- parameters are passed on to the engine, which keeps them on the C side.
 --
 function eapi.SetStepC(obj, stepFunc, ...)
         -- Remove previous user args from eapi.idToObjectMap.
@@ -91,7 +116,7 @@ function eapi.SetStepC(obj, stepFunc, ...)
         if argID ~= 0 and eapi.idToObjectMap[argID] then
                 eapi.idToObjectMap[argID] = nil
         end
-        eapi.__SetStepC(obj, stepFunc, GenArgID(arg))
+        eapi.__SetStepC(obj, stepFunc, ...)
 end
 
 --
@@ -105,7 +130,54 @@ end
 -- func         Timer function.
 --
 function eapi.AddTimer(obj, when, func, ...)
-        return eapi.__AddTimer(obj, when, GenID(func), GenArgID(arg))
+        return eapi.__AddTimer(obj, when, GenID(func), GenArgID({ ... }))
+end
+
+--
+-- Run `func(obj, ...)` as a coroutine bound to object `obj` (World, Camera,
+-- or Body). Within it, eapi.Wait(seconds) and eapi.WaitSteps(n) suspend the
+-- task until the time comes, without allocating a timer each time. The task
+-- stops when its body is destroyed; eapi.CancelTimer() on the returned value
+-- stops it earlier.
+--
+function eapi.Spawn(obj, func, ...)
+        return eapi.__Spawn(obj, GenID(coroutine.create(func)),
+                            GenArgID({ ... }))
+end
+
+--
+-- Cull transient bodies (see eapi.SetTransient()) once they leave an area.
+--
+-- world        World object.
+-- area         Bounding box {l=?,r=?,b=?,t=?} in world coordinates, or a
+--              camera (bodies must stay near its view). Pass `nil` to turn
+--              culling off.
+-- margin       How far outside the area bodies may go before they are culled.
+-- recycle      If true, culled bodies are recycled (see eapi.Recycle()) rather
+--              than destroyed.
+-- func         Optional function called once per step with an array of the
+--              bodies culled in that step. They are already gone, so use them
+--              for bookkeeping only.
+--
+function eapi.SetBounds(world, area, margin, recycle, func, ...)
+        local oldFuncID, oldArgID = eapi.__GetBounds(world)
+        
+        -- Without an area culling is off and the callback is not kept.
+        local funcID, argID = 0, 0
+        if area and func then
+                funcID = GenID(func)
+                argID = GenArgID({ ... })
+        end
+        eapi.__SetBounds(world, area, margin or 0, recycle or false, funcID,
+                         argID)
+        
+        -- Remove previous callback from eapi.idToObjectMap.
+        if oldFuncID ~= 0 then
+                eapi.idToObjectMap[oldFuncID] = nil
+        end
+        if oldArgID ~= 0 then
+                eapi.idToObjectMap[oldArgID] = nil
+        end
 end
 
 --
@@ -126,7 +198,7 @@ end
 --      eapi.GetKeyFromName(scancodeName)
 --
 function eapi.BindKeyboard(func, ...)
-        eapi.__BindKeyboard(GenID(func), GenArgID(arg))
+        eapi.__BindKeyboard(GenID(func), GenArgID({ ... }))
 end
 
 --
@@ -135,7 +207,7 @@ end
 --      JoyButton(joystickID, buttonID, pressed)
 --
 function eapi.BindJoystickButton(func, ...)
-        eapi.__BindJoystickButton(GenID(func), GenArgID(arg))
+        eapi.__BindJoystickButton(GenID(func), GenArgID({ ... }))
 end
 
 --
@@ -144,7 +216,7 @@ end
 --      JoyAxis(joystickID, axisID, value)
 --
 function eapi.BindJoystickAxis(func, ...)
-        eapi.__BindJoystickAxis(GenID(func), GenArgID(arg))
+        eapi.__BindJoystickAxis(GenID(func), GenArgID({ ... }))
 end
 
 --
@@ -188,43 +260,10 @@ function eapi.Collide(world, groupA, groupB, func, upd, priority, ...)
                 return
         end
         eapi.__Collide(world, groupA, groupB, GenID(func), upd, priority,
-                       GenArgID(arg))
+                       GenArgID({ ... }))
 end
 
---
--- Whenever it's necessary to invoke a function if only its ID in the
--- `eapi.idToObjectMap` table is known, the engine calls eapi.__CallFunc() with
--- the function ID as argument.
---
--- funcID       ID that maps to a Lua function.
--- argID        ID of extra arguments that must be
---		looked up in `eapi.idToObjectMap`.
---              Zero means that there are no saved user arguments.
--- remove       Remove function from the eapi.idToObjectMap table once the
---              function has finished.
---
-function eapi.__CallFunc(funcID, argID, remove, ...)
-        local idToObjectMap = eapi.idToObjectMap
-        local func = idToObjectMap[funcID]
-        if argID == 0 then
-                if remove then
-                        idToObjectMap[funcID] = nil
-                end
-                return func(unpack(arg))
-        end
-        
-        local savedArgs = eapi.idToObjectMap[argID]
-        if remove then
-                idToObjectMap[funcID] = nil
-                idToObjectMap[argID] = nil
-        end
-        
-        -- Append `savedArgs` to `arg` because we cannot unpack() both in one
-        -- function call. (Doing `func(unpack(arg), unpack(savedArgs))` does not
-        -- work!).
-        local sz = #arg
-        for i, v in ipairs(savedArgs) do
-                arg[sz + i] = v
-        end
-        return func(unpack(arg))
+-- When running on LuaJIT, replace the hottest functions with FFI versions.
+if eapi.FFI then
+        require("eapi_ffi")
 end
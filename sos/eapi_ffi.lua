@@ -0,0 +1,134 @@
+--
+-- LuaJIT FFI fast path for frequently called eapi functions. Loaded by
+-- eapi.lua when the engine is built with `make LUAJIT=1`.
+--
+-- The replacements call C entry points from src/eapi_ffi.c directly, so the
+-- JIT compiler does not have to leave compiled code and no argument tables are
+-- unpacked on the C side. Calling conventions are unchanged. Whenever a fast
+-- entry point cannot handle its arguments (uncommon object types, or errors),
+-- it returns zero and the original function is called instead, so error
+-- reporting stays the same.
+--
+
+local ffi = require("ffi")
+
+ffi.cdef[[
+int     eapi_ffi_GetPos(void *obj, void *relto, double *out);
+int     eapi_ffi_SetPos(void *obj, double x, double y);
+int     eapi_ffi_GetVel(void *obj, double *out);
+int     eapi_ffi_SetVel(void *obj, double x, double y);
+int     eapi_ffi_GetTime(void *obj, double *out);
+int     eapi_ffi_AnimatePos(void *obj, int type, double x, double y,
+                            double duration, double start_time);
+int     eapi_ffi_AnimateAngle(void *obj, int type, double pivot_x,
+                              double pivot_y, double angle, double duration,
+                              double start_time);
+]]
+
+local C = ffi.C
+local out = ffi.new("double[2]")
+
+-- Vectors may be given as {x, y} or {x=?, y=?}.
+local function Unpack(v)
+        if type(v) ~= "table" then
+                return nil
+        end
+        local x, y = v[1], v[2]
+        if type(x) ~= "number" then
+                x, y = v.x, v.y
+        end
+        if type(x) ~= "number" or type(y) ~= "number" then
+                return nil
+        end
+        return x, y
+end
+
+-- Store result in `dst` table if one was given, return a new table otherwise.
+local function Result(dst)
+        if dst then
+                dst.x, dst.y = out[0], out[1]
+                return dst
+        end
+        return { x = out[0], y = out[1] }
+end
+
+local GetPos = eapi.GetPos
+function eapi.GetPos(obj, relativeTo, dst)
+        if type(relativeTo) == "table" then
+                relativeTo, dst = nil, relativeTo
+        end
+        if C.eapi_ffi_GetPos(obj, relativeTo, out) == 0 then
+                return GetPos(obj, relativeTo, dst)
+        end
+        return Result(dst)
+end
+
+local GetPosXY = eapi.GetPosXY
+function eapi.GetPosXY(obj, relativeTo)
+        if C.eapi_ffi_GetPos(obj, relativeTo, out) == 0 then
+                return GetPosXY(obj, relativeTo)
+        end
+        return out[0], out[1]
+end
+
+local SetPos = eapi.SetPos
+function eapi.SetPos(obj, pos)
+        local x, y = Unpack(pos)
+        if not x or C.eapi_ffi_SetPos(obj, x, y) == 0 then
+                SetPos(obj, pos)
+        end
+end
+
+local GetVel = eapi.GetVel
+function eapi.GetVel(obj, dst)
+        if C.eapi_ffi_GetVel(obj, out) == 0 then
+                return GetVel(obj, dst)
+        end
+        return Result(dst)
+end
+
+local GetVelXY = eapi.GetVelXY
+function eapi.GetVelXY(obj)
+        if C.eapi_ffi_GetVel(obj, out) == 0 then
+                return GetVelXY(obj)
+        end
+        return out[0], out[1]
+end
+
+local SetVel = eapi.SetVel
+function eapi.SetVel(obj, vel)
+        local x, y = Unpack(vel)
+        if not x or C.eapi_ffi_SetVel(obj, x, y) == 0 then
+                SetVel(obj, vel)
+        end
+end
+
+local GetTime = eapi.GetTime
+function eapi.GetTime(obj)
+        if C.eapi_ffi_GetTime(obj, out) == 0 then
+                return GetTime(obj)
+        end
+        return out[0], out[1]
+end
+
+local AnimatePos = eapi.AnimatePos
+function eapi.AnimatePos(obj, animType, toValue, duration, startTime)
+        local x, y = Unpack(toValue)
+        if not x or type(animType) ~= "number"
+        or type(duration) ~= "number"
+        or C.eapi_ffi_AnimatePos(obj, animType, x, y, duration,
+                                 startTime or 0) == 0 then
+                AnimatePos(obj, animType, toValue, duration, startTime)
+        end
+end
+
+local AnimateAngle = eapi.AnimateAngle
+function eapi.AnimateAngle(obj, animType, pivot, angle, duration, startTime)
+        local x, y = Unpack(pivot)
+        if not x or type(animType) ~= "number" or type(angle) ~= "number"
+        or type(duration) ~= "number"
+        or C.eapi_ffi_AnimateAngle(obj, animType, x, y, angle, duration,
+                                   startTime or 0) == 0 then
+                AnimateAngle(obj, animType, pivot, angle, duration, startTime)
+        end
+end
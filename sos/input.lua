@@ -86,6 +86,7 @@ end
 -- fn              User function. Use `nil` to remove binding.
 --
 local function BindKey(keynames, immediate, fn, ...)
+        local arg = { ... }
         if type(keynames) ~= "table" then
                 keynames = {keynames}
         end
@@ -129,6 +130,7 @@ end
 -- function once that happens. Normal key handling is restored afterwards.
 --
 local function WaitAnyKey(except, fn, ...)
+        local arg = { ... }
         if type(except) ~= "table" then
                 except = {except}
         end
@@ -295,6 +297,7 @@ end
 -- Bind user function to a certain action (actions map directly to keys).
 --
 local function BindControls(binding, actions, immediate, fn, ...)
+        local arg = { ... }
         if type(actions) ~= "table" then
                 actions = {actions}
         end
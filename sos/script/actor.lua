@@ -24,10 +24,18 @@ local function Square(x)
 	return { b = -x, t = x, l = -x, r = x }
 end
 
+local function Circle(radius)
+	return { { 0, 0 }, radius }
+end
+
 local function GetPos(actor, relativeTo)
 	return eapi.GetPos(actor.body, relativeTo or gameWorld)
 end
 
+local function GetPosXY(actor, relativeTo)
+	return eapi.GetPosXY(actor.body, relativeTo or gameWorld)
+end
+
 local function MakeSimpleTile(obj, z)
 	local offset = obj.offset
 	local size = obj.spriteSize
@@ -267,8 +275,10 @@ actor = {
 	GetDir = GetDir,
 	Create = Create,
 	Square = Square,
+	Circle = Circle,
 	Delete = Delete,
 	GetPos = GetPos,
+	GetPosXY = GetPosXY,
 	Blink = Blink,
 	Link = Link,
 	Rush = Rush,
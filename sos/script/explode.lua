@@ -92,41 +92,46 @@ local function Small(pos, z)
 	return body
 end
 
+-- Call Step() right away, then every `interval` seconds for as long as it
+-- returns true. The body is destroyed after the last step.
+local function RunSteps(body, Step, interval)
+	if Step() then
+		eapi.Spawn(body, function()
+			repeat eapi.Wait(interval) until not Step()
+			eapi.Destroy(body)
+		end)
+	else
+		eapi.Destroy(body)
+	end
+end
+
 local spacing = 16.0
 local function Area(pos, parentBody, z, radius, interval)
 	local body = actor.CloneBody(parentBody)
 	local random = 360 * util.Random()
 	local count = 0	
 	z = z or 0
-	local function Do()
+	local function Step()
 		local distance = spacing * math.sqrt(count)
 		local offset = { x = distance, y = 0 }
 		offset = vector.Rotate(offset, random + count * util.fibonacci)
 		Simple(vector.Floor(vector.Add(pos, offset)), body, z)
 		count = count + 1
 		z = z - 0.0001
-		if distance <= radius then
-			eapi.AddTimer(body, interval, Do)
-		else
-			eapi.Destroy(body)
-		end
+		return distance <= radius
 	end
-	Do()
+	RunSteps(body, Step, interval)
 end
 
 local function Line(pos, parentBody, z, direction, count, interval)
 	local body = actor.CloneBody(parentBody)
-	local function Do()
+	local function Step()
 		Simple(pos, body, z)
 		pos = vector.Add(pos, direction)
 		count = count - 1
-		if count > 0 then
-			eapi.AddTimer(body, interval, Do)
-		else
-			eapi.Destroy(body)
-		end
+		return count > 0
 	end
-	Do()
+	RunSteps(body, Step, interval)
 end
 
 local function Decal(parentBody, offset)
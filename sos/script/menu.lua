@@ -75,7 +75,7 @@ end
 local function Show(items, pause, tint, box)
 	local index = 1
 	if pause then eapi.Pause(gameWorld) end
-        menu.world = eapi.NewWorld("Menu", 5, util.sceneSize, 40)
+        menu.world = eapi.NewWorld("Menu", 5, util.sceneSize, 40, 0, 256)
 	menuCamera = eapi.NewCamera(menu.world, vector.null, nil, nil, 1)
 	if tint then TintScreen() end
 	local function Move(dir)
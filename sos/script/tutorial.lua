@@ -17,6 +17,7 @@ for i = 1, 4, 1 do
 end
 
 local function Control(...)
+	local arg = { ... }
 	for i, v in ipairs(arg) do
 		controls[i](v)
 	end
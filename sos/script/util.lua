@@ -94,7 +94,7 @@ end
 local function Filter()
 	local pos = { x = -400, y = -240 }
 	local filter = eapi.ChopImage({ "image/filter.png" }, { 800, 480 })
-	local filterWorld = eapi.NewWorld("Menu", 5, util.sceneSize, 40)
+	local filterWorld = eapi.NewWorld("Menu", 5, util.sceneSize, 40, 0, 16)
 	eapi.NewCamera(filterWorld, vector.null, nil, nil, 2)
 	local tile = eapi.NewTile(filterWorld, pos, nil, filter, 0)
 	eapi.Animate(tile, eapi.ANIM_LOOP, 16, 0)
@@ -267,11 +267,37 @@ local function Convert(table)
 	end 	
 end
 
+-- Memory pool usage, refreshed once a second in the top left corner. Shows
+-- records in use, capacity and peak for every pool (see eapi.GetMemoryStats).
+local function MemoryOverlay()
+	local world = eapi.NewWorld("Memory", 5, util.sceneSize, 40, 0, 256)
+	eapi.NewCamera(world, vector.null, nil, nil, 3)
+	local body = eapi.GetBody(world)
+	local tiles = { }
+
+	local function Refresh()
+		DestroyTable(tiles)
+		tiles = { }
+		local pos = { x = -392, y = 216 }
+		for _, st in ipairs(eapi.GetMemoryStats()) do
+			local text = string.format("%-22s%6d/%-6d peak %d",
+						   st.name, st.current,
+						   st.cells, st.peak)
+			local line = PrintShadow(pos, text, nil, 0, body)
+			tiles = util.JoinTables(tiles, line)
+			pos.y = pos.y - util.defaultFontset.size.y
+		end
+		eapi.AddTimer(body, 1, Refresh)
+	end
+	Refresh()
+end
+
 local function Goto(scene)
 	eapi.DrawToTexture("framebuffer")
 
 	sounds = { }
 	eapi.Clear()
+	eapi.SetScene(scene)
 	input.UnbindAll()
 	state.level = scene
 
@@ -287,6 +313,7 @@ local function Goto(scene)
 
 	staticBody = eapi.GetBody(gameWorld)
 	if Cfg.scanlines then Filter() end
+	if Cfg.memoryOverlay then MemoryOverlay() end
 	eapi.RandomSeed(42)
 
 	dofile("script/menu.lua")
@@ -584,6 +611,7 @@ util = {
 	PrintGradient = PrintGradient,
 	DestroyTable = DestroyTable,
 	SetTileAlpha = SetTileAlpha,
+	MemoryOverlay = MemoryOverlay,
 	PrintShadow = PrintShadow,
 	WhiteScreen = WhiteScreen,
 	PrintOrange = PrintOrange,
@@ -10,6 +10,7 @@
 #include "audio.h"
 #include "config.h"
 #include "log.h"
+#include "manifest.h"
 #include "mem.h"
 #include "body.h"
 #include "uthash.h"
@@ -73,8 +74,8 @@ typedef struct {
         uint32_t start_time;    /* When channel playback was started. */
         uint32_t duration;      /* Sound duration in ms. */
         
-        Body    *source;        /* Body that is producing the sound. */
-        Body    *listener;      /* Body that "hears" the sound. */
+        Handle  source;         /* Body that is producing the sound. */
+        Handle  listener;       /* Body that "hears" the sound. */
         
         float   dist_maxvol;    /* Play sound at max volume when listener is
                                    this close to source. */
@@ -99,6 +100,7 @@ sound_lookup_or_create(const char *name)
         if (snd != NULL) {
                 /* Reset usage counter and return sound. */
                 snd->usage = SOUND_HISTORY;
+                manifest_use(MANIFEST_SOUND, name, 0, 0);
                 return snd;
         }
         
@@ -120,6 +122,7 @@ sound_lookup_or_create(const char *name)
         
         /* Add to global hash which is indexed by name. */
         HASH_ADD_STR(sound_hash, name, snd);
+        manifest_use(MANIFEST_SOUND, name, 0, 1);
         return snd;
 }
 
@@ -138,6 +141,7 @@ music_lookup_or_create(const char *name)
         if (music != NULL) {
                 /* Reset usage counter and return music. */
                 music->usage = MUSIC_HISTORY;
+                manifest_use(MANIFEST_MUSIC, name, 0, 0);
                 return music;
         }
         
@@ -157,6 +161,7 @@ music_lookup_or_create(const char *name)
         
         /* Add to global hash which is indexed by name. */
         HASH_ADD_STR(music_hash, name, music);
+        manifest_use(MANIFEST_MUSIC, name, 0, 1);
         return music;
 }
 
@@ -365,14 +370,11 @@ audio_play(const char *name, uintptr_t group, int volume, int loops,
 static void
 calculate_bound_volume(int ch)
 {
-        Body *source = channels[ch].source;
-        Body *listener = channels[ch].listener;
-        
-        /*
-         * If objtype member no longer says that it's a Body, assume the
-         * body was destroyed and halt the channel.
-         */
-        if (source->objtype != OBJTYPE_BODY || listener->objtype != OBJTYPE_BODY) {
+        Body *source = handle_get(channels[ch].source);
+        Body *listener = handle_get(channels[ch].listener);
+        
+        /* Halt the channel once either body is destroyed. */
+        if (source == NULL || listener == NULL) {
                 Mix_HaltChannel(ch);
                 return;
         }
@@ -420,8 +422,8 @@ audio_bind_volume(int ch, uint sound_id, Body *source, Body *listener,
         if (channels[ch].snd == NULL || channels[ch].sound_id != sound_id)
                 return;
         
-        channels[ch].source = source;
-        channels[ch].listener = listener;
+        channels[ch].source = source->handle;
+        channels[ch].listener = listener->handle;
         channels[ch].dist_maxvol = dist_maxvol;
         channels[ch].dist_silence = dist_silence;
         
@@ -439,7 +441,7 @@ audio_adjust_volume(void)
                 return;
 
         for (int i = 0; i < num_channels; i++) {
-                if (channels[i].snd == NULL || channels[i].source == NULL)
+                if (channels[i].snd == NULL || channels[i].source == 0)
                         continue;       /* Channel inactive or not bound. */
                 
                 calculate_bound_volume(i);
@@ -565,6 +567,25 @@ audio_stop(int ch, uint sound_id)
         Mix_HaltChannel(ch);
 }
 
+/*
+ * Load sound into memory ahead of time so that playing it later does not have
+ * to wait for the file to be read.
+ */
+void
+audio_preload(const char *name)
+{
+        sound_lookup_or_create(name);
+}
+
+/*
+ * Same as audio_preload(), only for music.
+ */
+void
+audio_music_preload(const char *name)
+{
+        music_lookup_or_create(name);
+}
+
 /*
  * loops        If zero, play infinite number of times.
  */
@@ -24,6 +24,7 @@ void     audio_bind_volume(int ch, uint sound_id, Body *source, Body *listener,
                            float dist_maxvol, float dist_silence);
 void     audio_fadeout(int channel, uint sound_id, int fade_time);
 void     audio_stop(int channel, uint sound_id);
+void     audio_preload(const char *name);
 
 /* Manage music. */
 void     audio_music_play(const char *name, int volume, int loops, int fade_in, double pos);
@@ -31,6 +32,7 @@ void     audio_music_set_volume(int volume, int time, int delay);
 void     audio_music_pause(void);
 void     audio_music_resume(void);
 void     audio_music_fadeout(int fade_time);
+void     audio_music_preload(const char *name);
 
 /* Manage sound groups. */
 void     audio_pause_group(uintptr_t group);
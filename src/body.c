@@ -3,10 +3,13 @@
 #include <stdlib.h>
 #include "common.h"
 #include "body.h"
+#include "emitter.h"
 #include "event.h"
 #include "log.h"
 #include "shape.h"
+#include "stepfunc.h"
 #include "tile.h"
+#include "util_lua.h"
 #include "world.h"
 #include "utlist.h"
 
@@ -14,7 +17,9 @@
  * The following macros are the same thing as DL_APPEND and DL_DELETE from
  * utlist.h linked list library. The difference is that they allow `prev` and
  * `next` structure members to have an arbitrary prefix, so that the same
- * structure may be placed in multiple lists at the same time.
+ * structure may be placed in multiple lists at the same time. DL_DELETE_P also
+ * clears the removed element's links, so that a non-NULL `prev` tells whether
+ * an element is in the list.
  */
 #define DL_APPEND_P(head,add,prefix) \
 do { \
@@ -46,6 +51,7 @@ do { \
           (head)->prefix##prev = (del)->prefix##prev; \
       } \
   } \
+  (del)->prefix##prev = (del)->prefix##next = NULL; \
 } while (0)
 
 void
@@ -57,6 +63,7 @@ body_init(Body *b, Body *parent, World *world, vect_f pos, unsigned flags)
         
         /* Set nonzero attributes. */
         b->objtype = OBJTYPE_BODY;
+        b->handle = handle_new(b);
         b->flags = flags;
         b->world = world;
         
@@ -70,11 +77,81 @@ body_init(Body *b, Body *parent, World *world, vect_f pos, unsigned flags)
                 b->parent = parent;
                 DL_APPEND(parent->children, b);
         }
-#if !ALL_NOCTURNAL
-        /* If body does not sleep, add to nocturnal list. */
-        if (flags & BODY_NOCTURNAL)
-                DL_APPEND_P(world->nocturnal, b, nocturnal_);
+        body_update_nocturnal(b);
+        body_update_transient(b);
+        world_body_changed(b);
+}
+
+/*
+ * Grid lookups around cameras only find bodies through their shapes (and
+ * tiles, if the tile grid is enabled). Bodies that cannot be found this way,
+ * bodies flagged BODY_NOCTURNAL, and bodies woken up by body_wake() are kept in
+ * world's nocturnal list instead, so world_step() can activate them without
+ * walking the whole body tree. Call this whenever any of these conditions may
+ * have changed.
+ */
+void
+body_update_nocturnal(Body *b)
+{
+        /* Static and camera bodies are stepped separately. */
+        if (b->parent == NULL)
+                return;
+        
+        int locatable = (b->shapes != NULL);
+#if ENABLE_TILE_GRID
+        for (Tile *t = b->tiles; t != NULL && !locatable; t = t->next)
+                locatable = grid_stored(&t->go);
 #endif
+        int want = !locatable || (b->flags & BODY_NOCTURNAL) ||
+            b->wake_step > b->step;
+        if (want && !body_nocturnal(b))
+                DL_APPEND_P(b->world->nocturnal, b, nocturnal_);
+        else if (!want && body_nocturnal(b))
+                DL_DELETE_P(b->world->nocturnal, b, nocturnal_);
+}
+
+/*
+ * Keep body active for at least `duration` seconds (zero means the next step),
+ * no matter how far it is from cameras.
+ */
+void
+body_wake(Body *b, float duration)
+{
+        unsigned steps = (unsigned)ceilf(duration / b->world->step_sec);
+        b->wake_step = MAX(b->wake_step, b->step + steps + 1);
+        body_update_nocturnal(b);
+}
+
+/*
+ * Keep world's transient list in sync with BODY_TRANSIENT flag. Only bodies
+ * that are part of the hierarchy are listed.
+ */
+void
+body_update_transient(Body *b)
+{
+        int want = (b->flags & BODY_TRANSIENT) && b->parent != NULL;
+        if (want && !body_transient(b))
+                DL_APPEND_P(b->world->transient, b, transient_);
+        else if (!want && body_transient(b))
+                DL_DELETE_P(b->world->transient, b, transient_);
+}
+
+/*
+ * Return world-space box around body's shapes (using their cached boxes), or
+ * just the body's position if it has no shapes.
+ */
+BB
+body_world_bb(Body *b)
+{
+        if (b->shapes == NULL) {
+                vect_f pos = body_absolute_pos(b);
+                int x = posround(pos.x), y = posround(pos.y);
+                return (BB){.l=x, .r=x, .b=y, .t=y};
+        }
+        BB bb = shape_world_bb(b->shapes);
+        for (Shape *s = b->shapes->next; s != NULL; s = s->next)
+                bb_union(&bb, shape_world_bb(s));
+        return bb;
 }
 
 static void
@@ -113,6 +190,24 @@ void
 body_sweep_bb(Body *b, BB *bb)
 {
         do {
+                /* Keyframe path: grow box to contain every key position. */
+                if (b->pos->anim_type == ANIM_PATH) {
+                        const PropPath *path = b->pos->_.path.track;
+                        vect_f lb = path->keys[0]._.vectf, rt = lb;
+                        for (unsigned i = 1; i < path->num_keys; i++) {
+                                vect_f k = path->keys[i]._.vectf;
+                                lb.x = MIN(lb.x, k.x);
+                                lb.y = MIN(lb.y, k.y);
+                                rt.x = MAX(rt.x, k.x);
+                                rt.y = MAX(rt.y, k.y);
+                        }
+                        bb->l += floorf(lb.x);
+                        bb->b += floorf(lb.y);
+                        bb->r += ceilf(rt.x);
+                        bb->t += ceilf(rt.y);
+                        continue;
+                }
+                
                 /* Translate box to body position. */
                 vect_f start_pos = b->pos->_.vectf.start;
                 bb_add_vect(bb, (vect_i){posround(start_pos.x), 
@@ -142,6 +237,7 @@ void
 body_pause(Body *b)
 {
         b->flags |= BODY_PAUSED;
+        world_body_changed(b);
 }
 
 /*
@@ -151,6 +247,7 @@ void
 body_resume(Body *b)
 {
         b->flags &= ~BODY_PAUSED;
+        world_body_changed(b);
 }
 
 #if TRACE_MAX
@@ -220,6 +317,7 @@ body_record_trace(Body *b)
         bs->vel = b->vel;
         bs->step_func = b->step_func;
         bs->step_cb_data = b->step_cb_data;
+        bs->step_params = (b->flags & BODY_STEP_PARAMS) != 0;
         
         /* Handle `trace_next` wrap-around. */
         if (b->trace_next == TRACE_MAX)
@@ -248,8 +346,15 @@ restore_body_state(Body *b, BodyState *bs)
         b->step = bs->step;
         b->pos = prop_copy(bs->pos);
         b->vel = bs->vel;
-        b->step_func = bs->step_func;
-        b->step_cb_data = bs->step_cb_data;
+        
+        /*
+         * Step parameters are owned by the body and not recorded, so a step
+         * function that uses them is never restored (or replaced).
+         */
+        if (!(b->flags & BODY_STEP_PARAMS) && !bs->step_params) {
+                b->step_func = bs->step_func;
+                b->step_cb_data = bs->step_cb_data;
+        }
 }
 
 static void
@@ -404,9 +509,32 @@ body_rewind(Body *b, float time, float *rewound_time)
 void
 body_destroy(Body *b)
 {
-        /* Remove body from parent's child list. */
+        /* Remove body from parent's child list and world's active set. */
         if (b->parent != NULL)
                 DL_DELETE(b->parent->children, b);
+        world_body_removed(b);
+        
+        /*
+         * Leave origin's lists. Our own clones forget about us, and parked
+         * ones are freed for good.
+         */
+        if (b->origin != NULL) {
+                if (b->flags & BODY_PARKED)
+                        DL_DELETE_P(b->origin->parked, b, clone_);
+                else
+                        DL_DELETE_P(b->origin->clones, b, clone_);
+        }
+        while (b->clones != NULL) {
+                Body *clone = b->clones;
+                DL_DELETE_P(b->clones, clone, clone_);
+                clone->origin = NULL;
+        }
+        while (b->parked != NULL) {
+                Body *clone = b->parked;
+                DL_DELETE_P(b->parked, clone, clone_);
+                clone->origin = NULL;
+                body_free(clone);
+        }
         
         /* Destroy children. */
         while (b->children != NULL)
@@ -424,9 +552,29 @@ body_destroy(Body *b)
         Timer *timer, *tmp;
         DL_FOREACH_SAFE(b->timer_list, timer, tmp) {
                 DL_DELETE(b->timer_list, timer);
-                timer_free(timer, 1);
+                timer_free(&b->world->timer_pool, timer, 1);
         }
         
+        /* Remove from nocturnal and transient lists if necessary. */
+        if (body_nocturnal(b))
+                DL_DELETE_P(b->world->nocturnal, b, nocturnal_);
+        if (body_transient(b))
+                DL_DELETE_P(b->world->transient, b, transient_);
+        
+        /* Free emitter's bullet template. */
+        if (b->flags & BODY_EMITTER)
+                body_free(((Emitter *)b->step_cb_data)->bullet);
+        body_release(b);
+}
+
+/*
+ * Free what body owns outside of its world's memory pools: properties, trace,
+ * step function state, and handle. Children, tiles, shapes, and timers are not
+ * touched. Used directly when a whole world is destroyed (see world_kill()).
+ */
+void
+body_release(Body *b)
+{
         /* Free properties. */
         prop_free(b->pos);
 
@@ -446,83 +594,271 @@ body_destroy(Body *b)
                 mp_free(&mp_bodytrace, trace);
         }
 #endif
-        
-#if !ALL_NOCTURNAL
-        /* Remove from nocturnal list if necessary. */
-        if (b->nocturnal_prev != NULL || b->nocturnal_next != NULL) {
-                DL_DELETE_P(b->world->nocturnal, b, nocturnal_);
-        }
-#endif
+        /* Free emitter and step function state. */
+        if (b->flags & BODY_EMITTER)
+                emitter_release((Emitter *)b->step_cb_data);
+        if (b->flags & BODY_STEP_PARAMS)
+                stepparams_free((StepParams *)b->step_cb_data);
+        handle_free(b->handle);
+        b->objtype = 0;         /* Body reads as destroyed from now on. */
 }
 
 void
 body_free(Body *body)
 {
-        extern mem_pool mp_body;
-
-        assert(body != &body->world->static_body);
+        World *world = body->world;
+        assert(body != &world->static_body);
         body_destroy(body);
-        mp_free(&mp_body, body);
+        mp_free(&world->body_pool, body);
 }
 
 Body *
 body_new(Body *parent, vect_f pos, unsigned flags)
 {
-        extern mem_pool mp_body;
-        Body *b = mp_alloc(&mp_body);
+        Body *b = mp_alloc(&parent->world->body_pool);
         body_init(b, parent, parent->world, pos, flags);
         return b;
 }
 
-Body *
-body_clone(const Body *orig)
+/*
+ * Copy body state from `orig`: position (including animation), velocity,
+ * acceleration, flags, and step functions. Step function running state is not
+ * copied (see stepparams_clone()).
+ */
+static void
+body_copy(Body *b, const Body *orig)
 {
-        /* Allocate and set objtype. */
-        extern mem_pool mp_body;
-        Body *b = mp_alloc(&mp_body);
-        b->objtype = OBJTYPE_BODY;
-        
-        /* Copy properties. */
-        b->world = orig->world;
         b->pos = prop_copy(orig->pos);
         b->vel = orig->vel;
         b->acc = orig->acc;
         b->prevstep_pos = orig->prevstep_pos;
-        b->flags = orig->flags;
+        b->flags = orig->flags & ~BODY_PARKED;
         
         /* Copy step function data. */
         b->step = orig->step;
         b->step_func = orig->step_func;
         b->step_cb_data = orig->step_cb_data;
+        if (orig->flags & BODY_STEP_PARAMS) {
+                b->step_cb_data = (intptr_t)stepparams_clone(
+                    (StepParams *)orig->step_cb_data);
+        }
         b->afterstep_func = orig->afterstep_func;
         b->afterstep_cb_data = orig->afterstep_cb_data;
+}
+
+Body *
+body_clone(Body *parent, Body *orig)
+{
+        assert(parent && orig && parent->world == orig->world);
+        assert(!(orig->flags & (BODY_EMITTER | BODY_PARKED)));
+        
+        /* Allocate and set objtype. */
+        Body *b = mp_alloc(&orig->world->body_pool);
+        b->objtype = OBJTYPE_BODY;
+        b->handle = handle_new(b);
+        
+        /* Copy properties; remember where we came from. */
+        b->world = orig->world;
+        body_copy(b, orig);
+        b->origin = orig;
+        DL_APPEND_P(orig->clones, b, clone_);
+        
+        /*
+         * Add to parent's child list. This must happen before tiles and
+         * shapes are cloned, since their grid boxes are computed by walking
+         * up the body hierarchy.
+         */
+        b->parent = parent;
+        DL_APPEND(parent->children, b);
+        
+        /* Clone owned tiles (tile_clone() adds them to our list). */
+        Tile *t;
+        DL_FOREACH(orig->tiles, t)
+                tile_clone(b, t);
+        
+        /* Clone owned shapes (shape_clone() adds them to our list). */
+        Shape *s;
+        DL_FOREACH(orig->shapes, s)
+                shape_clone(b, s);
+        
+        body_update_nocturnal(b);
+        body_update_transient(b);
+        world_body_changed(b);
+        return b;
+}
+
+/*
+ * Take body out of play without destroying it: unlink it from its parent, pause
+ * it, and remove its tiles and shapes from the world grid. A detached body is
+ * not stepped, drawn or collided with, but it can still be passed to
+ * body_clone() as a template. Detached bodies must not have children.
+ */
+void
+body_detach(Body *b)
+{
+        assert(b->parent != NULL && b->children == NULL);
+        World *world = b->world;
+        
+        /* Unlink from parent and leave the nocturnal list. */
+        DL_DELETE(b->parent->children, b);
+        b->parent = NULL;
+        if (body_nocturnal(b))
+                DL_DELETE_P(world->nocturnal, b, nocturnal_);
+        body_update_transient(b);
         
-        /* Clone owned tiles. */
+        /* Leave active arrays (parent == NULL and paused). */
+        b->flags |= BODY_PAUSED;
+        world_body_changed(b);
+        
+        /* Remove shapes and tiles from grid. */
+        Shape *s;
+        DL_FOREACH(b->shapes, s) {
+                if (grid_stored(&s->go))
+                        grid_remove(&world->grid, &s->go);
+        }
+#if ENABLE_TILE_GRID
         Tile *t;
-        DL_FOREACH(orig->tiles, t) {
-                DL_APPEND(b->tiles, tile_clone(b, t));
+        DL_FOREACH(b->tiles, t) {
+                if (grid_stored(&t->go)) {
+                        grid_remove(&world->grid, &t->go);
+                        t->flags |= TILE_GRID_CLONE;
+                }
+        }
+#endif
+}
+
+/*
+ * Return true if clone still has as many tiles and shapes as its origin, so
+ * that body_reuse() can reset them pairwise.
+ */
+static int
+body_matches_origin(const Body *b, const Body *orig)
+{
+        const Tile *t = b->tiles, *ot = orig->tiles;
+        for (; t != NULL && ot != NULL; t = t->next, ot = ot->next)
+                ;
+        const Shape *s = b->shapes, *os = orig->shapes;
+        for (; s != NULL && os != NULL; s = s->next, os = os->next)
+                ;
+        return t == NULL && ot == NULL && s == NULL && os == NULL;
+}
+
+/*
+ * Instead of destroying a clone, park it on its origin's freelist with tiles,
+ * shapes and properties intact, so that body_reuse() can bring it back without
+ * allocating anything. Bodies that can't be reused (not clones, have children,
+ * or their tiles and shapes no longer match the origin) are simply freed.
+ */
+void
+body_recycle(Body *b)
+{
+        assert(b->parent != NULL && !(b->flags & BODY_PARKED));
+        Body *orig = b->origin;
+        int reusable = (orig != NULL && b->children == NULL &&
+                        body_matches_origin(b, orig));
+#if TRACE_MAX
+        reusable = reusable && b->trace == NULL;
+#endif
+        if (!reusable) {
+                body_free(b);
+                return;
         }
         
-        /* Clone owned shapes. */
+        /* Clear timers. */
+        Timer *timer, *tmp;
+        DL_FOREACH_SAFE(b->timer_list, timer, tmp) {
+                DL_DELETE(b->timer_list, timer);
+                timer_free(&b->world->timer_pool, timer, 1);
+        }
+        
+        /* Take out of play and move to origin's freelist. */
+        body_detach(b);
+        DL_DELETE_P(orig->clones, b, clone_);
+        DL_APPEND_P(orig->parked, b, clone_);
+        b->flags |= BODY_PARKED;
+        
+        /*
+         * As far as scripts are concerned, the body is gone: handles they may
+         * still hold must not reach it once it is reused.
+         */
+        handle_free(b->handle);
+        b->handle = handle_new(b);
+        Tile *t;
+        DL_FOREACH(b->tiles, t) {
+                handle_free(t->handle);
+                t->handle = handle_new(t);
+        }
         Shape *s;
-        DL_FOREACH(orig->shapes, s) {
-                DL_APPEND(b->shapes, shape_clone(b, s));
+        DL_FOREACH(b->shapes, s) {
+                handle_free(s->handle);
+                s->handle = handle_new(s);
         }
+}
+
+/*
+ * Like body_clone(), but take a parked clone of `orig` if there is one (see
+ * body_recycle()). A reused body has the same position, velocity, animations,
+ * and step functions as a fresh clone would.
+ */
+Body *
+body_reuse(Body *parent, Body *orig)
+{
+        assert(parent && orig && parent->world == orig->world);
+        Body *b = orig->parked;
+        if (b == NULL)
+                return body_clone(parent, orig);
         
-        /* Add to parent's child list. */
-        Body *parent = orig->parent;
-        if (parent != NULL) {
-                b->parent = parent;
-                DL_APPEND(parent->children, b);
+        /* Back to origin's list of live clones. */
+        DL_DELETE_P(orig->parked, b, clone_);
+        DL_APPEND_P(orig->clones, b, clone_);
+        
+        /* Reset state and attach to parent (see body_clone()). */
+        prop_free(b->pos);
+        if (b->flags & BODY_STEP_PARAMS)
+                stepparams_free((StepParams *)b->step_cb_data);
+        body_copy(b, orig);
+        b->wake_step = 0;
+        b->parent = parent;
+        DL_APPEND(parent->children, b);
+        
+        /* Reset tiles and shapes pairwise (body_recycle() made sure they match). */
+        Tile *t = b->tiles, *ot;
+        DL_FOREACH(orig->tiles, ot) {
+                tile_reset(t, ot);
+                t = t->next;
         }
-#if !ALL_NOCTURNAL
-        /* If body does not sleep, add to nocturnal list. */
-        if (b->flags & BODY_NOCTURNAL)
-                DL_APPEND_P(b->world->nocturnal, b, nocturnal_);
-#endif
+        Shape *s = b->shapes, *os;
+        DL_FOREACH(orig->shapes, os) {
+                shape_reset(s, os);
+                s = s->next;
+        }
+        
+        body_update_nocturnal(b);
+        body_update_transient(b);
+        world_body_changed(b);
         return b;
 }
 
+/*
+ * Replace body step function. `flags` tells what kind of function it is:
+ * BODY_STEP_C for a C function, plus BODY_STEP_PARAMS if `data` points to
+ * StepParams that the body takes ownership of. Previously owned parameters are
+ * freed.
+ */
+void
+body_set_step(Body *b, intptr_t func, intptr_t data, unsigned flags)
+{
+        assert(!(b->flags & BODY_EMITTER));
+        assert((flags & ~(BODY_STEP_C | BODY_STEP_PARAMS)) == 0);
+        if (b->flags & BODY_STEP_PARAMS)
+                stepparams_free((StepParams *)b->step_cb_data);
+        
+        b->flags &= ~(BODY_STEP_C | BODY_STEP_PARAMS);
+        b->flags |= flags;
+        b->step_func = func;
+        b->step_cb_data = data;
+}
+
 /*
  * Execute body's step function.
  *
@@ -552,19 +888,10 @@ body_step(Body *body, lua_State *L, void *script_ptr)
                 return;
         }
 #if ENABLE_LUA
-        /* Push arguments. */
-        extern int callfunc_index;
-        lua_pushvalue(L, callfunc_index);               /* ... callfunc */
-        assert(lua_isfunction(L, -1));                  
-        lua_pushinteger(L, body->step_func);            /* + func_id */
-        lua_pushinteger(L, body->step_cb_data);         /* + arg_id */
-        lua_pushboolean(L, 0);                          /* + false */
-        lua_pushlightuserdata(L, script_ptr);           /* + script_ptr */
-        
         /* Execute Lua function. */
-        extern int errfunc_index;
-        if (lua_pcall(L, 4, 0, errfunc_index))
-                fatal_error("[Lua] %s", lua_tostring(L, -1));
+        L_callback_push(L, body->step_func);            /* + func */
+        L_push_object(L, script_ptr);                   /* + script_ptr */
+        L_callback_call(L, body->step_func, body->step_cb_data, 0, 1, 0);
 #endif  /* ENABLE_LUA */
 }
 
@@ -589,19 +916,11 @@ body_afterstep(Body *body, lua_State *L, void *script_ptr)
                 return;
         }
 #if ENABLE_LUA
-        /* Push arguments. */
-        extern int callfunc_index;
-        lua_pushvalue(L, callfunc_index);               /* ... callfunc */
-        assert(lua_isfunction(L, -1));                  
-        lua_pushinteger(L, body->afterstep_func);       /* + func_id */
-        lua_pushinteger(L, body->afterstep_cb_data);    /* + arg_id */
-        lua_pushboolean(L, 0);                          /* + false */
-        lua_pushlightuserdata(L, script_ptr);           /* + script_ptr */
-        
         /* Execute Lua function. */
-        extern int errfunc_index;
-        if (lua_pcall(L, 4, 0, errfunc_index))
-                fatal_error("[Lua] %s", lua_tostring(L, -1));
+        L_callback_push(L, body->afterstep_func);       /* + func */
+        L_push_object(L, script_ptr);                   /* + script_ptr */
+        L_callback_call(L, body->afterstep_func, body->afterstep_cb_data, 0, 1,
+                        0);
 #endif  /* ENABLE_LUA */
 }
 
@@ -612,15 +931,23 @@ body_pos(Body *b)
         if (anim->anim_type == ANIM_NONE)
                 return anim->_.vectf.start;         /* No animation. */
         
-        vect_f start = anim->_.vectf.start;
-        vect_f end = anim->_.vectf.end;
-        
         /* Get current time, and time since animation start. */
         World *world = b->world;
         float now = b->step * world->step_sec;
         float delta = now - anim->start_time;
         float duration = anim->duration;
         
+        /* Keyframe path. */
+        if (anim->anim_type == ANIM_PATH) {
+                vect_f val;
+                if (path_vectf(anim, delta, &val))
+                        body_set_pos(b, val);
+                return val;
+        }
+        
+        vect_f start = anim->_.vectf.start;
+        vect_f end = anim->_.vectf.end;
+        
         /* If animation has not started yet, return start value. */
         if (delta <= 0.0)
                 return start;
@@ -723,28 +1050,40 @@ body_anim_pos(Body *b, uint8_t type, vect_f end, float duration,
 }
 
 /*
- * Add a timer to world.
- *
- * body         Body that you want to add the timer to.
- * when         When is this timer supposed to run (offset since now).
- * type         OBJTYPE_TIMER_C or OBJTYPE_TIMER_LUA.
- * func         Lua function ID or C function pointer to invoke once it's time.
- * data         User callback data.
+ * Animate body position along a keyframe path. Body takes ownership of `path`.
  */
-Timer *
-body_add_timer(Body *b, void *owner, float when, int type, intptr_t func,
-               intptr_t data)
+void
+body_anim_path(Body *b, PropPath *path, float start_time)
 {
-        unsigned sched = (unsigned)lroundf(b->step + when / b->world->step_sec);
-        Timer *timer = timer_new(owner, b->step, sched, type, func, data);
+        assert(b != &b->world->static_body);
+        assert(path->num_keys >= 2 && path->keys[path->num_keys - 1].time > 0);
+        
+        /* Destroy previous animation and create a new one. */
+        prop_free(b->pos);
+        b->pos = prop_new();
+        b->pos->anim_type = ANIM_PATH;
+        b->pos->start_time = start_time + b->step * b->world->step_sec;
+        b->pos->duration = path->keys[path->num_keys - 1].time;
+        b->pos->_.path.track = path;
         
+        body_bb_changed(b);
+}
+
+/*
+ * Insert timer into body's timer list, which is kept sorted by the step number
+ * timers are scheduled for.
+ */
+static void
+timer_insert(Body *b, Timer *timer)
+{
+        unsigned sched = timer->scheduled;
         if (b->timer_list == NULL || sched <= b->timer_list->scheduled) {
                 DL_PREPEND(b->timer_list, timer);    /* As first. */
-                return timer;
+                return;
         }
         if (sched >= b->timer_list->prev->scheduled) {
                 DL_APPEND(b->timer_list, timer);
-                return timer;                        /* As last. */
+                return;                              /* As last. */
         }
         
         /* Find spot where we can insert. */
@@ -755,19 +1094,129 @@ body_add_timer(Body *b, void *owner, float when, int type, intptr_t func,
                         timer->next = iter;
                         iter->prev->next = timer;
                         iter->prev = timer;
-                        return timer;
+                        return;
                 }
         }
         abort();
 }
 
+/*
+ * Add a timer to world.
+ *
+ * body         Body that you want to add the timer to.
+ * when         When is this timer supposed to run (offset since now).
+ * type         OBJTYPE_TIMER_C, OBJTYPE_TIMER_LUA, or OBJTYPE_TIMER_TASK.
+ * func         Lua function (or coroutine) ID or C function pointer to invoke
+ *              once it's time.
+ * data         User callback data.
+ */
+Timer *
+body_add_timer(Body *b, void *owner, float when, int type, intptr_t func,
+               intptr_t data)
+{
+        unsigned sched = (unsigned)lroundf(b->step + when / b->world->step_sec);
+        Timer *timer = timer_new(&b->world->timer_pool, owner, b->step, sched,
+                                 type, func, data);
+        timer_insert(b, timer);
+        return timer;
+}
+
 void
 body_cancel_timer(Body *body, Timer *timer)
 {
         /* Remove from list and free timer memory. */
         DL_DELETE(body->timer_list, timer);
-        timer_free(timer, 1);
+        timer_free(&body->world->timer_pool, timer, 1);
+}
+
+#if ENABLE_LUA
+/*
+ * Resume the coroutine of a task timer (see Spawn() in eapi_Lua.c). On its
+ * first run the coroutine gets the timer owner and saved user arguments.
+ *
+ * While the coroutine runs, the timer waits at the end of the body's timer
+ * list, so the task may cancel itself or destroy its body like any other
+ * timer callback would. If the coroutine yields, the timer is rescheduled:
+ * Wait() and WaitSteps() yield (seconds, false) and (steps, true)
+ * respectively; a bare coroutine.yield() waits for one step. Once the
+ * coroutine returns, the timer is freed along with its references.
+ */
+static void
+resume_task(Body *body, Timer *timer, lua_State *L)
+{
+        extern int idmap_index;
+        Handle handle = timer->handle;
+        
+        DL_DELETE(body->timer_list, timer);
+        timer->scheduled = UINT_MAX;
+        DL_APPEND(body->timer_list, timer);
+        
+        /* Thread stays on our stack so it cannot be collected while running. */
+        lua_rawgeti(L, idmap_index, timer->func);               /* + thread */
+        lua_State *co = lua_tothread(L, -1);
+        assert(co != NULL);
+        
+        int nargs = 0;
+        if (lua_status(co) == 0) {
+                L_push_object(co, timer->owner);
+                nargs++;
+                if (timer->data != 0) {
+                        /* Unpack saved arguments up to the first nil. */
+                        lua_rawgeti(L, idmap_index, timer->data); /* + args */
+                        int args_index = lua_gettop(L), n = 0;
+                        for (;; n++) {
+                                luaL_checkstack(L, 1, "Too many task "
+                                                "arguments.");
+                                lua_rawgeti(L, args_index, n + 1);
+                                if (lua_isnil(L, -1)) {
+                                        lua_pop(L, 1);
+                                        break;
+                                }
+                        }
+                        if (!lua_checkstack(co, n))
+                                fatal_error("Too many task arguments.");
+                        lua_xmove(L, co, n);
+                        lua_pop(L, 1);                          /* - args */
+                        nargs += n;
+                        
+                        /* Arguments are only passed once. */
+                        lua_pushnil(L);
+                        lua_rawseti(L, idmap_index, timer->data);
+                        timer->data = 0;
+                }
+        }
+        
+        int status = lua_resume(co, nargs);
+        if (status != 0 && status != LUA_YIELD)
+                fatal_error("[Lua] %s", lua_tostring(co, -1));
+        
+        /* Timer was canceled (or body destroyed) while task was running. */
+        if (handle_get(handle) != timer) {
+                lua_pop(L, 1);                                  /* - thread */
+                return;
+        }
+        
+        /* Task done: release coroutine reference and free timer. */
+        if (status == 0) {
+                body_cancel_timer(body, timer);
+                lua_pop(L, 1);                                  /* - thread */
+                return;
+        }
+        
+        /* Reschedule. */
+        unsigned steps = 1;
+        if (lua_gettop(co) >= 2 && lua_isboolean(co, 2)) {
+                float amount = lua_tonumber(co, 1);
+                steps = lua_toboolean(co, 2) ? (unsigned)amount :
+                    (unsigned)lroundf(amount / body->world->step_sec);
+        }
+        lua_settop(co, 0);
+        DL_DELETE(body->timer_list, timer);
+        timer->scheduled = body->step + steps;
+        timer_insert(body, timer);
+        lua_pop(L, 1);                                          /* - thread */
 }
+#endif  /* ENABLE_LUA */
 
 void
 body_run_timers(Body *body, lua_State *L)
@@ -799,6 +1248,12 @@ body_run_timers(Body *body, lua_State *L)
                 Timer *timer = timer_array[i];
                 if (timer->objtype == 0)
                         continue;       /* Destroyed timer. */
+#if ENABLE_LUA
+                if (timer->objtype == OBJTYPE_TIMER_TASK) {
+                        resume_task(body, timer, L);
+                        continue;
+                }
+#endif
                         
                 int objtype = timer->objtype;
                 void *owner = timer->owner;
@@ -807,27 +1262,18 @@ body_run_timers(Body *body, lua_State *L)
                 
                 /* Remove timer from list and destroy it. */
                 DL_DELETE(body->timer_list, timer);
-                timer_free(timer, 0);
+                timer_free(&body->world->timer_pool, timer, 0);
                 
                 if (objtype == OBJTYPE_TIMER_C) {                        
                         ((TimerFunction)func)(owner, data);
                         continue;
                 }
 #if ENABLE_LUA
-                /* Push arguments. */
+                /* Call Lua function; timer references are released. */
                 assert(objtype == OBJTYPE_TIMER_LUA);
-                extern int callfunc_index;
-                lua_pushvalue(L, callfunc_index);   /* ... callfunc */
-                assert(lua_isfunction(L, -1));
-                lua_pushinteger(L, func);           /* + func_id */
-                lua_pushinteger(L, data);           /* + arg_id  */
-                lua_pushboolean(L, 1);              /* + false.  */
-                lua_pushlightuserdata(L, owner);    /* + owner   */
-                
-                /* Call Lua function. */
-                extern int errfunc_index;
-                if (lua_pcall(L, 4, 0, errfunc_index))
-                        fatal_error("[Lua] %s", lua_tostring(L, -1));
+                L_callback_push(L, func);           /* + func  */
+                L_push_object(L, owner);            /* + owner */
+                L_callback_call(L, func, data, 1, 1, 0);
 #else
                 abort();
 #endif
@@ -6,6 +6,7 @@
 #include "property.h"
 #include "timer.h"
 #include "grid.h"
+#include "handle.h"
 #include "uthash_tuned.h"
 
 struct Tile_t;
@@ -21,6 +22,7 @@ typedef struct {
         Property *pos;
         vect_f   vel;
         intptr_t step_func, step_cb_data;
+        int      step_params;   /* Step function used StepParams. */
 } BodyState;
 #endif  /* TRACE_MAX */
 
@@ -33,6 +35,14 @@ typedef struct {
  * BODY_AFTERSTEP_C     Afterstep function is a C function.
  * BODY_VISITED         Used within world_step() to check for duplicate bodies.
  * BODY_SMOOTH_POS      Do not round body positions during rendering.
+ * BODY_EMITTER         Step function is emitter_step() and step_cb_data points
+ *                      to an Emitter owned by the body (see emitter.h).
+ * BODY_PARKED          Body was recycled and waits on its origin's `parked`
+ *                      list (see body_recycle()).
+ * BODY_TRANSIENT       Body is destroyed (or recycled) once it leaves world
+ *                      bounds (see world_set_bounds()).
+ * BODY_STEP_PARAMS     step_cb_data points to StepParams owned by the body
+ *                      (see stepfunc.h).
  */
 enum {
         BODY_NOCTURNAL   = 1<<1,
@@ -43,11 +53,16 @@ enum {
         BODY_SMOOTH_POS  = 1<<5,
 #endif
         BODY_PAUSED      = 1<<6,
-        BODY_TRACED      = 1<<7
+        BODY_TRACED      = 1<<7,
+        BODY_EMITTER     = 1<<8,
+        BODY_PARKED      = 1<<9,
+        BODY_TRANSIENT   = 1<<10,
+        BODY_STEP_PARAMS = 1<<11
 };
 
 typedef struct Body_t {
         int             objtype;        /* = OBJTYPE_BODY */
+        Handle          handle;         /* Given out to scripts. */
         struct World_t *world;          /* World body belongs to. */
         
         Property        *pos;           /* Offset from parent body. */
@@ -55,6 +70,8 @@ typedef struct Body_t {
         vect_f          acc;            /* Acceleration. */
         vect_f          prevstep_pos;   /* Position in the previous step. */
         unsigned        flags;          /* Misc state. */
+        unsigned        active_index;   /* Index + 1 into world's active body
+                                           array, or zero. */
         
 #if TRACE_MAX
         /* Remember previous body states to be able to rewind time. */
@@ -84,9 +101,25 @@ typedef struct Body_t {
         /* Children list. */
         struct Body_t   *parent, *children;
         struct Body_t   *prev, *next;
-#if !ALL_NOCTURNAL
+        
+        /*
+         * World's nocturnal list holds bodies that are stepped even if they
+         * are far from cameras (see body_update_nocturnal()).
+         */
+        unsigned        wake_step;      /* Stay awake until this step. */
         struct Body_t   *nocturnal_prev, *nocturnal_next;
-#endif
+        
+        /* World's list of transient bodies (see body_update_transient()). */
+        struct Body_t   *transient_prev, *transient_next;
+        
+        /*
+         * Clones remember the body they were cloned from (`origin`) and sit on
+         * its `clones` list. Recycled clones move to its `parked` list, where
+         * body_reuse() finds them.
+         */
+        struct Body_t   *origin;
+        struct Body_t   *clones, *parked;
+        struct Body_t   *clone_prev, *clone_next;
 } Body;
 
 /* Step function types. */
@@ -101,13 +134,18 @@ vect_f   body_absolute_pos(Body *b);
 void     body_set_pos(Body *b, vect_f pos);
 void     body_anim_pos(Body *b, uint8_t type, vect_f end, float duration,
                        float start_time);
+void     body_anim_path(Body *b, PropPath *path, float start_time);
 
 /* Lifetime. */
 void     body_init(Body *b, Body *parent, struct World_t *world, vect_f pos,
                    unsigned flags);
 Body    *body_new(Body *parent, vect_f pos, unsigned flags);
-Body    *body_clone(const Body *orig);
+Body    *body_clone(Body *parent, Body *orig);
+void     body_detach(Body *b);
+void     body_recycle(Body *b);
+Body    *body_reuse(Body *parent, Body *orig);
 void     body_destroy(Body *b);
+void     body_release(Body *b);
 void     body_free(Body *b);
 
 /* Recording trace. */
@@ -120,7 +158,18 @@ void     body_pause(Body *b);
 #define  body_active(b) (!((b)->flags & BODY_PAUSED))
 void     body_resume(Body *b);
 
+/* Sleeping. */
+#define  body_nocturnal(b) ((b)->nocturnal_prev != NULL)
+void     body_update_nocturnal(Body *b);
+void     body_wake(Body *b, float duration);
+
+/* Culling. */
+#define  body_transient(b) ((b)->transient_prev != NULL)
+void     body_update_transient(Body *b);
+BB       body_world_bb(Body *b);
+
 /* Step function and timers. */
+void     body_set_step(Body *b, intptr_t func, intptr_t data, unsigned flags);
 void     body_step(Body *b, lua_State *L, void *script_ptr);
 void     body_afterstep(Body *b, lua_State *L, void *script_ptr);
 
@@ -48,7 +48,7 @@ typedef struct Group_t {
 typedef struct {
         Shape           *shape_A, *shape_B;     /* Shapes involved in collision: Used as combined hash key. */
         Handler         handler;                /* Collision handler function. */
-        Group           *group_A, *group_B;     /* Both involved collision groups. */
+        Handle          handle_A, handle_B;     /* Tell if shapes still exist. */
         
         int             active;                 /* True if shapes are colliding in current step. */
         int             ignore;                 /* True if user requested that no further callbacks be invoked. */
@@ -61,7 +61,8 @@ enum ObjType {
         OBJTYPE_WORLD,
         OBJTYPE_TIMER_LUA,
         OBJTYPE_TIMER_C,
-        OBJTYPE_TIMERPTR
+        OBJTYPE_TIMERPTR,
+        OBJTYPE_TIMER_TASK
 };
 
 /* Suppress unused parameter warning in debug mode. */
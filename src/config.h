@@ -36,6 +36,8 @@ struct Config {
         uint32_t        defaultShapeColor;
         char            version[10];      /* Engine version. */
         char            location[128];    /* User application location path. */
+        char            texture_cache[128]; /* Cache file ("" if none). */
+        char            manifest[128];    /* Asset manifest ("" if none). */
         char            name[16];         /* User application name. */
         
         /*
@@ -67,7 +69,15 @@ struct Config {
         int             collision_dist;
         float           cam_vicinity_factor;
         
-        /* Memory pool sizes. */
+        /*
+         * Memory pool sizes. Pools grow by this many records when they run
+         * out; if pool_trim is true, memory from pool growth is released again
+         * whenever a world is destroyed. Body, tile, shape, timer, gridcell,
+         * and collision pools are set up for each world separately.
+         */
+        int             pool_trim;
+        int             pool_quarantine;  /* See mem_quarantine in mem.h. */
+        int             pool_report;      /* Print pool usage on exit. */
         struct poolsize_t {
                 int world;
                 int body;
@@ -81,6 +91,8 @@ struct Config {
                 int gridcell;
                 int property;
                 int collision;
+                int emitter;
+                int stepparams;
                 int touch;
                 int hackevent;
                 int bodytrace;
@@ -8,6 +8,7 @@
 #include <lualib.h>
 #include "config.h"
 #include "log.h"
+#include "mem.h"
 #include "misc.h"
 #include "util_lua.h"
 #include "assert_lua.h"
@@ -90,10 +91,23 @@ cfg_read(const char *filename)
         config.window_width = cfg_get_int("windowWidth");
         config.window_height = cfg_get_int("windowHeight");
         
+        if (cfg_has_key("texcache")) {
+                cfg_get_cstr("texcache", config.texture_cache,
+                             sizeof(config.texture_cache));
+        }
+        if (cfg_has_key("manifest")) {
+                cfg_get_cstr("manifest", config.manifest,
+                             sizeof(config.manifest));
+        }
+        
         config.collision_dist = cfg_get_int("collision_dist");
         config.cam_vicinity_factor = cfg_get_float("cam_vicinity_factor");
         
         /* Read pool sizes. */
+        config.pool_trim = GET_CFG("pooltrim", cfg_get_bool, 0);
+        config.pool_report = GET_CFG("poolreport", cfg_get_bool, 0);
+        config.pool_quarantine = GET_CFG("poolquarantine", cfg_get_bool,
+                                         MEM_QUARANTINE);
         lua_getfield(cfg_L, cfg_index, "poolsize");
         if (!lua_istable(cfg_L, -1))
                 fatal_error("config.lua: missing 'poolsize' table.");
@@ -109,6 +123,8 @@ cfg_read(const char *filename)
         SET_POOLSIZE(gridcell);
         SET_POOLSIZE(property);
         SET_POOLSIZE(collision);
+        SET_POOLSIZE(emitter);
+        SET_POOLSIZE(stepparams);
 #if ENABLE_TOUCH
         SET_POOLSIZE(touch);
         SET_POOLSIZE(hackevent);
@@ -9,6 +9,7 @@
 #include <sqlite3.h>
 #include "config.h"
 #include "log.h"
+#include "mem.h"
 #include "misc.h"
 
 extern sqlite3 *db;
@@ -45,6 +46,7 @@ cfg_read(const char *source_table)
         config.window_height = 320;
         config.download_update = 0;
         
+        config.pool_quarantine = MEM_QUARANTINE;
         config.grid_info = 0;
         config.grid_expand = 0;
         config.grid_many = 10;
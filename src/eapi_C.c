@@ -267,7 +267,7 @@ NewWorld(const char *name, unsigned step, BB area, unsigned cellsz,
          unsigned trace_skip)
 {
         info_assert(L, area.l < area.r && area.b < area.t, "Invalid area box.");
-        return world_new(name, step, area, cellsz, trace_skip);
+        return world_new(name, step, area, cellsz, trace_skip, 0);
 }
 
 /*
@@ -392,8 +392,8 @@ NewCamera(World *world, vect_f pos, const vect_i *size_arg,
  * rect         Shape rectangle.
  * groupName    Name of collision group this shape will belong to.
  *
- * Note: Presently only rectangular shapes are supported, but there are some
- * distant plans to support circle shapes too.
+ * Note: Only rectangular shapes can be created here. Circles are available
+ * through Lua's eapi.NewShape().
  */
 Shape *
 NewShape(void *parent, vect_f offset, BB rect, const char *groupName)
@@ -507,7 +507,8 @@ NewTileCentered(void *parent, vect_f offset, const vect_f *size, SpriteList *spr
  *
  * img          Image file name (e.g., "image/hello.png").
  * flags        Flags affect texture behavior.
- *              Use TEXFLAG_FILTER to get filtered textures.
+ *              Use TEXFLAG_FILTER to get filtered textures, and one of the
+ *              format hints (e.g., TEXFLAG_RGB565) to use less video memory.
  * subimage     A rectangular subimage specification in bounding box form.
  *
  * The function accepts multiple sub-image bounding box pointers. The last
@@ -1250,6 +1251,8 @@ void
 SetShape(Shape *s, BB bb)
 {
         valid_shape(L, s);
+        info_assert(L, s->shape_type == SHAPE_RECTANGLE,
+                    "Only rectangle shapes can be set from a box.");
         shape_set_def(s, (ShapeDef){.rect=bb});
 }
 
@@ -1266,11 +1269,23 @@ void
 SetStep(void *obj, StepFunction sf, intptr_t data)
 {
         Body *b = get_body(L, obj);
-        
-        /* Set step/after-step function. */
-        b->flags |= BODY_STEP_C;
-        b->step_func = (intptr_t)sf;
-        b->step_cb_data = data;
+        info_assert(L, !(b->flags & BODY_EMITTER), "Cannot change emitter "
+                    "step function.");
+        body_set_step(b, (intptr_t)sf, data, BODY_STEP_C);
+}
+
+/*
+ * Set one of the parameterized native step functions (see stepfunc.h). Object
+ * gets its own copy of `params`.
+ */
+void
+SetStepParams(void *obj, StepFunction sf, const StepParams *params)
+{
+        Body *b = get_body(L, obj);
+        info_assert(L, !(b->flags & BODY_EMITTER), "Cannot change emitter "
+                    "step function.");
+        body_set_step(b, (intptr_t)sf, (intptr_t)stepparams_copy(params),
+                      BODY_STEP_C | BODY_STEP_PARAMS);
 }
 
 /*
@@ -1403,6 +1418,8 @@ void
 AnimateShape(Shape *s, uint8_t type, BB end, float duration, float start_time)
 {
         valid_shape(L, s);
+        info_assert(L, s->shape_type == SHAPE_RECTANGLE,
+                    "Only rectangle shapes can be animated.");
         shape_anim_def(s, type, (ShapeDef){ .rect = end }, duration, start_time);
 }
 
@@ -1504,8 +1521,7 @@ AddTimer(void *obj, float when, TimerFunction func, intptr_t data)
                                     (intptr_t)func, data);
         return (TimerPtr){
                 .objtype=OBJTYPE_TIMERPTR,
-                .ptr=tmr,
-                .timer_id=tmr->timer_id
+                .handle=tmr->handle
         };
 }
 
@@ -1519,30 +1535,31 @@ CancelTimer(TimerPtr *timer_ptr)
         if (!Alive(timer_ptr))
                 return;
         
-        void *owner = timer_ptr->ptr->owner;
+        Timer *timer = handle_get(timer_ptr->handle);
+        void *owner = timer->owner;
         switch (*(int *)owner) {
         case OBJTYPE_BODY: {
                 valid_body(L, owner);
-                body_cancel_timer(owner, timer_ptr->ptr);
+                body_cancel_timer(owner, timer);
                 break;
         }
         case OBJTYPE_WORLD: {
                 World *world = owner;
                 valid_world(L, world);
-                body_cancel_timer(&world->static_body, timer_ptr->ptr);
+                body_cancel_timer(&world->static_body, timer);
                 break;
         }
         case OBJTYPE_CAMERA: {
                 Camera *cam = owner;
                 valid_camera(L, cam);
-                body_cancel_timer(&cam->body, timer_ptr->ptr);
+                body_cancel_timer(&cam->body, timer);
                 break;
         }
         default:
                 objtype_error(L, owner);
         }
         
-        timer_ptr->ptr = NULL;
+        timer_ptr->handle = 0;
 }
 
 /*
@@ -1617,17 +1634,12 @@ Alive(void *obj)
                 assert(valid_timerptr(timer_ptr));
                 
                 /*
-                 * If timer pointer is NULL or timer ID is zero, then timer is
-                 * not alive.
-                 */
-                if (timer_ptr->ptr == NULL || timer_ptr->timer_id == 0)
-                        return 0;
-                /*
-                 * If timer memory has been cleared (owner == NULL) or timer IDs
-                 * do not match (memory reused), then timer is not alive.
+                 * Timer is not alive once its handle has gone stale (timer
+                 * executed, cancelled, or its world destroyed). The Timer
+                 * itself is not looked at: its memory may be gone.
                  */
-                if (timer_ptr->ptr->owner == NULL || timer_ptr->timer_id != timer_ptr->ptr->timer_id) {
-                        memset(timer_ptr, 0, sizeof(*timer_ptr));
+                if (handle_get(timer_ptr->handle) == NULL) {
+                        timer_ptr->handle = 0;
                         return 0;
                 }
                 return 1;
@@ -1811,10 +1823,13 @@ Collide(World *w, const char *groupname_a, const char *groupname_b,
         assert(w->handler_map[groupB->index][groupA->index].type == HANDLER_NONE);
         
         /* Each group remembers how many handlers we have registered for it. */
-        if (handler->func == 0 && cf != NULL)
-                groupA->num_handlers++;
-        else if (handler->func != 0 && cf == NULL)
-                groupA->num_handlers--;
+        if (handler->func == 0 && cf != NULL) {
+                if (groupA->num_handlers++ == 0)
+                        world_group_changed(w, groupA);
+        } else if (handler->func != 0 && cf == NULL) {
+                if (--groupA->num_handlers == 0)
+                        world_group_changed(w, groupA);
+        }
         
         /* Set handler data. */
         handler->type = HANDLER_C;
@@ -1903,14 +1918,13 @@ Clear(void)
         }
 #ifndef NDEBUG
         /* Certain pools should be empty at this point. */
-        extern mem_pool mp_body, mp_camera, mp_group, mp_collision, mp_gridcell;
-        extern mem_pool mp_property;
-        assert(mp_first(&mp_gridcell) == NULL);
-        assert(mp_first(&mp_collision) == NULL);
-        assert(mp_first(&mp_body) == NULL);
+        extern mem_pool mp_camera, mp_group, mp_property, mp_emitter;
+        extern mem_pool mp_stepparams;
         assert(mp_first(&mp_camera) == NULL);
         assert(mp_first(&mp_group) == NULL);
         assert(mp_first(&mp_property) == NULL);
+        assert(mp_first(&mp_emitter) == NULL);
+        assert(mp_first(&mp_stepparams) == NULL);
 #if TRACE_MAX
         extern mem_pool mp_bodytrace, mp_tiletrace, mp_shapetrace;
         assert(mp_first(&mp_bodytrace) == NULL);
@@ -1931,9 +1945,11 @@ Quit(void)
 
 /*
  * Sets how many megabytes may be used for texture storage inside video memory.
- * As soon as some new texture exceeds this approximate amount, older textures
- * are unloaded from memory.
- * If limit is set to zero, then all textures are unloaded from memory.
+ * As soon as some new texture exceeds this approximate amount, least recently
+ * used textures are unloaded from memory. They are reloaded in the background
+ * when needed again.
+ * If limit is set to zero, then all textures are unloaded from memory, except
+ * for render targets and those in use during the current frame.
  */
 void
 SetTextureMemoryLimit(unsigned MB)
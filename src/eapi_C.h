@@ -5,6 +5,7 @@
 #include "event.h"
 #include "shape.h"
 #include "spritelist.h"
+#include "stepfunc.h"
 #include "tile.h"
 #include "world.h"
 
@@ -56,6 +57,8 @@ void             SetSpriteList(Tile *tile, SpriteList *spriteList);
 
 /* Set step/after-step functions. */
 void             SetStep(void *obj, StepFunction sf, intptr_t);
+void             SetStepParams(void *obj, StepFunction sf,
+                               const StepParams *params);
 
 /* Shape. */
 void             SetShape(Shape *s, BB bb);
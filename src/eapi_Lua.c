@@ -12,7 +12,9 @@
 #include "config.h"
 #include "console.h"
 #include "event.h"
+#include "gameloop.h"
 #include "log.h"
+#include "manifest.h"
 #include "misc.h"
 #include "texture.h"
 #include "tile.h"
@@ -25,6 +27,7 @@
 #include "render.h"
 #include "OpenGL_include.h"
 #include "stepfunc.h"
+#include "emitter.h"
 
 #ifndef NDEBUG
 
@@ -265,19 +268,19 @@ LUA_BindMouseMove(lua_State *L)
 }
 
 /*
- * MousePos(cam) -> {x=?, y=?}
+ * MousePos(cam, out=nil) -> {x=?, y=?}
+ * MousePosXY(cam) -> x, y
  *
  * Mouse position within world that the given camera belongs to.
  */
 static int
 LUA_MousePos(lua_State *L)
 {
-        L_numarg_range(L, 1, 1);
+        L_numarg_range(L, 1, 2);
         Camera *cam = L_arg_userdata(L, 1);
         valid_camera(L, cam);
         
-        L_push_vectf(L, mouse_pos(cam));
-        return 1;
+        return L_return_vectf(L, mouse_pos(cam), L_arg_out(L, 2));
 }
 
 #endif  /* ENABLE_MOUSE */
@@ -307,7 +310,8 @@ LUA_What(lua_State *L)
 }
 
 /*
- * NewWorld(name, step, grid_area, grid_cellsz, trace_skip=0) -> world
+ * NewWorld(name, step, grid_area, grid_cellsz, trace_skip=0, poolsize=nil)
+ *      -> world
  *
  * Create a new world and return its pointer. World is the topmost data
  * structure (see world.h).
@@ -325,25 +329,31 @@ LUA_What(lua_State *L)
  *                      time, this option allows to skip steps so as to save
  *                      memory space. Leaving `trace_skip` at zero will cause
  *                      each and every step to be recorded.
+ * poolsize             Upper limit on the number of records (bodies, tiles,
+ *                      shapes, etc.) that world's memory pools start out with.
+ *                      Pools grow on demand, so small worlds like overlays can
+ *                      pass a low number instead of paying for the full sizes
+ *                      set in config.lua.
  */
 static int
 LUA_NewWorld(lua_State *L)
 {
-        L_numarg_range(L, 4, 5);
+        L_numarg_range(L, 4, 6);
         const char *name = L_arg_cstr(L, 1);
         unsigned step = L_arg_uint(L, 2);
         BB area = L_arg_BB(L, 3);
         info_assert(L, area.l < area.r && area.b < area.t, "Invalid area box.");
         unsigned cellsz = L_arg_uint(L, 4);
         unsigned trace_skip = L_argdef_uint(L, 5, 0);
+        unsigned pool_hint = L_argdef_uint(L, 6, 0);
         
-        World *w = world_new(name, step, area, cellsz, trace_skip);
+        World *w = world_new(name, step, area, cellsz, trace_skip, pool_hint);
         lua_pushlightuserdata(L, w);
         return 1;
 }
 
 /*
- * NewBody(parent, pos, sleepy=false) -> userdata
+ * NewBody(parent, pos, nocturnal=false) -> userdata
  *
  * Create a new body relative to parent.
  *
@@ -370,12 +380,10 @@ LUA_NewBody(lua_State *L)
         vect_f pos = L_arg_vectf(L, 2);
         
         unsigned flags = 0;
-#if !ALL_NOCTURNAL
         int nocturnal = L_argdef_bool(L, 3, 0);
         if (nocturnal)
                 flags |= BODY_NOCTURNAL;
-#endif
-        lua_pushlightuserdata(L, body_new(get_body(L, parent), pos, flags));
+        L_push_object(L, body_new(get_body(L, parent), pos, flags));
         return 1;
 }
 
@@ -477,16 +485,35 @@ LUA_NewCamera(lua_State *L)
         return 1;
 }
 
+/*
+ * Texture format hint names (see TextureFlags in texture.h).
+ */
+static const struct {
+        const char      *name;
+        unsigned        flag;
+} texture_formats[] = {
+        {"rgba8888",    0},
+        {"rgb565",      TEXFLAG_RGB565},
+        {"rgba4444",    TEXFLAG_RGBA4444},
+        {"la88",        TEXFLAG_LA88},
+        {"compressed",  TEXFLAG_COMPRESS}
+};
+
 /*
  * Parse texture specification argument. It can either be a string:
  *      "path/to/image"
- * or a table containing texture file name string and (optional) filter
- * attribute:
- *      {"path/to/image", filter=true/false}
+ * or a table containing texture file name string and (optional) filter,
+ * intensity and format attributes:
+ *      {"path/to/image", filter=true/false, format="rgb565"}
+ *
+ * Format is a hint on how to store the texture in video memory: "rgba8888"
+ * (default), "rgb565", "rgba4444", "la88" (grayscale with alpha), or
+ * "compressed". The first request for an image decides its format.
  *
  * As an example, these are all valid texture specifications:
  *      {"image/player.png"}
  *      {"image/clouds.jpg", filter=true}
+ *      {"image/blue-clouds.png", format="rgb565"}
  *      "menu.png"
  */
 static void
@@ -518,6 +545,20 @@ get_texture_spec(lua_State *L, int index, char *name, unsigned bufsize,
                 info_assert(L, lua_isnil(L, -1) || lua_isboolean(L, -1),
                             "`intensity` flag should be a boolean value.");
                 SETFLAG(*flags, TEXFLAG_INTENSITY, lua_toboolean(L, -1));
+                L_get_strfield(L, index, "format");
+                if (!lua_isnil(L, -1)) {
+                        info_assert(L, lua_isstring(L, -1), "`format` should "
+                                    "be a string.");
+                        const char *format = lua_tostring(L, -1);
+                        unsigned i, n = ARRAYSZ(texture_formats);
+                        for (i = 0; i < n; i++) {
+                                if (!strcmp(format, texture_formats[i].name))
+                                        break;
+                        }
+                        info_assert_va(L, i < n, "Unknown texture format "
+                                       "`%s`.", format);
+                        *flags |= texture_formats[i].flag;
+                }
                 return;
         }
         }
@@ -715,14 +756,10 @@ LUA_ChopImage(lua_State *L)
  *              a World object, then its static body is used as the actual
  *              parent.
  * offset       Position of shape relative to its body's position.
- * rect         Shape rectangle.
+ * shapeTbl     Shape definition, either a rectangle or a circle:
+ *                      Rectangle: {l=?, r=?, b=?, t=?}
+ *                      Circle:    {{centerX, centerY}, radius}
  * groupName    Name of collision group this shape will belong to.
- *
- * Note: Presently only rectangular shapes are supported, but there are some
- * distant plans to support circle shapes too.
- *
- * Circle:  {{centerX, centerY}, radius}
- * Rectangle: {l=?, r=?, b=?, t=?}
  */
 static int
 LUA_NewShape(lua_State *L)
@@ -730,8 +767,42 @@ LUA_NewShape(lua_State *L)
         L_numarg_range(L, 4, 4);
         void *parent = L_arg_userdata(L, 1);
         vect_f offset = L_argdef_vectf(L, 2, (vect_f){0,0});
-        BB rect = L_arg_BB(L, 3);
-        info_assert(L, bb_valid(rect), "Shape rectangle invalid.");
+        
+        /* Shape definition. Circles have their center as first element. */
+        uint8_t shape_type;
+        ShapeDef def;
+        info_assert(L, lua_istable(L, 3), "Shape table expected.");
+        lua_rawgeti(L, 3, 1);
+        if (lua_istable(L, -1)) {
+                vect_i center = L_getstk_vecti(L, -1);
+                lua_rawgeti(L, 3, 2);
+                info_assert(L, lua_isnumber(L, -1), "Circle radius expected.");
+                int radius = posround(lua_tonumber(L, -1));
+                info_assert(L, radius > 0, "Circle radius must be positive "
+                            "once rounded.");
+                lua_pop(L, 2);
+                
+                shape_type = SHAPE_CIRCLE;
+                def.circle = (Circle){
+                        .radius = radius,
+                        .offset = {
+                                center.x + posround(offset.x),
+                                center.y + posround(offset.y)
+                        }
+                };
+        } else {
+                lua_pop(L, 1);
+                BB rect = L_arg_BB(L, 3);
+                info_assert(L, bb_valid(rect), "Shape rectangle invalid.");
+                
+                shape_type = SHAPE_RECTANGLE;
+                def.rect = (BB){
+                        .l=rect.l + offset.x,
+                        .r=rect.r + offset.x,
+                        .b=rect.b + offset.y,
+                        .t=rect.t + offset.y
+                };
+        }
         const char *groupName = L_arg_cstr(L, 4);
         
         /* Extract body pointer. */
@@ -758,21 +829,11 @@ LUA_NewShape(lua_State *L)
                 HASH_ADD_STR(world->groups, name, group);
         }
         
-        /* Shape definition. */
-        ShapeDef def = {
-                .rect = {
-                        .l=rect.l + offset.x,
-                        .r=rect.r + offset.x,
-                        .b=rect.b + offset.y,
-                        .t=rect.t + offset.y
-                }
-        };
-        
         /* Create shape. */
-        Shape *s = shape_new(body, group, SHAPE_RECTANGLE, def);
+        Shape *s = shape_new(body, group, shape_type, def);
         s->color = config.defaultShapeColor;
                         
-        lua_pushlightuserdata(L, s);
+        L_push_object(L, s);
         return 1;
 }
 
@@ -913,13 +974,13 @@ LUA_NewTile(lua_State *L)
         /* Call SetSpriteList(). */
         if (sprite_list != NULL) {
                 lua_pushcfunction(L, LUA_SetSpriteList);
-                lua_pushlightuserdata(L, t);
+                L_push_object(L, t);
                 lua_pushlightuserdata(L, sprite_list);
                 lua_call(L, 2, 0);
         }
         
         /* Return tile. */
-        lua_pushlightuserdata(L, t);
+        L_push_object(L, t);
         return 1;
 }
 
@@ -941,7 +1002,7 @@ LUA_NewTileCentered(lua_State *L)
         lua_call(L, n, 1);
         
         /* Center tile. */
-        Tile *t = lua_touserdata(L, n + 1);
+        Tile *t = L_arg_userdata(L, n + 1);
         vect_f final_size = GetSize(t);
         vect_f pos = GetPos(t);
         SetPos(t, (vect_f){pos.x - final_size.x/2, pos.y - final_size.y/2});
@@ -963,23 +1024,324 @@ LUA_Clone(lua_State *L)
         switch (*(int *)obj) {
         case OBJTYPE_TILE: {
                 Tile *t = tile_clone(((Tile *)obj)->body, obj);
-                lua_pushlightuserdata(L, t);
+                L_push_object(L, t);
                 return 1;
         }
         case OBJTYPE_SHAPE: {
                 Shape *s = shape_clone(((Shape *)obj)->body, obj);
-                lua_pushlightuserdata(L, s);
+                L_push_object(L, s);
                 return 1;
         }
         case OBJTYPE_BODY: {
-                Body *b = body_clone(obj);
-                lua_pushlightuserdata(L, b);
+                Body *orig = obj;
+                valid_body(L, orig);
+                info_assert(L, orig->parent != NULL, "Cannot clone a static "
+                         "body.");
+                info_assert(L, !(orig->flags & BODY_EMITTER), "Cannot clone "
+                            "an emitter.");
+                L_push_object(L, body_clone(orig->parent, orig));
                 return 1;
         }
         }
         objtype_error(L, obj);
 }
 
+/*
+ * SpawnBatch(parent, template, positions, velocities=nil) -> {body, ...}
+ *
+ * Create many copies of a body in one call. Meant for bullet volleys and
+ * similar bursts where the per-object cost of NewBody(), NewTile(),
+ * NewShape() and SetVel() adds up.
+ *
+ * parent       World, Body or Camera; clones are attached to it.
+ * template     Body to copy. Its tiles, shapes, step functions and flags are
+ *              cloned, exactly as with Reuse(): bodies recycled from
+ *              earlier batches are brought back first.
+ * positions    Array of position vectors (relative to `parent`), one per
+ *              body to create.
+ * velocities   Optional array of velocity vectors, same length as
+ *              `positions`. If given, clones get the standard step function
+ *              unless the template already has one.
+ *
+ * Returns an array of the new bodies, in the same order as `positions`.
+ */
+static int
+LUA_SpawnBatch(lua_State *L)
+{
+        L_numarg_range(L, 3, 4);
+        Body *parent = get_body(L, L_arg_userdata(L, 1));
+        Body *template = L_arg_userdata(L, 2);
+        luaL_checktype(L, 3, LUA_TTABLE);
+        int have_vel = !lua_isnoneornil(L, 4);
+        if (have_vel)
+                luaL_checktype(L, 4, LUA_TTABLE);
+        
+        valid_body(L, template);
+        info_assert(L, !(template->flags & BODY_EMITTER), "Cannot clone an "
+                    "emitter.");
+        info_assert(L, parent->world == template->world, "Template body and "
+                 "parent must belong to the same world.");
+        
+        int count = lua_objlen(L, 3);
+        info_assert_va(L, !have_vel || (int)lua_objlen(L, 4) == count,
+                    "Got %d positions but %d velocities.", count,
+                    (int)lua_objlen(L, 4));
+        
+        /*
+         * Read all vectors into Lua-owned scratch memory first, so that a bad
+         * one raises an error before any body has been created.
+         */
+        vect_f *pos = lua_newuserdata(L, (have_vel ? 2 : 1) * count *
+                                      sizeof(vect_f));  /* ... scratch */
+        vect_f *vel = pos + count;
+        for (int i = 0; i < count; i++) {
+                lua_rawgeti(L, 3, i + 1);               /* + pos */
+                pos[i] = L_arg_vectf(L, lua_gettop(L));
+                lua_pop(L, 1);
+                if (have_vel) {
+                        lua_rawgeti(L, 4, i + 1);       /* + vel */
+                        vel[i] = L_arg_vectf(L, lua_gettop(L));
+                        lua_pop(L, 1);
+                }
+        }
+        
+        lua_createtable(L, count, 0);           /* ... scratch bodies */
+        for (int i = 0; i < count; i++) {
+                Body *b = body_reuse(parent, template);
+                body_set_pos(b, pos[i]);
+                b->prevstep_pos = pos[i];
+                
+                if (have_vel) {
+                        b->vel = vel[i];
+                        
+                        /* Set standard step function if not already set. */
+                        if (b->step_func == 0) {
+                                b->step_func = (intptr_t)stepfunc_std;
+                                b->flags |= BODY_STEP_C;
+                        }
+                }
+                L_push_object(L, b);            /* ... bodies b */
+                lua_rawseti(L, -2, i + 1);      /* ... bodies */
+        }
+        return 1;
+}
+
+/*
+ * Recycle(body)
+ *
+ * Take a body out of play like Destroy() does, but keep it around, fully
+ * constructed, so that Reuse() can bring it back cheaply. Only clones (see
+ * Clone(), SpawnBatch(), Reuse()) are kept; other bodies are destroyed.
+ * Recycled bodies must not be used until Reuse() returns them again.
+ */
+static int
+LUA_Recycle(lua_State *L)
+{
+        L_numarg_range(L, 1, 1);
+        Body *body = L_arg_userdata(L, 1);
+        
+        valid_body(L, body);
+        info_assert(L, body->parent != NULL, "Cannot recycle a static body.");
+        info_assert(L, !(body->flags & BODY_PARKED), "Body already "
+                    "recycled.");
+        body_recycle(body);
+        return 0;
+}
+
+/*
+ * Reuse(template, parent=nil, pos=nil, vel=nil) -> body
+ *
+ * Same as Clone(template), except that a recycled clone of `template` is
+ * brought back if one is available (see Recycle()). Its position, velocity,
+ * animations, and step functions are reset to those of the template.
+ *
+ * parent       World, Body or Camera to attach to. Default is template's own
+ *              parent.
+ * pos          Position to place the body at instead of template's.
+ * vel          Velocity (sets the standard step function unless the template
+ *              has one).
+ */
+static int
+LUA_Reuse(lua_State *L)
+{
+        L_numarg_range(L, 1, 4);
+        Body *template = L_arg_userdata(L, 1);
+        valid_body(L, template);
+        info_assert(L, template->parent != NULL, "Cannot reuse a static "
+                    "body.");
+        info_assert(L, !(template->flags & (BODY_EMITTER | BODY_PARKED)),
+                    "Cannot reuse an emitter or a recycled body.");
+        
+        Body *parent = template->parent;
+        if (!lua_isnoneornil(L, 2))
+                parent = get_body(L, L_arg_userdata(L, 2));
+        info_assert(L, parent->world == template->world, "Template body and "
+                    "parent must belong to the same world.");
+        
+        /* Read remaining arguments before bringing a body back. */
+        int has_pos = !lua_isnoneornil(L, 3);
+        int has_vel = !lua_isnoneornil(L, 4);
+        vect_f pos = has_pos ? L_arg_vectf(L, 3) : (vect_f){0.0, 0.0};
+        vect_f vel = has_vel ? L_arg_vectf(L, 4) : (vect_f){0.0, 0.0};
+        
+        Body *b = body_reuse(parent, template);
+        if (has_pos) {
+                body_set_pos(b, pos);
+                b->prevstep_pos = pos;
+        }
+        if (has_vel) {
+                b->vel = vel;
+                
+                /* Set standard step function if not already set. */
+                if (b->step_func == 0) {
+                        b->step_func = (intptr_t)stepfunc_std;
+                        b->flags |= BODY_STEP_C;
+                }
+        }
+        L_push_object(L, b);
+        return 1;
+}
+
+/*
+ * Read emitter pattern fields present in table at `index` into `p`, then
+ * validate it. Missing fields keep their values. On error `p` is left partly
+ * updated, so pass a copy rather than the pattern of a running emitter.
+ */
+static void
+get_emitter_pattern(lua_State *L, int index, EmitterPattern *p)
+{
+#define PATTERN_FIELD(name, member, getter)                     \
+do {                                                            \
+        L_get_strfield(L, index, (name));                       \
+        if (!lua_isnil(L, -1))                                  \
+                p->member = getter(L, lua_gettop(L));           \
+        lua_pop(L, 1);                                          \
+} while (0)
+        PATTERN_FIELD("count",     count,     L_arg_uint);
+        PATTERN_FIELD("arc",       arc,       L_arg_float);
+        PATTERN_FIELD("angle",     angle,     L_arg_float);
+        PATTERN_FIELD("spin",      spin,      L_arg_float);
+        PATTERN_FIELD("amplitude", amplitude, L_arg_float);
+        PATTERN_FIELD("frequency", frequency, L_arg_float);
+        PATTERN_FIELD("rate",      rate,      L_arg_float);
+        PATTERN_FIELD("speed",     speed,     L_arg_float);
+        PATTERN_FIELD("accel",     accel,     L_arg_float);
+        PATTERN_FIELD("lifetime",  lifetime,  L_arg_float);
+        PATTERN_FIELD("volleys",   volleys,   L_arg_uint);
+#undef PATTERN_FIELD
+        
+        /* Aim point; `false` turns aiming off. */
+        L_get_strfield(L, index, "aim");                /* + aim */
+        if (lua_istable(L, -1)) {
+                p->aim = L_arg_vectf(L, lua_gettop(L));
+                p->aimed = 1;
+        } else if (!lua_isnil(L, -1)) {
+                p->aimed = lua_toboolean(L, -1);
+                info_assert(L, !p->aimed, "Aim must be a vector or false.");
+        }
+        lua_pop(L, 1);
+        
+        info_assert(L, p->count > 0, "Emitter count must be positive.");
+        info_assert(L, p->rate > 0.0, "Emitter rate must be positive.");
+        info_assert(L, p->lifetime >= 0.0, "Negative bullet lifetime.");
+}
+
+/*
+ * NewEmitter(parent, bullet, pattern, pos={0, 0}) -> body
+ *
+ * Create a body that fires bullets on its own, without running any Lua code.
+ *
+ * parent       World, Body or Camera the emitter is attached to (so it moves
+ *              along with it).
+ * bullet       Template body with tiles and shapes: every bullet is a clone of
+ *              it. The emitter takes ownership of this body: it disappears
+ *              from the world, and is destroyed together with the emitter.
+ *              Do not use it afterwards.
+ * pattern      Table describing the bullet pattern:
+ *                type=eapi.EMITTER_RING     Preset; one of EMITTER_RING,
+ *                                           EMITTER_SPIRAL, EMITTER_SPREAD,
+ *                                           EMITTER_WAVE. Presets only
+ *                                           provide defaults for the fields
+ *                                           below.
+ *                count=?       Bullets per volley.
+ *                arc=?         Angle a volley is spread across (2*pi
+ *                              spaces bullets evenly around a circle).
+ *                angle=0       Base direction.
+ *                spin=0        Added to base direction after each volley.
+ *                amplitude=0   Amplitude of sine sweep of base direction.
+ *                frequency=0   Sweep frequency (Hz).
+ *                rate=?        Volleys per second.
+ *                speed=100     Initial bullet speed.
+ *                accel=0       Bullet acceleration along its direction.
+ *                lifetime=0    Seconds until bullet is destroyed (0 =
+ *                              never).
+ *                volleys=0     Stop after this many volleys (0 = never).
+ *                aim={x,y}     Absolute point to aim base direction at.
+ * pos          Emitter position relative to parent.
+ *
+ * Angles are in radians. Bullets are attached to the world's static body, and
+ * get the standard step function unless the template has its own. Register
+ * collision handlers for the template's shape groups to find out what they
+ * hit. Destroy the returned body to stop the emitter.
+ */
+static int
+LUA_NewEmitter(lua_State *L)
+{
+        L_numarg_range(L, 3, 4);
+        Body *parent = get_body(L, L_arg_userdata(L, 1));
+        Body *bullet = L_arg_userdata(L, 2);
+        info_assert(L, lua_istable(L, 3), "Pattern table expected.");
+        vect_f pos = L_argdef_vectf(L, 4, (vect_f){0.0, 0.0});
+        
+        valid_body(L, bullet);
+        info_assert(L, bullet->parent != NULL && bullet->children == NULL,
+                    "Bullet template must be a non-static body without "
+                    "children.");
+        info_assert(L, !(bullet->flags & BODY_EMITTER), "Bullet template "
+                    "cannot be an emitter.");
+        info_assert(L, parent != bullet, "Emitter cannot be attached to its "
+                    "own bullet template.");
+        info_assert(L, parent->world == bullet->world, "Bullet template and "
+                    "parent must belong to the same world.");
+        
+        /* Start from preset defaults, then apply the rest of the fields. */
+        L_get_strfield(L, 3, "type");                   /* + type */
+        int type = L_argdef_int(L, lua_gettop(L), EMITTER_RING);
+        lua_pop(L, 1);
+        info_assert_va(L, type >= EMITTER_RING && type <= EMITTER_WAVE,
+                       "Invalid emitter type (%d).", type);
+        EmitterPattern pattern;
+        emitter_pattern_init(&pattern, type);
+        get_emitter_pattern(L, 3, &pattern);
+        
+        Body *body = body_new(parent, pos, 0);
+        emitter_new(body, bullet, &pattern);
+        L_push_object(L, body);
+        return 1;
+}
+
+/*
+ * SetEmitter(emitter, pattern)
+ *
+ * Change emitter pattern (see NewEmitter()). Only fields present in `pattern`
+ * are changed; `type` is ignored. Typically used to update `aim`.
+ */
+static int
+LUA_SetEmitter(lua_State *L)
+{
+        L_numarg_range(L, 2, 2);
+        Body *body = L_arg_userdata(L, 1);
+        info_assert(L, lua_istable(L, 2), "Pattern table expected.");
+        
+        valid_body(L, body);
+        info_assert(L, body->flags & BODY_EMITTER, "Body is not an emitter.");
+        Emitter *em = (Emitter *)body->step_cb_data;
+        EmitterPattern pattern = em->pattern;
+        get_emitter_pattern(L, 2, &pattern);
+        em->pattern = pattern;
+        return 0;
+}
+
 /*
  * Get the world that object belongs to. If object is a world itself, return it.
  */
@@ -1032,27 +1394,27 @@ LUA_GetBody(lua_State *L)
         switch (*(int *)obj) {
         case OBJTYPE_WORLD: {
                 valid_world(L, obj);
-                lua_pushlightuserdata(L, &((World *)obj)->static_body);
+                L_push_object(L, &((World *)obj)->static_body);
                 return 1;
         }
         case OBJTYPE_TILE: {
                 valid_tile(L, obj);
-                lua_pushlightuserdata(L, ((Tile *)obj)->body);
+                L_push_object(L, ((Tile *)obj)->body);
                 return 1;
         }
         case OBJTYPE_SHAPE: {
                 valid_shape(L, obj);
-                lua_pushlightuserdata(L, ((Shape *)obj)->body);
+                L_push_object(L, ((Shape *)obj)->body);
                 return 1;
         }
         case OBJTYPE_BODY: {
                 valid_body(L, obj);
-                lua_pushlightuserdata(L, obj);
+                L_push_object(L, obj);
                 return 1;
         }
         case OBJTYPE_CAMERA: {
                 valid_camera(L, obj);
-                lua_pushlightuserdata(L, &((Camera *)obj)->body);
+                L_push_object(L, &((Camera *)obj)->body);
                 return 1;
         }
         }
@@ -1076,14 +1438,15 @@ LUA_GetTiles(lua_State *L)
         int num_tiles = 0;
         DL_FOREACH(body->tiles, t) {
                 lua_pushinteger(L, ++num_tiles);
-                lua_pushlightuserdata(L, t);
+                L_push_object(L, t);
                 lua_rawset(L, -3);
         }
         return 1;
 }
 
 /*
- * Get shape definition in world coordinate space.
+ * Get shape definition in world coordinate space. Rectangles are returned as
+ * {l=?, r=?, b=?, t=?}, circles as {{centerX, centerY}, radius}.
  */
 static int
 LUA_GetShape(lua_State *L)
@@ -1094,9 +1457,19 @@ LUA_GetShape(lua_State *L)
         
         /* Get absolute position of shape's parent body. */
         vect_f pos = GetAbsolutePos(s->body);
- 
-        assert(s->shape_type == SHAPE_RECTANGLE);
+        
         ShapeDef def = shape_def(s);
+        if (s->shape_type == SHAPE_CIRCLE) {
+                lua_createtable(L, 2, 0);
+                L_push_vectf(L, (vect_f){def.circle.offset.x + pos.x,
+                                         def.circle.offset.y + pos.y});
+                lua_rawseti(L, -2, 1);
+                lua_pushnumber(L, def.circle.radius);
+                lua_rawseti(L, -2, 2);
+                return 1;
+        }
+        
+        assert(s->shape_type == SHAPE_RECTANGLE);
         def.rect.l += pos.x;
         def.rect.r += pos.x;
         def.rect.b += pos.y;
@@ -1199,24 +1572,93 @@ LUA_SetZoom(lua_State *L)
 }
 
 /*
- * SetStepC(obj, C_Function, argID)
+ * Read target body argument of a native step function; return its handle.
+ */
+static Handle
+step_target_arg(lua_State *L, int index, Body *body)
+{
+        Body *target = L_argdef_userdata(L, index, NULL);
+        if (target == NULL)
+                return 0;
+        valid_body(L, target);
+        UNUSED(body);           /* Only checked in debug builds. */
+        info_assert(L, target->world == body->world && target != body,
+                    "Invalid step function target.");
+        return target->handle;
+}
+
+/*
+ * Read the arguments of parameterized step function `sf` (see stepfunc.c for
+ * what they mean), starting at stack index 3. Return NULL if `sf` takes no
+ * parameters.
+ */
+static StepParams *
+get_step_params(lua_State *L, StepFunction sf, Body *body)
+{
+        StepParams p = {0};
+        if (sf == stepfunc_rot) {
+                L_numarg_range(L, 3, 5);
+                p.u.rot.dvel = L_arg_float(L, 3);
+                p.u.rot.ivel = L_argdef_float(L, 4, 0.0);
+                p.u.rot.mult = L_argdef_float(L, 5, 1.0);
+                info_assert(L, p.u.rot.mult > 0.0 && p.u.rot.mult <= 1.0,
+                            "Acceleration multiplier out of range.");
+        } else if (sf == stepfunc_homing) {
+                L_numarg_range(L, 4, 5);
+                p.u.homing.target = step_target_arg(L, 3, body);
+                p.u.homing.turn = L_arg_float(L, 4);
+                p.u.homing.speed = L_argdef_float(L, 5, 0.0);
+                info_assert(L, p.u.homing.turn >= 0.0 &&
+                            p.u.homing.speed >= 0.0, "Negative turn rate or "
+                            "speed.");
+        } else if (sf == stepfunc_sine) {
+                L_numarg_range(L, 4, 5);
+                p.u.sine.amplitude = L_arg_float(L, 3);
+                p.u.sine.frequency = L_arg_float(L, 4);
+                p.u.sine.phase = L_argdef_float(L, 5, 0.0);
+        } else if (sf == stepfunc_orbit) {
+                L_numarg_range(L, 3, 4);
+                p.u.orbit.angvel = L_arg_float(L, 3);
+                p.u.orbit.radius = L_argdef_float(L, 4, 0.0);
+                info_assert(L, p.u.orbit.radius >= 0.0, "Negative radius.");
+        } else if (sf == stepfunc_drag) {
+                L_numarg_range(L, 3, 3);
+                p.u.drag.k = L_arg_float(L, 3);
+                info_assert(L, p.u.drag.k >= 0.0, "Negative drag.");
+        } else if (sf == stepfunc_chase) {
+                L_numarg_range(L, 3, 5);
+                p.u.chase.lag = L_arg_float(L, 3);
+                p.u.chase.target = step_target_arg(L, 4, body);
+                p.u.chase.offset = L_argdef_vectf(L, 5, (vect_f){0.0, 0.0});
+                info_assert(L, p.u.chase.lag >= 0.0, "Negative lag.");
+        } else {
+                L_numarg_range(L, 2, 2);
+                return NULL;
+        }
+        return stepparams_copy(&p);
+}
+
+/*
+ * SetStepC(obj, C_Function, ...)
  *
  * Set the step function of an object (Body, Camera, World). The function must
- * be a function pointer.
+ * be a function pointer, one of the STEPFUNC_* constants. Any further
+ * arguments are parameters of the step function; they are stored on the C
+ * side, so the step function never has to look them up in Lua.
  */
 static int
 LUA_SetStepC(lua_State *L)
 {
-        L_numarg_range(L, 2, 3);
         void *obj = L_arg_userdata(L, 1);
         StepFunction sf = L_arg_userdata(L, 2);
-        intptr_t arg_id = L_arg_int(L, 3);
         
         /* Set step function. */
         Body *body = get_body(L, obj);
-        body->flags |= BODY_STEP_C;
-        body->step_func = (intptr_t)sf;
-        body->step_cb_data = arg_id;
+        info_assert(L, !(body->flags & BODY_EMITTER), "Cannot change emitter "
+                    "step function.");
+        StepParams *p = get_step_params(L, sf, body);
+        body_set_step(body, (intptr_t)sf, (intptr_t)p,
+                      p ? BODY_STEP_C | BODY_STEP_PARAMS : BODY_STEP_C);
         return 0;
 }
 
@@ -1242,9 +1684,9 @@ LUA_SetStep(lua_State *L)
                 
         /* Set step function. */
         Body *body = get_body(L, obj);
-        body->flags &= ~BODY_STEP_C;
-        body->step_func = sf;
-        body->step_cb_data = argID;
+        info_assert(L, !(body->flags & BODY_EMITTER), "Cannot change emitter "
+                    "step function.");
+        body_set_step(body, sf, argID, 0);
         return 0;
 }
 
@@ -1305,8 +1747,14 @@ LUA_GetStep(lua_State *L)
         else
                 lua_pushinteger(L, body->step_func);
         
-        /* Push user argument index. */
-        lua_pushinteger(L, body->step_cb_data);
+        /*
+         * Push user argument index. Native step function parameters are not
+         * user arguments.
+         */
+        if (body->flags & (BODY_STEP_PARAMS | BODY_EMITTER))
+                lua_pushinteger(L, 0);
+        else
+                lua_pushinteger(L, body->step_cb_data);
         return 2;
 }
 
@@ -1460,6 +1908,227 @@ LUA_Resume(lua_State *L)
         objtype_error(L, obj);
 }
 
+/*
+ * AllowSleep(world, allow=true)
+ *
+ * If allowed, bodies far from all cameras of this world go to sleep: their step
+ * functions, timers, and collision handlers are not run until a camera comes
+ * near or they are woken up (see WakeUp()). Nocturnal bodies never sleep.
+ * Bodies are found by their shapes, so bodies without shapes never sleep
+ * either.
+ */
+static int
+LUA_AllowSleep(lua_State *L)
+{
+        L_numarg_range(L, 1, 2);
+        World *world = L_arg_userdata(L, 1);
+        valid_world(L, world);
+        world->allow_sleep = L_argdef_bool(L, 2, 1);
+        return 0;
+}
+
+/*
+ * WakeUp(body, duration=0)
+ *
+ * Keep body active for at least `duration` seconds (zero means the next step)
+ * even if it is far from cameras.
+ */
+static int
+LUA_WakeUp(lua_State *L)
+{
+        L_numarg_range(L, 1, 2);
+        void *obj = L_arg_userdata(L, 1);
+        float duration = L_argdef_float(L, 2, 0.0);
+        info_assert(L, duration >= 0.0, "Negative duration.");
+        
+        switch (*(int *)obj) {
+        case OBJTYPE_BODY: {
+                valid_body(L, obj);
+                body_wake(obj, duration);
+                return 0;
+        }
+        }
+        objtype_error(L, obj);
+}
+
+/*
+ * SetTransient(body, transient=true)
+ *
+ * Mark body as transient: it is destroyed automatically once it leaves world
+ * bounds (see SetBounds()). Clones of a transient body are transient too.
+ */
+static int
+LUA_SetTransient(lua_State *L)
+{
+        L_numarg_range(L, 1, 2);
+        Body *body = L_arg_userdata(L, 1);
+        int transient = L_argdef_bool(L, 2, 1);
+        
+        valid_body(L, body);
+        info_assert(L, body->parent != NULL, "Static body cannot be "
+                    "transient.");
+        if (transient)
+                body->flags |= BODY_TRANSIENT;
+        else
+                body->flags &= ~BODY_TRANSIENT;
+        body_update_transient(body);
+        return 0;
+}
+
+/*
+ * __SetBounds(world, area, margin=0, recycle=false, funcID=0, argID=0)
+ *
+ * Set the area that transient bodies must stay within (see SetBounds() in
+ * eapi.lua).
+ *
+ * area         Bounding box {l=?,r=?,b=?,t=?} in world coordinates, or a
+ *              Camera, in which case the area is its visible area. `nil`
+ *              turns culling off.
+ * margin       How far outside the area bodies may go.
+ * recycle      If true, culled bodies are recycled (see Recycle()) rather
+ *              than destroyed.
+ * funcID       Function to call once per step with an array of culled bodies.
+ */
+static int
+LUA___SetBounds(lua_State *L)
+{
+        L_numarg_range(L, 2, 6);
+        World *world = L_arg_userdata(L, 1);
+        int margin = L_argdef_int(L, 3, 0);
+        int recycle = L_argdef_bool(L, 4, 0);
+        intptr_t funcID = L_argdef_int(L, 5, 0);
+        intptr_t argID = L_argdef_int(L, 6, 0);
+        
+        valid_world(L, world);
+        info_assert(L, margin >= 0, "Negative margin.");
+        if (lua_isnoneornil(L, 2)) {
+                world_set_bounds(world, NULL, NULL, 0, 0, 0, 0);
+                return 0;
+        }
+        if (lua_islightuserdata(L, 2)) {
+                Camera *cam = L_arg_userdata(L, 2);
+                valid_camera(L, cam);
+                info_assert(L, cam->body.world == world, "Camera belongs to "
+                            "another world.");
+                world_set_bounds(world, NULL, cam, margin, recycle, funcID,
+                                 argID);
+                return 0;
+        }
+        BB area = L_arg_BB(L, 2);
+        world_set_bounds(world, &area, NULL, margin, recycle, funcID, argID);
+        return 0;
+}
+
+/*
+ * __GetBounds(world) -> funcID, argID
+ *
+ * Return the culling callback IDs passed to __SetBounds(), zero if unset.
+ */
+static int
+LUA___GetBounds(lua_State *L)
+{
+        L_numarg_range(L, 1, 1);
+        World *world = L_arg_userdata(L, 1);
+        
+        valid_world(L, world);
+        lua_pushinteger(L, world->bounds_func);
+        lua_pushinteger(L, world->bounds_cb_data);
+        return 2;
+}
+
+/*
+ * SetGC(frameStep, pause=nil, stepMul=nil)
+ *
+ * Tune Lua's incremental garbage collector so that its work is spread across
+ * frames instead of happening in occasional long pauses.
+ *
+ * frameStep    Amount of collection work (in kilobytes, see lua_gc() with
+ *              LUA_GCSTEP) done after every frame. Zero disables per-frame
+ *              steps.
+ * pause        Collector pause in percent (LUA_GCSETPAUSE). Larger values make
+ *              the automatic collector start a new cycle less often; with
+ *              per-frame steps doing most of the work, it can be raised well
+ *              above the default of 200.
+ * stepMul      Collector step multiplier in percent (LUA_GCSETSTEPMUL).
+ *
+ * Returns nothing.
+ */
+static int
+LUA_SetGC(lua_State *L)
+{
+        L_numarg_range(L, 1, 3);
+        gc_frame_step = L_arg_uint(L, 1);
+        if (!lua_isnoneornil(L, 2))
+                lua_gc(L, LUA_GCSETPAUSE, L_arg_uint(L, 2));
+        if (!lua_isnoneornil(L, 3))
+                lua_gc(L, LUA_GCSETSTEPMUL, L_arg_uint(L, 3));
+        return 0;
+}
+
+/*
+ * GetMemoryStats()
+ *
+ * Returns an array with usage statistics of memory pools. Pools that share a
+ * name (like the ones each world has of its own) are reported together. Each
+ * entry is a table with the following fields:
+ *
+ * name         Pool name (see mem_pool_init()).
+ * pools        Number of pools by this name that currently exist.
+ * cells        Total number of records the pools can hold before growing.
+ * current      Number of records currently allocated.
+ * peak         Highest number of records allocated in any one pool.
+ * allocs       Number of allocations.
+ * frees        Number of frees.
+ */
+static int
+LUA_GetMemoryStats(lua_State *L)
+{
+        L_numarg_range(L, 0, 0);
+        mem_stats stats[64];
+        unsigned num_stats = mem_get_stats(stats, ARRAYSZ(stats));
+        
+        lua_createtable(L, num_stats, 0);                       /* + array */
+        for (unsigned i = 0; i < num_stats; i++) {
+                const mem_stats *st = &stats[i];
+                lua_pushinteger(L, i + 1);
+                lua_createtable(L, 0, 7);                       /* + entry */
+                
+                lua_pushstring(L, "name");
+                lua_pushstring(L, st->name);
+                lua_rawset(L, -3);
+#define SET_STAT(key, value)                    \
+                lua_pushstring(L, key);         \
+                lua_pushinteger(L, value);      \
+                lua_rawset(L, -3);
+                SET_STAT("pools", st->num_pools);
+                SET_STAT("cells", st->num_cells);
+                SET_STAT("current", st->current);
+                SET_STAT("peak", st->peak);
+                SET_STAT("allocs", st->allocs);
+                SET_STAT("frees", st->frees);
+#undef SET_STAT
+                lua_rawset(L, -3);                              /* - entry */
+        }
+        return 1;
+}
+
+/*
+ * SetScene(name)
+ *
+ * Tell the engine that scene `name` is being entered. If an asset manifest is
+ * in use (see "manifest" in config.lua), textures and sounds the scene used on
+ * earlier runs are loaded now, and textures of scenes that have followed it
+ * are queued with the async loader. Assets loaded on first use after the next
+ * frame has started are logged as hitches and added to the manifest.
+ */
+static int
+LUA_SetScene(lua_State *L)
+{
+        L_numarg_range(L, 1, 1);
+        manifest_enter(L_arg_cstr(L, 1));
+        return 0;
+}
+
 /*
  * Enable(camera)
  */
@@ -1952,64 +2621,68 @@ LUA_Fractal(lua_State *L)
 }
 
 /*
- * GetPos(obj, relativeTo=parent) -> {x=?, y=?}
+ * GetPos(obj, relativeTo=parent, out=nil) -> {x=?, y=?}
+ * GetPosXY(obj, relativeTo=parent) -> x, y
  *
  * Return Body or Camera position relative to its parent. Optionally, the
  * second argument can be used to get position relative to some other Body,
  * Camera, or World.
  *
  *
- * GetPos(tile) -> {x=?, y=?}
+ * GetPos(tile, out=nil) -> {x=?, y=?}
  *
  * Get tile offset from parent Body.
+ *
+ * If a table is given as the last argument (`out`), the position is stored in
+ * it and that table is returned instead of a new one.
  */
 static int
 LUA_GetPos(lua_State *L)
 {
-        L_numarg_range(L, 1, 2);
+        L_numarg_range(L, 1, 3);
         void *obj = L_arg_userdata(L, 1);
+        int out = L_arg_out(L, lua_gettop(L));
         
         switch (*(int *)obj) {
         case OBJTYPE_BODY:
         case OBJTYPE_CAMERA: {
-                void *relto = L_argdef_userdata(L, 2, NULL);
-                if (relto == NULL) {
-                        L_push_vectf(L, body_pos(get_body(L, obj)));
-                        return 1;
-                }
+                void *relto = (out == 2) ? NULL : L_argdef_userdata(L, 2, NULL);
+                if (relto == NULL)
+                        return L_return_vectf(L, body_pos(get_body(L, obj)), out);
                 vect_f bpos = body_absolute_pos(get_body(L, obj));
                 vect_f other_pos = body_absolute_pos(get_body(L, relto));
-                L_push_vectf(L, vect_f_sub(bpos, other_pos));
-                return 1;
+                return L_return_vectf(L, vect_f_sub(bpos, other_pos), out);
         }
         case OBJTYPE_TILE: {
                 valid_tile(L, obj);
-                L_push_vectf(L, tile_pos(obj));
-                return 1;
+                return L_return_vectf(L, tile_pos(obj), out);
         }
         }
         objtype_error(L, obj);
 }
 
 /*
+ * GetPrevPos(obj, out=nil) -> {x=?, y=?}
+ * GetPrevPosXY(obj) -> x, y
+ *
  * Get body position from previous step.
  */
 static int
 LUA_GetPrevPos(lua_State *L)
 {
-        L_numarg_range(L, 1, 1);
+        L_numarg_range(L, 1, 2);
         void *obj = L_arg_userdata(L, 1);
+        int out = L_arg_out(L, 2);
         
         switch (*(int *)obj) {
         case OBJTYPE_BODY: {
                 valid_body(L, obj);
-                L_push_vectf(L, ((Body *)obj)->prevstep_pos);
-                return 1;
+                return L_return_vectf(L, ((Body *)obj)->prevstep_pos, out);
         }
         case OBJTYPE_CAMERA: {
                 valid_camera(L, obj);
-                L_push_vectf(L, ((Camera *)obj)->body.prevstep_pos);
-                return 1;
+                return L_return_vectf(L, ((Camera *)obj)->body.prevstep_pos,
+                                      out);
         }
         }
         objtype_error(L, obj);
@@ -2153,24 +2826,26 @@ LUA_AnimatePos(lua_State *L)
 }
 
 /*
+ * GetVel(obj, out=nil) -> {x=?, y=?}
+ * GetVelXY(obj) -> x, y
+ *
  * Return the velocity of an object. Supported objects: Body, Camera.
  */
 static int
 LUA_GetVel(lua_State *L)
 {
-        L_numarg_range(L, 1, 1);
+        L_numarg_range(L, 1, 2);
         void *obj = L_arg_userdata(L, 1);
+        int out = L_arg_out(L, 2);
         
         switch (*(int *)obj) {
         case OBJTYPE_BODY: {
                 valid_body(L, obj);
-                L_push_vectf(L, ((Body *)obj)->vel);
-                return 1;
+                return L_return_vectf(L, ((Body *)obj)->vel, out);
         }
         case OBJTYPE_CAMERA: {
                 valid_camera(L, obj);
-                L_push_vectf(L, ((Camera *)obj)->body.vel);
-                return 1;
+                return L_return_vectf(L, ((Camera *)obj)->body.vel, out);
         }
         }
         objtype_error(L, obj);
@@ -2285,7 +2960,8 @@ LUA_SetAcc(lua_State *L)
 }
 
 /*
- * GetDeltaPos(object) -> {x=?, y=?}
+ * GetDeltaPos(object, out=nil) -> {x=?, y=?}
+ * GetDeltaPosXY(object) -> x, y
  *
  * object       Body object pointer.
  *
@@ -2295,7 +2971,7 @@ LUA_SetAcc(lua_State *L)
 static int
 LUA_GetDeltaPos(lua_State *L)
 {
-        L_numarg_range(L, 1, 1);
+        L_numarg_range(L, 1, 2);
         void *obj = L_arg_userdata(L, 1);
         
         vect_f delta;
@@ -2318,12 +2994,12 @@ LUA_GetDeltaPos(lua_State *L)
         default:
                 objtype_error(L, obj);
         }
-        L_push_vectf(L, delta);
-        return 1;
+        return L_return_vectf(L, delta, L_arg_out(L, 2));
 }
 
 /*
- * GetSize(something) -> {x=?, y=?}
+ * GetSize(something, out=nil) -> {x=?, y=?}
+ * GetSizeXY(something) -> x, y
  *
  * Get the size of something. To get the size of a texture, pass in the same
  * kind of argument you would give to NewSpriteList().
@@ -2331,19 +3007,19 @@ LUA_GetDeltaPos(lua_State *L)
 static int
 LUA_GetSize(lua_State *L)
 {
-        L_numarg_range(L, 1, 1);
+        L_numarg_range(L, 1, 2);
         void *obj = L_arg_userdata(L, 1);
+        int out = L_arg_out(L, 2);
         
         switch (*(int *)obj) {
         case OBJTYPE_CAMERA: {
                 Camera *cam = obj;
                 valid_camera(L, cam);
                 
-                L_push_vecti(L, (vect_i){
-                        .x=(int)lroundf(cam->size.x / cam->zoom),
-                        .y=(int)lroundf(cam->size.y / cam->zoom)
-                });
-                return 1;
+                return L_return_vectf(L, (vect_f){
+                        .x=lroundf(cam->size.x / cam->zoom),
+                        .y=lroundf(cam->size.y / cam->zoom)
+                }, out);
         }
         case OBJTYPE_TILE: {
                 Tile *t = obj;
@@ -2355,16 +3031,14 @@ LUA_GetSize(lua_State *L)
                         size.y = -size.y;
                 }
                 assert(size.x > 0 && size.y > 0);
-                L_push_vectf(L, size);
-                return 1;
+                return L_return_vectf(L, size, out);
         }
         case OBJTYPE_SPRITELIST: {
                 SpriteList *sprite_list = obj;
                 valid_spritelist(L, sprite_list);
                 vect_i size = texfrag_maxsize(sprite_list->frames,
                                               sprite_list->num_frames);
-                L_push_vectf(L, (vect_f){size.x, size.y});
-                return 1;
+                return L_return_vectf(L, (vect_f){size.x, size.y}, out);
         }
         }
         objtype_error(L, obj);
@@ -2506,6 +3180,136 @@ LUA_AnimatingColor(lua_State *L)
         objtype_error(L, obj);
 }
 
+/*
+ * AnimatePath(obj, keys, loopMode=eapi.ANIM_CLAMP, startTime=0)
+ *
+ * obj          Body, Camera, or Tile.
+ * keys         Array of keyframes (at least two). Each key is a table with a
+ *              `time` field (seconds since path start), an optional `ease`
+ *              field that applies to the segment ending at this key
+ *              (eapi.ANIM_CLAMP = linear, eapi.ANIM_CLAMP_EASEIN, etc.), and
+ *              one of the following:
+ *                pos={x,y}             Position (Body, Camera, Tile).
+ *                color={r,g,b,a}       Tile color.
+ *                angle=radians         Tile angle. Pivot point may be given as
+ *                                      `pivot` in the first key.
+ * loopMode     eapi.ANIM_CLAMP, eapi.ANIM_LOOP, eapi.ANIM_REVERSE_LOOP, or
+ *              eapi.ANIM_REVERSE_CLAMP.
+ * startTime    Delay (seconds) before path starts.
+ *
+ * Animate a property through any number of keyframes. The whole path is
+ * evaluated in C, so no timers or Lua callbacks are needed between segments.
+ */
+static int
+LUA_AnimatePath(lua_State *L)
+{
+        L_numarg_range(L, 2, 4);
+        void *obj = L_arg_userdata(L, 1);
+        info_assert(L, lua_istable(L, 2), "Keyframe table expected.");
+        uint8_t loop = L_argdef_uint(L, 3, ANIM_CLAMP);
+        float start_time = L_argdef_float(L, 4, 0.0);
+        info_assert_va(L, loop == ANIM_CLAMP || loop == ANIM_LOOP ||
+                       loop == ANIM_REVERSE_LOOP || loop == ANIM_REVERSE_CLAMP,
+                       "Invalid loop mode (%d).", loop);
+        unsigned num_keys = lua_objlen(L, 2);
+        info_assert(L, num_keys >= 2, "At least two keys are required.");
+        
+        /* Figure out which property is animated by looking at first key. */
+        enum { PATH_POS, PATH_COLOR, PATH_ANGLE } what = PATH_POS;
+        vect_f pivot = {0.0, 0.0};
+        L_get_intfield(L, 2, 1);                        /* ... key */
+        info_assert(L, lua_istable(L, -1), "Key must be a table.");
+        L_get_strfield(L, -1, "pos");                   /* + pos */
+        L_get_strfield(L, -2, "color");                 /* + color */
+        L_get_strfield(L, -3, "angle");                 /* + angle */
+        L_get_strfield(L, -4, "pivot");                 /* + pivot */
+        if (!lua_isnil(L, -3))
+                what = PATH_COLOR;
+        else if (!lua_isnil(L, -2))
+                what = PATH_ANGLE;
+        else if (lua_isnil(L, -4))
+                luaL_error(L, "Key must have `pos`, `color`, or `angle`.");
+        if (!lua_isnil(L, -1))
+                pivot = L_arg_vectf(L, lua_gettop(L));
+        lua_pop(L, 5);
+        
+        /*
+         * Parse keys into Lua-owned scratch memory first, so nothing leaks if
+         * a key turns out to be invalid.
+         */
+        static const char *field[] = {"pos", "color", "angle"};
+        PropKey *keys = lua_newuserdata(L, num_keys * sizeof(PropKey));
+        for (unsigned i = 0; i < num_keys; i++) {
+                L_get_intfield(L, 2, i + 1);            /* ... key */
+                info_assert_va(L, lua_istable(L, -1), "Key %d: table "
+                               "expected.", i + 1);
+                L_get_strfield(L, -1, "time");          /* + time */
+                L_get_strfield(L, -2, "ease");          /* + ease */
+                L_get_strfield(L, -3, field[what]);     /* + value */
+                int top = lua_gettop(L);
+                keys[i].time = L_arg_float(L, top - 2);
+                unsigned ease = L_argdef_uint(L, top - 1, ANIM_CLAMP);
+                info_assert_va(L, ease >= ANIM_CLAMP &&
+                               ease <= ANIM_CLAMP_EASEINOUT,
+                               "Key %d: invalid ease (%u).", i + 1, ease);
+                keys[i].ease = ease;
+                info_assert_va(L, i == 0 || keys[i].time >= keys[i - 1].time,
+                               "Key %d: time goes backwards.", i + 1);
+                switch (what) {
+                case PATH_POS:
+                        keys[i]._.vectf = L_arg_vectf(L, top);
+                        break;
+                case PATH_COLOR:
+                        keys[i]._.color = L_arg_color(L, top);
+                        break;
+                case PATH_ANGLE:
+                        keys[i]._.angle = L_arg_float(L, top);
+                        break;
+                }
+                lua_pop(L, 4);
+        }
+        info_assert(L, keys[num_keys - 1].time > 0.0,
+                    "Path duration must be positive.");
+        
+        /* Check target first, so that errors do not leak the path. */
+        int objtype = *(int *)obj;
+        switch (objtype) {
+        case OBJTYPE_TILE:
+                valid_tile(L, obj);
+                break;
+        case OBJTYPE_CAMERA:
+                valid_camera(L, obj);
+                info_assert(L, what == PATH_POS, "Only `pos` paths apply to "
+                            "cameras.");
+                break;
+        case OBJTYPE_BODY:
+                valid_body(L, obj);
+                info_assert(L, what == PATH_POS, "Only `pos` paths apply to "
+                            "bodies.");
+                break;
+        default:
+                objtype_error(L, obj);
+        }
+        
+        /* Copy keys into a path that the property will own. */
+        PropPath *path = path_new(loop, num_keys);
+        memcpy(path->keys, keys, num_keys * sizeof(PropKey));
+        
+        if (objtype == OBJTYPE_TILE) {
+                if (what == PATH_POS)
+                        tile_path_pos(obj, path, start_time);
+                else if (what == PATH_COLOR)
+                        tile_path_color(obj, path, start_time);
+                else
+                        tile_path_angle(obj, path, pivot, start_time);
+        } else if (objtype == OBJTYPE_CAMERA) {
+                body_anim_path(&((Camera *)obj)->body, path, start_time);
+        } else {
+                body_anim_path(obj, path, start_time);
+        }
+        return 0;
+}
+
 /*
  * Blend(tile, mode)
  *
@@ -2646,7 +3450,7 @@ LUA_GetChildren(lua_State *L)
         Body *child;
         DL_FOREACH(body->children, child) {
                 lua_pushinteger(L, key++);
-                lua_pushlightuserdata(L, child);
+                L_push_object(L, child);
                 lua_rawset(L, -3);
         }
         return 1;
@@ -2658,24 +3462,30 @@ static void
 clear_timer_state(Timer *t)
 {
         lua_State *L = L_state;
-        
-        lua_getglobal(L, "eapi");
-        L_get_strfield(L, -1, "idToObjectMap");
+        extern int idmap_index;
         
         /* Unset timer function reference. */
         info_assert(L, t->func != 0, "No function.");
-        lua_pushnumber(L, t->func);
         lua_pushnil(L);
-        lua_rawset(L, -3);
+        lua_rawseti(L, idmap_index, t->func);
         
         /* Unset user argument reference. */
         if (t->data != 0) {
-                lua_pushnumber(L, t->data);
                 lua_pushnil(L);
-                lua_rawset(L, -3);
+                lua_rawseti(L, idmap_index, t->data);
         }
-        
-        lua_pop(L, 2);
+}
+
+/*
+ * Push timer table {timer handle} as accepted by CancelTimer().
+ */
+static void
+push_timer(lua_State *L, Timer *tmr)
+{
+        lua_createtable(L, 1, 0);
+        lua_pushinteger(L, 1);
+        lua_pushlightuserdata(L, (void *)tmr->handle);
+        lua_rawset(L, -3);
 }
 
 /*
@@ -2706,21 +3516,93 @@ LUA_AddTimer(lua_State *L)
         
         /* Set cleanup function to avoid memory leaks in script. */
         tmr->clearfunc = clear_timer_state;
-        
-        /* Set timer pointer. */
-        lua_createtable(L, 4, 0);
-        lua_pushinteger(L, 1);
-        lua_pushlightuserdata(L, tmr);
-        lua_rawset(L, -3);
-        
-        /* Set timer ID. */
-        lua_pushinteger(L, 2);
-        lua_pushinteger(L, tmr->timer_id);
-        lua_rawset(L, -3);
+        push_timer(L, tmr);
+        return 1;
+}
 
+/*
+ * Spawn(obj, threadID, argID)
+ *
+ * obj          Accepted objects: World, Camera, Body.
+ * threadID     Coroutine index into `eapi.idToObjectMap`.
+ * argID        User argument index into `eapi.idToObjectMap`.
+ *
+ * Run coroutine as a task bound to given body. It is first resumed during the
+ * body's next timer pass with the object and user arguments, and then again
+ * whenever the time it waits for (see Wait() and WaitSteps()) has passed. A
+ * task does not allocate anything while waiting. Like timers, tasks do not
+ * run while their body is paused, and they die with it.
+ *
+ * Returns a timer table that CancelTimer() accepts.
+ */
+static int
+LUA_Spawn(lua_State *L)
+{
+        L_numarg_range(L, 3, 3);
+        void *obj = L_arg_userdata(L, 1);
+        intptr_t threadID = L_arg_int(L, 2);
+        intptr_t argID = L_arg_int(L, 3);
+        
+        Body *b = get_body(L, obj);
+        Timer *tmr = body_add_timer(b, obj, 0.0, OBJTYPE_TIMER_TASK, threadID,
+                                    argID);
+        tmr->clearfunc = clear_timer_state;
+        push_timer(L, tmr);
         return 1;
 }
 
+/*
+ * Make sure caller is a coroutine; yielding from the main thread is an error.
+ */
+static void
+assert_task(lua_State *L)
+{
+        int main_thread = lua_pushthread(L);
+        lua_pop(L, 1);
+        UNUSED(main_thread);    /* Only checked in debug builds. */
+        info_assert(L, !main_thread, "Not called from within a task (see "
+                    "eapi.Spawn).");
+}
+
+/*
+ * Wait(seconds)
+ *
+ * Suspend calling task (see Spawn()) for `seconds` of its body's time. Zero
+ * resumes it in the next step.
+ */
+static int
+LUA_Wait(lua_State *L)
+{
+        L_numarg_range(L, 1, 1);
+        float seconds = L_arg_float(L, 1);
+        info_assert(L, seconds >= 0.0, "Negative wait time.");
+        assert_task(L);
+        
+        lua_settop(L, 0);
+        lua_pushnumber(L, seconds);
+        lua_pushboolean(L, 0);
+        return lua_yield(L, 2);
+}
+
+/*
+ * WaitSteps(n=1)
+ *
+ * Suspend calling task (see Spawn()) for `n` steps of its body.
+ */
+static int
+LUA_WaitSteps(lua_State *L)
+{
+        L_numarg_range(L, 0, 1);
+        int steps = L_argdef_int(L, 1, 1);
+        info_assert(L, steps > 0, "Step count must be positive.");
+        assert_task(L);
+        
+        lua_settop(L, 0);
+        lua_pushnumber(L, steps);
+        lua_pushboolean(L, 1);
+        return lua_yield(L, 2);
+}
+
 /*
  * CancelTimer(timer)
  *
@@ -2738,18 +3620,19 @@ LUA_CancelTimer(lua_State *L)
         if (lua_isnil(L, 1))
                 return 0;
         
-        /* Get timer pointer. */
+        /* Get timer handle. */
         L_get_intfield(L, 1, 1);
-        Timer *timer = L_arg_userdata(L, 2);
-        
-        /* Get timer ID. */
-        L_get_intfield(L, 1, 2);
-        unsigned timer_id = L_arg_uint(L, 3);
+        info_assert(L, lua_islightuserdata(L, 2), "Invalid timer table.");
+        Handle h = (Handle)lua_touserdata(L, 2);
         
-        /* Ignore if timer was destroyed (check if mem is reused). */
-        void *owner = timer->owner;
-        if (owner == NULL || timer->timer_id != timer_id)
+        /*
+         * Ignore if timer was executed, cancelled, or its world destroyed. A
+         * stale handle does not touch timer memory, which may be gone.
+         */
+        Timer *timer = handle_get(h);
+        if (timer == NULL)
                 return 0;
+        void *owner = timer->owner;
         
         switch (*(int *)owner) {
         case OBJTYPE_BODY: {
@@ -2846,7 +3729,7 @@ LUA_SelectShape(lua_State *L)
         if (s == NULL)
                 lua_pushnil(L);
         else
-                lua_pushlightuserdata(L, s);
+                L_push_object(L, s);
         return 1;
 }
 
@@ -2889,7 +3772,7 @@ LUA_SelectTiles(lua_State *L)
                 };
                 if (bb_overlap(&tile_bb, &area)) {
                         lua_pushnumber(L, ++num_tiles);
-                        lua_pushlightuserdata(L, t);
+                        L_push_object(L, t);
                         lua_rawset(L, -3);
                 }
         }
@@ -3074,10 +3957,13 @@ LUA_Collide(lua_State *L)
         Handler *handler = &w->handler_map[groupA->index][groupB->index];
         
         /* Each group remembers how many handlers we have registered for it. */
-        if (handler->func == 0 && cf != 0)
-                groupA->num_handlers++;
-        else if (handler->func != 0 && cf == 0)
-                groupA->num_handlers--;
+        if (handler->func == 0 && cf != 0) {
+                if (groupA->num_handlers++ == 0)
+                        world_group_changed(w, groupA);
+        } else if (handler->func != 0 && cf == 0) {
+                if (--groupA->num_handlers == 0)
+                        world_group_changed(w, groupA);
+        }
         
         /* Set handler data. */
         handler->type = HANDLER_LUA;
@@ -3216,7 +4102,7 @@ LUA_PlaySound(lua_State *L)
         /* World or no world. */
         World *world = NULL;
         if (lua_islightuserdata(L, 1)) {
-                world = lua_touserdata(L, 1);
+                world = L_arg_userdata(L, 1);
                 valid_world(L, world);
         } else {
                 info_assert(L, lua_isboolean(L, 1) && !lua_toboolean(L, 1),
@@ -3546,6 +4432,23 @@ do { \
         lua_rawset((L), eapi_index); \
 } while (0)
 
+/*
+ * Add a vector API function under two names: `name` returns {x=?, y=?} (or
+ * fills a table supplied by the caller), while `name`XY returns two numbers.
+ * See L_return_vectf().
+ */
+#define EAPI_SET_VECTFUNC(name, f) \
+do { \
+        lua_pushstring(L, (name)); \
+        lua_pushboolean(L, 0); \
+        lua_pushcclosure(L, (f), 1); \
+        lua_rawset((L), eapi_index); \
+        lua_pushstring(L, (name "XY")); \
+        lua_pushboolean(L, 1); \
+        lua_pushcclosure(L, (f), 1); \
+        lua_rawset((L), eapi_index); \
+} while (0)
+
 /* Add integer to "eapi" namespace table. */
 #define EAPI_SET_INT(name, c) \
 do { \
@@ -3594,7 +4497,7 @@ eapi_register(lua_State *L)
 #if ENABLE_MOUSE
         EAPI_SET_FUNC("__BindMouseClick", LUA_BindMouseClick);
         EAPI_SET_FUNC("__BindMouseMove",  LUA_BindMouseMove);
-        EAPI_SET_FUNC("MousePos",         LUA_MousePos);
+        EAPI_SET_VECTFUNC("MousePos",     LUA_MousePos);
 #endif
 #if ENABLE_JOYSTICK
         EAPI_SET_FUNC("__BindJoystickButton", LUA_BindJoystickButton);
@@ -3610,16 +4513,26 @@ eapi_register(lua_State *L)
         EAPI_SET_FUNC("NewSpriteList",   LUA_NewSpriteList);
         EAPI_SET_FUNC("ChopImage",       LUA_ChopImage);
         EAPI_SET_FUNC("Clone",           LUA_Clone);
+        EAPI_SET_FUNC("SpawnBatch",      LUA_SpawnBatch);
+        EAPI_SET_FUNC("Reuse",           LUA_Reuse);
+        EAPI_SET_FUNC("NewEmitter",      LUA_NewEmitter);
+        EAPI_SET_FUNC("SetEmitter",      LUA_SetEmitter);
         
         /* Destroy objects. */
         EAPI_SET_FUNC("__Clear",         LUA_Clear);
         EAPI_SET_FUNC("Destroy",         LUA_Destroy);
+        EAPI_SET_FUNC("Recycle",         LUA_Recycle);
         EAPI_SET_FUNC("Quit",            LUA_Quit);
         
         /* Timers. */
         EAPI_SET_FUNC("__AddTimer",      LUA_AddTimer);
         EAPI_SET_FUNC("CancelTimer",     LUA_CancelTimer);
         
+        /* Tasks (coroutines). */
+        EAPI_SET_FUNC("__Spawn",         LUA_Spawn);
+        EAPI_SET_FUNC("Wait",            LUA_Wait);
+        EAPI_SET_FUNC("WaitSteps",       LUA_WaitSteps);
+        
         /* Step/after-step functions. */
         EAPI_SET_FUNC("__SetStep",       LUA_SetStep);
         EAPI_SET_FUNC("__SetAfterStep",  LUA_SetAfterStep);
@@ -3648,13 +4561,13 @@ eapi_register(lua_State *L)
         EAPI_SET_FUNC("SetPosX",         LUA_SetPosX);
         EAPI_SET_FUNC("SetPosY",         LUA_SetPosY);
         EAPI_SET_FUNC("SetPosCentered",  LUA_SetPosCentered);
-        EAPI_SET_FUNC("GetPos",          LUA_GetPos);
-        EAPI_SET_FUNC("GetPrevPos",      LUA_GetPrevPos);
-        EAPI_SET_FUNC("GetDeltaPos",     LUA_GetDeltaPos);
+        EAPI_SET_VECTFUNC("GetPos",      LUA_GetPos);
+        EAPI_SET_VECTFUNC("GetPrevPos",  LUA_GetPrevPos);
+        EAPI_SET_VECTFUNC("GetDeltaPos", LUA_GetDeltaPos);
         EAPI_SET_FUNC("AnimatePos",      LUA_AnimatePos);
         
         /* Velocity. */
-        EAPI_SET_FUNC("GetVel",          LUA_GetVel);
+        EAPI_SET_VECTFUNC("GetVel",      LUA_GetVel);
         EAPI_SET_FUNC("SetVel",          LUA_SetVel);
         EAPI_SET_FUNC("SetVelX",         LUA_SetVelX);
         EAPI_SET_FUNC("SetVelY",         LUA_SetVelY);
@@ -3675,8 +4588,11 @@ eapi_register(lua_State *L)
         EAPI_SET_FUNC("AnimateColor",   LUA_AnimateColor);
         EAPI_SET_FUNC("AnimatingColor", LUA_AnimatingColor);
         
+        /* Keyframe paths. */
+        EAPI_SET_FUNC("AnimatePath",    LUA_AnimatePath);
+        
         /* Size. */
-        EAPI_SET_FUNC("GetSize",        LUA_GetSize);
+        EAPI_SET_VECTFUNC("GetSize",    LUA_GetSize);
         EAPI_SET_FUNC("SetSize",        LUA_SetSize);
         EAPI_SET_FUNC("AnimateSize",    LUA_AnimateSize);
         
@@ -3717,6 +4633,15 @@ eapi_register(lua_State *L)
         EAPI_SET_FUNC("Snapshot",       LUA_Dummy);
         EAPI_SET_FUNC("Rewind",         LUA_Dummy);
 #endif
+        /* Body sleeping. */
+        EAPI_SET_FUNC("AllowSleep",     LUA_AllowSleep);
+        EAPI_SET_FUNC("WakeUp",         LUA_WakeUp);
+        
+        /* Culling. */
+        EAPI_SET_FUNC("SetTransient",   LUA_SetTransient);
+        EAPI_SET_FUNC("__SetBounds",    LUA___SetBounds);
+        EAPI_SET_FUNC("__GetBounds",    LUA___GetBounds);
+        
         /* Misc. */
         EAPI_SET_FUNC("ShowCursor",     LUA_ShowCursor);
         EAPI_SET_FUNC("HideCursor",     LUA_HideCursor);
@@ -3727,6 +4652,9 @@ eapi_register(lua_State *L)
         EAPI_SET_FUNC("SetBoundary",    LUA_SetBoundary);
         EAPI_SET_FUNC("What",           LUA_What);
         EAPI_SET_FUNC("Log",            LUA_Log);
+        EAPI_SET_FUNC("SetGC",          LUA_SetGC);
+        EAPI_SET_FUNC("GetMemoryStats", LUA_GetMemoryStats);
+        EAPI_SET_FUNC("SetScene",       LUA_SetScene);
 
         EAPI_SET_FUNC("Fractal",	LUA_Fractal);
 
@@ -3770,6 +4698,22 @@ eapi_register(lua_State *L)
         /* Step functions. */
         EAPI_SET_USERDATA("STEPFUNC_STD",       stepfunc_std);
         EAPI_SET_USERDATA("STEPFUNC_ROT",       stepfunc_rot);
+        EAPI_SET_USERDATA("STEPFUNC_HOMING",    stepfunc_homing);
+        EAPI_SET_USERDATA("STEPFUNC_SINE",      stepfunc_sine);
+        EAPI_SET_USERDATA("STEPFUNC_ORBIT",     stepfunc_orbit);
+        EAPI_SET_USERDATA("STEPFUNC_DRAG",      stepfunc_drag);
+        EAPI_SET_USERDATA("STEPFUNC_CHASE",     stepfunc_chase);
+        
+        /* Emitter pattern presets. */
+        EAPI_SET_INT("EMITTER_RING",            EMITTER_RING);
+        EAPI_SET_INT("EMITTER_SPIRAL",          EMITTER_SPIRAL);
+        EAPI_SET_INT("EMITTER_SPREAD",          EMITTER_SPREAD);
+        EAPI_SET_INT("EMITTER_WAVE",            EMITTER_WAVE);
+        
+#if ENABLE_LUAJIT
+        /* Tell eapi.lua that FFI entry points (eapi_ffi.c) are available. */
+        EAPI_SET_INT("FFI",                     1);
+#endif
         
         /* Load the part of eapi interface that lives in eapi.lua. */
         extern int errfunc_index;
@@ -0,0 +1,207 @@
+#include "common.h"
+
+#if ENABLE_LUAJIT
+
+#include "body.h"
+#include "camera.h"
+#include "stepfunc.h"
+#include "tile.h"
+#include "world.h"
+#include "eapi_ffi.h"
+
+/*
+ * FFI fast path for the most frequently called eapi functions. Semantics are
+ * the same as those of their counterparts in eapi_Lua.c; see there for
+ * documentation.
+ */
+
+/* Same requirements as valid_world() in eapi_Lua.c. */
+#define world_usable(w) ((w) != NULL && (w)->objtype == OBJTYPE_WORLD && \
+                         (w)->step_ms > 0 && !(w)->killme)
+
+/*
+ * Turn object handle (see handle.h) into a pointer; NULL if it is stale. Other
+ * pointers are returned as they are.
+ */
+static void *
+ffi_resolve(void *obj)
+{
+        return handle_is(obj) ? handle_get((Handle)obj) : obj;
+}
+
+/*
+ * Return the body that represents object's timeline and position (like
+ * get_body() in eapi_Lua.c), or NULL if the object is not usable.
+ */
+static Body *
+ffi_body(void *obj, int allow_world)
+{
+        obj = ffi_resolve(obj);
+        if (obj == NULL)
+                return NULL;
+        
+        Body *b;
+        switch (*(int *)obj) {
+        case OBJTYPE_BODY:
+                b = obj;
+                break;
+        case OBJTYPE_CAMERA:
+                b = &((Camera *)obj)->body;
+                break;
+        case OBJTYPE_WORLD:
+                if (!allow_world)
+                        return NULL;
+                b = &((World *)obj)->static_body;
+                break;
+        default:
+                return NULL;
+        }
+        return world_usable(b->world) ? b : NULL;
+}
+
+static Tile *
+ffi_tile(void *obj)
+{
+        obj = ffi_resolve(obj);
+        if (obj == NULL || *(int *)obj != OBJTYPE_TILE)
+                return NULL;
+        
+        Tile *t = obj;
+        Body *b = t->body;
+        if (b == NULL || b->objtype != OBJTYPE_BODY || !world_usable(b->world))
+                return NULL;
+        return t;
+}
+
+int
+eapi_ffi_GetPos(void *obj, void *relto, double *out)
+{
+        Tile *t = ffi_tile(obj);
+        if (t != NULL) {
+                if (relto != NULL)
+                        return 0;
+                vect_f pos = tile_pos(t);
+                out[0] = pos.x;
+                out[1] = pos.y;
+                return 1;
+        }
+        if (obj != NULL && !handle_is(obj) && *(int *)obj == OBJTYPE_WORLD)
+                return 0;       /* Not supported by GetPos(). */
+        
+        Body *b = ffi_body(obj, 0);
+        if (b == NULL)
+                return 0;
+        
+        vect_f pos;
+        if (relto == NULL) {
+                pos = body_pos(b);
+        } else {
+                Body *other = ffi_body(relto, 1);
+                if (other == NULL)
+                        return 0;
+                pos = vect_f_sub(body_absolute_pos(b),
+                                 body_absolute_pos(other));
+        }
+        out[0] = pos.x;
+        out[1] = pos.y;
+        return 1;
+}
+
+int
+eapi_ffi_SetPos(void *obj, double x, double y)
+{
+        vect_f pos = {x, y};
+        if (!isfinite(pos.x) || !isfinite(pos.y))
+                return 0;
+        
+        Tile *t = ffi_tile(obj);
+        if (t != NULL) {
+                tile_set_pos(t, pos);
+                return 1;
+        }
+        Body *b = ffi_body(obj, 0);
+        if (b == NULL)
+                return 0;       /* Shapes and errors go the slow way. */
+        
+        if (!handle_is(obj) && *(int *)obj == OBJTYPE_CAMERA)
+                cam_set_pos(obj, pos);   /* Cameras have no handles. */
+        else
+                body_set_pos(b, pos);
+        return 1;
+}
+
+int
+eapi_ffi_GetVel(void *obj, double *out)
+{
+        Body *b = ffi_body(obj, 0);
+        if (b == NULL)
+                return 0;
+        out[0] = b->vel.x;
+        out[1] = b->vel.y;
+        return 1;
+}
+
+int
+eapi_ffi_SetVel(void *obj, double x, double y)
+{
+        vect_f vel = {x, y};
+        Body *b = ffi_body(obj, 0);
+        if (b == NULL || !isfinite(vel.x) || !isfinite(vel.y))
+                return 0;
+        b->vel = vel;
+        
+        /* Set standard step function if not already set. */
+        if (b->step_func == 0) {
+                b->step_func = (intptr_t)stepfunc_std;
+                b->flags |= BODY_STEP_C;
+        }
+        return 1;
+}
+
+int
+eapi_ffi_GetTime(void *obj, double *out)
+{
+        Body *b = ffi_body(obj, 1);
+        if (b == NULL)
+                return 0;
+        
+        /* Now = (current step number) * (step duration in seconds) */
+        float step_sec = b->world->step_sec;
+        out[0] = b->step * step_sec;
+        out[1] = step_sec;
+        return 1;
+}
+
+int
+eapi_ffi_AnimatePos(void *obj, int type, double x, double y, double duration,
+                    double start_time)
+{
+        vect_f end = {x, y};
+        if (!isfinite(end.x) || !isfinite(end.y))
+                return 0;
+        
+        Tile *t = ffi_tile(obj);
+        if (t != NULL) {
+                tile_anim_pos(t, type, end, duration, start_time);
+                return 1;
+        }
+        Body *b = ffi_body(obj, 0);
+        if (b == NULL)
+                return 0;
+        body_anim_pos(b, type, end, duration, start_time);
+        return 1;
+}
+
+int
+eapi_ffi_AnimateAngle(void *obj, int type, double pivot_x, double pivot_y,
+                      double angle, double duration, double start_time)
+{
+        Tile *t = ffi_tile(obj);
+        if (t == NULL)
+                return 0;
+        tile_anim_angle(t, type, (vect_f){pivot_x, pivot_y}, angle, duration,
+                        start_time);
+        return 1;
+}
+
+#endif  /* ENABLE_LUAJIT */
@@ -0,0 +1,35 @@
+#ifndef GAME2D_EAPI_FFI_H
+#define GAME2D_EAPI_FFI_H
+
+#include "common.h"
+
+#if ENABLE_LUAJIT
+
+/*
+ * Entry points for LuaJIT's FFI library (see eapi_ffi.lua). These take raw
+ * object pointers and doubles, so no Lua tables are created. None of them
+ * raise Lua errors: each returns zero if it cannot handle its arguments, and
+ * the Lua side then falls back to the regular eapi function.
+ *
+ * Keep declarations in sync with the ffi.cdef() block in eapi_ffi.lua.
+ */
+#if defined(_WIN32)
+  #define FFI_EXPORT __declspec(dllexport)
+#else
+  #define FFI_EXPORT __attribute__((visibility("default")))
+#endif
+
+FFI_EXPORT int   eapi_ffi_GetPos(void *obj, void *relto, double *out);
+FFI_EXPORT int   eapi_ffi_SetPos(void *obj, double x, double y);
+FFI_EXPORT int   eapi_ffi_GetVel(void *obj, double *out);
+FFI_EXPORT int   eapi_ffi_SetVel(void *obj, double x, double y);
+FFI_EXPORT int   eapi_ffi_GetTime(void *obj, double *out);
+FFI_EXPORT int   eapi_ffi_AnimatePos(void *obj, int type, double x, double y,
+                                     double duration, double start_time);
+FFI_EXPORT int   eapi_ffi_AnimateAngle(void *obj, int type, double pivot_x,
+                                       double pivot_y, double angle,
+                                       double duration, double start_time);
+
+#endif  /* ENABLE_LUAJIT */
+
+#endif  /* GAME2D_EAPI_FFI_H */
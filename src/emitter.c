@@ -0,0 +1,183 @@
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include "emitter.h"
+#include "log.h"
+#include "mem.h"
+#include "stepfunc.h"
+#include "world.h"
+
+/*
+ * Fill pattern with defaults for the given preset type.
+ */
+void
+emitter_pattern_init(EmitterPattern *p, int type)
+{
+        memset(p, 0, sizeof(*p));
+        p->type = type;
+        p->count = 1;
+        p->rate = 1.0;
+        p->speed = 100.0;
+        
+        switch (type) {
+        case EMITTER_RING:
+                p->count = 12;
+                p->arc = 2.0 * M_PI;
+                break;
+        case EMITTER_SPIRAL:
+                p->arc = 2.0 * M_PI;
+                p->spin = M_PI / 12.0;
+                p->rate = 12.0;
+                break;
+        case EMITTER_SPREAD:
+                p->count = 5;
+                p->arc = M_PI / 6.0;
+                break;
+        case EMITTER_WAVE:
+                p->amplitude = M_PI / 6.0;
+                p->frequency = 1.0;
+                p->rate = 8.0;
+                break;
+        default:
+                fatal_error("Invalid emitter type (%d).", type);
+        }
+}
+
+/*
+ * Turn `body` into an emitter that fires clones of `bullet` according to
+ * pattern `p`. The emitter takes ownership of the bullet template: it is
+ * detached from the world and freed along with the emitter body.
+ */
+Emitter *
+emitter_new(Body *body, Body *bullet, const EmitterPattern *p)
+{
+        assert(body && bullet && p && body->world == bullet->world);
+        assert(!(body->flags & BODY_EMITTER) && body != bullet);
+        assert(p->count > 0 && p->rate > 0.0);
+        
+        extern mem_pool mp_emitter;
+        Emitter *em = mp_alloc(&mp_emitter);
+        em->pattern = *p;
+        em->bullet = bullet;
+        em->charge = 1.0;       /* First volley goes out right away. */
+        body_detach(bullet);
+        
+        body->step_func = (intptr_t)emitter_step;
+        body->step_cb_data = (intptr_t)em;
+        body->flags |= BODY_STEP_C | BODY_EMITTER;
+        return em;
+}
+
+/*
+ * Free emitter state. Its bullet template is a body of the same world and is
+ * freed separately (see body_destroy()).
+ */
+void
+emitter_release(Emitter *em)
+{
+        extern mem_pool mp_emitter;
+        mp_free(&mp_emitter, em);
+}
+
+/*
+ * Bullet lifetime timer. Spent bullets are parked for reuse.
+ */
+static void
+bullet_expire(void *bullet, intptr_t data)
+{
+        UNUSED(data);
+        body_recycle(bullet);
+}
+
+/*
+ * Clone bullet template and send it off in direction `angle`.
+ */
+static void
+emit_bullet(Emitter *em, vect_f origin, float angle)
+{
+        const EmitterPattern *p = &em->pattern;
+        World *world = em->bullet->world;
+        Body *b = body_reuse(&world->static_body, em->bullet);
+        body_resume(b);         /* Template itself is paused. */
+        body_set_pos(b, origin);
+        b->prevstep_pos = origin;
+        
+        vect_f dir = {cosf(angle), sinf(angle)};
+        b->vel = (vect_f){dir.x * p->speed, dir.y * p->speed};
+        b->acc = (vect_f){dir.x * p->accel, dir.y * p->accel};
+        if (b->step_func == 0) {
+                b->step_func = (intptr_t)stepfunc_std;
+                b->flags |= BODY_STEP_C;
+        }
+        if (p->lifetime > 0.0) {
+                body_add_timer(b, b, p->lifetime, OBJTYPE_TIMER_C,
+                               (intptr_t)bullet_expire, 0);
+        }
+}
+
+/*
+ * Fire one volley from emitter body's current (absolute) position.
+ */
+static void
+emit_volley(Emitter *em, Body *body)
+{
+        const EmitterPattern *p = &em->pattern;
+        vect_f origin = body_absolute_pos(body);
+        
+        /* Base direction: fixed angle, plus spin, sine sweep, and aim. */
+        float base = p->angle + em->fired * p->spin;
+        if (p->amplitude != 0.0)
+                base += p->amplitude * sinf(2.0 * M_PI * p->frequency *
+                                            em->time);
+        if (p->aimed) {
+                vect_f d = vect_f_sub(p->aim, origin);
+                if (d.x != 0.0 || d.y != 0.0)
+                        base += atan2f(d.y, d.x);
+        }
+        
+        /*
+         * A full-circle arc spaces bullets evenly all the way around; a partial
+         * arc spreads them from edge to edge, centered on base direction.
+         */
+        unsigned n = p->count;
+        for (unsigned i = 0; i < n; i++) {
+                float a;
+                if (p->arc >= 2.0 * M_PI - 0.0001)
+                        a = base + i * p->arc / n;
+                else if (n == 1)
+                        a = base;
+                else
+                        a = base - p->arc / 2.0 + i * p->arc / (n - 1);
+                emit_bullet(em, origin, a);
+        }
+        em->fired++;
+}
+
+/*
+ * Emitter step function (see emitter_new()). An emitter body moves just like
+ * any other body with the standard step function, then fires volleys at the
+ * rate set in its pattern.
+ */
+void
+emitter_step(lua_State *L, void *body, intptr_t data)
+{
+        Body *b = body;
+        Emitter *em = (Emitter *)data;
+        const EmitterPattern *p = &em->pattern;
+        assert(b->flags & BODY_EMITTER);
+        
+        if (b->vel.x != 0.0 || b->vel.y != 0.0 ||
+            b->acc.x != 0.0 || b->acc.y != 0.0)
+                stepfunc_std(L, body, 0);
+        
+        em->charge += p->rate * b->world->step_sec;
+        while (em->charge >= 1.0) {
+                if (p->volleys != 0 && em->fired >= p->volleys) {
+                        em->charge = 0.0;       /* Done firing. */
+                        break;
+                }
+                em->charge -= 1.0;
+                emit_volley(em, b);
+        }
+        em->time += b->world->step_sec;
+}
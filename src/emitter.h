@@ -0,0 +1,66 @@
+#ifndef GAME2D_EMITTER_H
+#define GAME2D_EMITTER_H
+
+#include "common.h"
+#include "body.h"
+
+/*
+ * Emitter pattern presets. They only differ in the defaults that
+ * emitter_pattern_init() fills in; every field can be overridden afterwards.
+ *
+ * EMITTER_RING         Volleys of bullets evenly spaced around a full circle.
+ * EMITTER_SPIRAL       Single bullets, direction advancing with each volley.
+ * EMITTER_SPREAD       Fan of bullets centered on base (or aimed) direction.
+ * EMITTER_WAVE         Base direction sweeps back and forth along a sine.
+ */
+enum {
+        EMITTER_RING = 1,
+        EMITTER_SPIRAL,
+        EMITTER_SPREAD,
+        EMITTER_WAVE
+};
+
+/*
+ * Declarative description of a bullet pattern. Angles are in radians, zero
+ * pointing along the positive X axis.
+ */
+typedef struct {
+        int             type;           /* One of EMITTER_* presets. */
+        unsigned        count;          /* Bullets per volley. */
+        float           arc;            /* Spread of a volley (2*pi = ring). */
+        float           angle;          /* Base direction. */
+        float           spin;           /* Added to direction each volley. */
+        float           amplitude;      /* Sine sweep amplitude. */
+        float           frequency;      /* Sine sweep frequency (Hz). */
+        float           rate;           /* Volleys per second. */
+        float           speed;          /* Initial bullet speed. */
+        float           accel;          /* Acceleration along direction. */
+        float           lifetime;       /* Bullet lifetime (0 = forever). */
+        unsigned        volleys;        /* Volleys to fire (0 = unlimited). */
+        int             aimed;          /* Aim base direction at `aim`. */
+        vect_f          aim;            /* Absolute target position. */
+} EmitterPattern;
+
+/*
+ * Emitter state, owned by the body it is attached to (see BODY_EMITTER).
+ *
+ * bullet       Template body that is cloned for every bullet. The emitter owns
+ *              it; it is detached from the world (see body_detach()).
+ * time         Seconds since emitter was created.
+ * charge       Accumulated fraction of the next volley.
+ * fired        Number of volleys fired so far.
+ */
+typedef struct {
+        EmitterPattern  pattern;
+        Body            *bullet;
+        float           time;
+        float           charge;
+        unsigned        fired;
+} Emitter;
+
+void     emitter_pattern_init(EmitterPattern *p, int type);
+Emitter *emitter_new(Body *body, Body *bullet, const EmitterPattern *p);
+void     emitter_release(Emitter *em);
+void     emitter_step(lua_State *L, void *body, intptr_t data);
+
+#endif  /* GAME2D_EMITTER_H */
@@ -8,25 +8,24 @@
 #include "uthash_tuned.h"
 #include "util_lua.h"
 
+#if ENABLE_LUA
+
 static void
 callfunc_prepare(lua_State *L, EventFunc *bind)
 {
-        extern int callfunc_index;
-        lua_pushvalue(L, callfunc_index);               /* + callfunc */
-        assert(lua_isfunction(L, -1));
-        lua_pushinteger(L, bind->func.lua_func_id);     /* + func_id */
-        lua_pushinteger(L, bind->callback_data);        /* + arg_id  */
-        lua_pushboolean(L, 0);                          /* + false   */
+        L_callback_push(L, bind->func.lua_func_id);    /* + func */
 }
 
 static void
-callfunc_call(lua_State *L, unsigned num_args, unsigned num_ret)
+callfunc_call(lua_State *L, EventFunc *bind, unsigned num_args,
+              unsigned num_ret)
 {
-        extern int errfunc_index;
-        if (lua_pcall(L, num_args + 3, num_ret, errfunc_index))
-                fatal_error("[Lua] %s", lua_tostring(L, -1));
+        L_callback_call(L, bind->func.lua_func_id, bind->callback_data, 0,
+                        num_args, num_ret);
 }
 
+#endif  /* ENABLE_LUA */
+
 
 #if ENABLE_KEYS
 
@@ -512,7 +511,7 @@ exec_key_binding(lua_State *L, SDL_Keysym key, int key_down)
         lua_pushinteger(L, key.sym);
         lua_rawset(L, -3);
         lua_pushboolean(L, key_down);   /* + pressed */
-        callfunc_call(L, 2, 0);
+        callfunc_call(L, &key_bind, 2, 0);
 #else
         abort();
 #endif
@@ -558,7 +557,7 @@ exec_joybutton(lua_State *L, SDL_JoyButtonEvent ev)
         lua_pushinteger(L, ev.which);                   /* + joyID    */
         lua_pushinteger(L, ev.button);                  /* + buttonID */
         lua_pushboolean(L, ev.state == SDL_PRESSED);    /* + pressed  */
-        callfunc_call(L, 3, 0);
+        callfunc_call(L, &joybutton_bind, 3, 0);
 #else
         abort();
 #endif
@@ -574,7 +573,7 @@ exec_joyaxis(lua_State *L, SDL_JoyAxisEvent ev)
         lua_pushinteger(L, ev.which);                   /* + joyID  */
         lua_pushinteger(L, ev.axis);                    /* + axisID */
         lua_pushnumber(L, (float)ev.value / (32767 + (ev.value < 0)));
-        callfunc_call(L, 3, 0);
+        callfunc_call(L, &joyaxis_bind, 3, 0);
 #else
         abort();
 #endif
@@ -903,7 +902,7 @@ exec_mouseclick(lua_State *L, SDL_MouseButtonEvent ev)
                 lua_pushinteger(L, ev.button);               /* + buttonID */
                 lua_pushboolean(L, ev.state == SDL_PRESSED); /* + pressed  */
                 L_push_vectf(L, screenpos_to_world(cam, (vect_i){ev.x, ev.y}));
-                callfunc_call(L, 4, 1);
+                callfunc_call(L, bind, 4, 1);
                 
                 /*
                  * If a non-false value is returned from handler, it means user
@@ -950,7 +949,7 @@ exec_mousemove(lua_State *L, SDL_MouseMotionEvent ev)
                 L_push_vectf(L, screenpos_to_world(cam, (vect_i){ev.x, ev.y}));
                 L_push_vectf(L, screendelta_to_world(cam,
                                                   (vect_i){ev.xrel, ev.yrel}));
-                callfunc_call(L, 3, 1);
+                callfunc_call(L, bind, 3, 1);
                 
                 /*
                  * If a non-false value is returned from handler, it means user
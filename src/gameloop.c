@@ -4,6 +4,9 @@
 #include "render.h"
 #include "gameloop.h"
 #include "audio.h"
+#include "init.h"
+#include "manifest.h"
+#include "texture.h"
 
 Camera  *cam_list;      /* List of all cameras (sorted by "sort" value). */
 Camera  *debug_cam;     /* Camera rendering debugging visuals. */
@@ -23,6 +26,8 @@ static float frames_per_second;
  */
 uint64_t game_time;
 
+unsigned gc_frame_step;         /* Set by eapi.SetGC(). */
+
 void
 run_game(lua_State *L)
 {
@@ -96,6 +101,7 @@ run_game(lua_State *L)
          * loop above. Must do this here so scripts get a chance to set
          * everything up before a frame is rendered.
          */
+        int trimme = 0;
         for (World *world = mp_first(&mp_world); world != NULL;) {
                 if (world->killme) {
                         /*
@@ -105,6 +111,7 @@ run_game(lua_State *L)
                         World *tmp = world;
                         world = mp_next(world);
                         world_free(tmp);
+                        trimme = config.pool_trim;
                         continue;
                 }
                 
@@ -120,10 +127,14 @@ run_game(lua_State *L)
                 }
                 world = mp_next(world);
         }
+        if (trimme)
+                trim_memory();  /* Release memory left over from last level. */
         
         /*
          * Draw what each camera sees.
          */
+        manifest_new_frame();
+        texture_new_frame();
         render_clear();
         for (Camera *cam = cam_list; cam != NULL; cam = cam->next) {
                 if (!cam->disabled)
@@ -135,4 +146,9 @@ run_game(lua_State *L)
         if (debug_cam != NULL && debug_cam->objtype == OBJTYPE_CAMERA)
                 render_debug(debug_cam);
 #endif
+#if ENABLE_LUA
+        /* Incremental garbage collection work, a little every frame. */
+        if (gc_frame_step > 0)
+                lua_gc(L, LUA_GCSTEP, gc_frame_step);
+#endif
 }
@@ -5,4 +5,7 @@
 
 void    run_game(lua_State *L);
 
+/* Lua garbage collection work (kilobytes) done after every frame. */
+extern unsigned gc_frame_step;
+
 #endif  /* GAME2D_GAMELOOP_H */
@@ -176,6 +176,103 @@ bb_intersect_resolve(const BB *a, const BB *b, BB *resolve)
         return 1;
 }
 
+/*
+ * Distance from point (x, y) to the closest point of box, along each axis. Zero
+ * along an axis where the point is within the box's extent.
+ */
+static void
+bb_point_gap(const BB *bb, int x, int y, double *gap_x, double *gap_y)
+{
+        *gap_x = (x < bb->l) ? bb->l - x : (x > bb->r) ? x - bb->r : 0;
+        *gap_y = (y < bb->b) ? bb->b - y : (y > bb->t) ? y - bb->t : 0;
+}
+
+/*
+ * Return true if circle and bounding box overlap. As with bb_overlap(), shapes
+ * that merely touch do not overlap.
+ */
+int
+circle_overlap_bb(const Circle *c, const BB *bb)
+{
+        assert(c != NULL && bb != NULL && bb_valid(*bb));
+        
+        double gx, gy, r = c->radius;
+        bb_point_gap(bb, c->offset.x, c->offset.y, &gx, &gy);
+        return gx * gx + gy * gy < r * r;
+}
+
+/*
+ * Circle versus circle version of bb_intersect_resolve(). Each of the four
+ * resolve distances moves circle [b] along one axis until it only touches
+ * circle [a].
+ */
+int
+circle_intersect_resolve(const Circle *a, const Circle *b, BB *resolve)
+{
+        assert(resolve != NULL && a != NULL && b != NULL);
+        
+        double dx = b->offset.x - a->offset.x;
+        double dy = b->offset.y - a->offset.y;
+        double R = (double)a->radius + b->radius;
+        if (dx * dx + dy * dy > R * R)
+                return 0; /* No intersection. */
+        
+        /* Half-chords of the radius sum circle at the current offsets. */
+        double hx = sqrt(R * R - dy * dy);
+        double hy = sqrt(R * R - dx * dx);
+        resolve->t = ceil(hy - dy);
+        resolve->b = floor(-hy - dy);
+        resolve->r = ceil(hx - dx);
+        resolve->l = floor(-hx - dx);
+        return 1;
+}
+
+/*
+ * What can be done to move circle [b] out of box [a]? See
+ * bb_intersect_resolve().
+ */
+int
+bb_circle_intersect_resolve(const BB *a, const Circle *b, BB *resolve)
+{
+        assert(resolve != NULL && b != NULL);
+        assert(a != NULL && bb_valid(*a));
+        
+        double gx, gy, r = b->radius;
+        bb_point_gap(a, b->offset.x, b->offset.y, &gx, &gy);
+        if (gx * gx + gy * gy > r * r)
+                return 0; /* No intersection. */
+        
+        /*
+         * Circle extent along one axis, measured where it is closest to the
+         * box on the other axis.
+         */
+        double hx = sqrt(r * r - gy * gy);
+        double hy = sqrt(r * r - gx * gx);
+        resolve->t = ceil(a->t + hy - b->offset.y);
+        resolve->b = floor(a->b - hy - b->offset.y);
+        resolve->r = ceil(a->r + hx - b->offset.x);
+        resolve->l = floor(a->l - hx - b->offset.x);
+        return 1;
+}
+
+/*
+ * What can be done to move box [b] out of circle [a]? See
+ * bb_intersect_resolve().
+ */
+int
+circle_bb_intersect_resolve(const Circle *a, const BB *b, BB *resolve)
+{
+        /* Moving the box one way is the same as moving the circle the other. */
+        BB circle_resolve;
+        if (!bb_circle_intersect_resolve(b, a, &circle_resolve))
+                return 0;
+        resolve->t = -circle_resolve.b;
+        resolve->b = -circle_resolve.t;
+        resolve->r = -circle_resolve.l;
+        resolve->l = -circle_resolve.r;
+        return 1;
+}
+
 void
 bb_add_vect(BB *bb, vect_i v)
 {
@@ -63,6 +63,16 @@ int     bb_intersect_resolve(const BB *a, const BB *b, BB *resolve);
 void    bb_union(BB *bb, BB add);
 void    bb_add_vect(BB *bb, vect_i v);
 
+/*
+ * Circle functions. Circle offset is its center, expressed in the same
+ * coordinate space as the boxes it is tested against. Resolve values have the
+ * same meaning as in bb_intersect_resolve().
+ */
+int     circle_overlap_bb(const Circle *c, const BB *bb);
+int     circle_intersect_resolve(const Circle *a, const Circle *b, BB *resolve);
+int     bb_circle_intersect_resolve(const BB *a, const Circle *b, BB *resolve);
+int     circle_bb_intersect_resolve(const Circle *a, const BB *b, BB *resolve);
+
 /* 2D integer vector functions. */
 float   vect_i_size(vect_i v);
 int     vect_i_dot(vect_i a, vect_i b);
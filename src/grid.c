@@ -37,6 +37,9 @@ grid_init(Grid *grid, BB area, int size)
         grid->array = mem_alloc(sizeof(**grid->array) * grid->num_cells, "Grid cells");
         memset(grid->array, 0, sizeof(**grid->array) * grid->num_cells);
         
+        mem_pool_init(&grid->cellpool, sizeof(GridCell),
+                      config.poolsize.gridcell, "GridCell");
+        
 #ifndef NDEBUG
         /* Cell usage statistics. */
         grid->cellstat = mem_alloc(sizeof(*grid->cellstat) * grid->num_cells, "Grid stats");
@@ -45,21 +48,16 @@ grid_init(Grid *grid, BB area, int size)
 }
 
 /*
- * Destroy grid.
+ * Destroy grid. Objects that are still in the grid are simply forgotten: their
+ * cells are freed along with the grid's cell pool.
  */
 void
 grid_destroy(Grid *grid)
 {
 #ifndef NDEBUG
-        /* Make sure the grid is empty. */
-        assert(grid->num_objects == 0);
-        for (unsigned i = 0; i < grid->num_cells; i++) {
-                assert(grid->array[i] == NULL);
-                assert(grid->cellstat[i].current == 0);
-        }
-        
         mem_free(grid->cellstat);
 #endif
+        mem_pool_free(&grid->cellpool);
         mem_free(grid->array);
         memset(grid, 0, sizeof(*grid));
 }
@@ -220,8 +218,7 @@ grid_add(Grid *grid, GridObject *object, void *ptr, BB newarea)
                         int index = (x - cells.l) + (y - cells.b) * cols;
                         assert(index < (int)(grid->num_cells * sizeof(void *)));
                         
-                        extern mem_pool mp_gridcell;
-                        GridCell *cell = mp_alloc(&mp_gridcell);
+                        GridCell *cell = mp_alloc_raw(&grid->cellpool);
                         cell->gridobj = object;
                         LL_PREPEND(array[index], cell);
 #ifndef NDEBUG
@@ -280,10 +277,9 @@ grid_remove(Grid *grid, GridObject *object)
                         grid->cellstat[index].current--;
 #endif
                         /* Handle case where first list element is the one we're looking for. */
-                        extern mem_pool mp_gridcell;
                         if (cell_list->gridobj == object) {
                                 array[index] = cell_list->next;         /* Remove from list. */
-                                mp_free(&mp_gridcell, cell_list);       /* Free cell struct. */
+                                mp_free(&grid->cellpool, cell_list);    /* Free cell struct. */
                                 continue;
                         }
                         
@@ -292,7 +288,7 @@ grid_remove(Grid *grid, GridObject *object)
                         for (;;) {
                                 if (cell->gridobj == object) {
                                         cell_list->next = cell->next;   /* Remove from list. */
-                                        mp_free(&mp_gridcell, cell);    /* Free cell struct. */
+                                        mp_free(&grid->cellpool, cell); /* Free cell struct. */
                                         break;
                                 }
                                 cell_list = cell;
@@ -374,11 +370,10 @@ grid_update(Grid *grid, GridObject *object, BB newarea)
                          * Handle case where first list element is the one we're
                          * looking for.
                          */
-                        extern mem_pool mp_gridcell;
                         if (cell_list->gridobj == object) {
                                 /* Remove from list and free cell struct. */
                                 array[index] = cell_list->next;   
-                                mp_free(&mp_gridcell, cell_list);
+                                mp_free(&grid->cellpool, cell_list);
                                 continue;
                         }
                         
@@ -388,7 +383,7 @@ grid_update(Grid *grid, GridObject *object, BB newarea)
                                 if (cell->gridobj == object) {
                                         /* Remove from list and free cell. */
                                         cell_list->next = cell->next;
-                                        mp_free(&mp_gridcell, cell);
+                                        mp_free(&grid->cellpool, cell);
                                         break;
                                 }
                                 cell_list = cell;
@@ -403,8 +398,7 @@ grid_update(Grid *grid, GridObject *object, BB newarea)
                         int index = (x - cells.l) + (y - cells.b) * cols;
                         assert(index < (int)(grid->num_cells * sizeof(void *)));
                         
-                        extern mem_pool mp_gridcell;
-                        GridCell *cell = mp_alloc(&mp_gridcell);
+                        GridCell *cell = mp_alloc_raw(&grid->cellpool);
                         cell->gridobj = object;
                         LL_PREPEND(array[index], cell);
 #ifndef NDEBUG
@@ -31,6 +31,7 @@ typedef struct {
         BB              area;                   /* Grid area coords. */
         uint            cols, num_cells;        /* Number of columns, and total number of cells. */
         GridCell        **array;                /* Array of linked lists of cells. */
+        mem_pool        cellpool;               /* Memory for list nodes. */
 #ifndef NDEBUG
         uint            num_expansions;         /* Number of expansions. */
         uint            num_objects;            /* Number of objects added. */
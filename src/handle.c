@@ -0,0 +1,97 @@
+#include <assert.h>
+#include "handle.h"
+#include "log.h"
+#include "mem.h"
+
+/*
+ * Handle layout, from least significant bit: tag bit (always set), slot index,
+ * slot generation. LuaJIT only accepts light userdata that fits in 47 bits (and
+ * GC64 builds limit how many distinct upper bit patterns there may be), so with
+ * LuaJIT handles are kept within the lower 39 bits.
+ */
+#if UINTPTR_MAX > 0xffffffffu && ENABLE_LUAJIT
+#define INDEX_BITS      22
+#define GEN_BITS        16
+#elif UINTPTR_MAX > 0xffffffffu
+#define INDEX_BITS      31
+#define GEN_BITS        32
+#else
+#define INDEX_BITS      20
+#define GEN_BITS        11
+#endif
+#define INDEX_MASK      (((uintptr_t)1 << INDEX_BITS) - 1)
+#define GEN_MASK        (((uintptr_t)1 << GEN_BITS) - 1)
+
+#define handle_index(h) (((h) >> 1) & INDEX_MASK)
+#define handle_gen(h)   (((h) >> (1 + INDEX_BITS)) & GEN_MASK)
+
+/*
+ * Handle table slot. Free slots form a list through `next_free`.
+ */
+typedef struct {
+        void            *obj;           /* NULL if slot is free. */
+        uintptr_t       gen;            /* Current generation (never zero). */
+        uintptr_t       next_free;      /* Next free slot index, or zero. */
+} HandleSlot;
+
+/* Slot zero is never used, so that no valid handle has a zero index. */
+static HandleSlot *slots;
+static uintptr_t num_slots = 1, max_slots, free_slot;
+
+/*
+ * Allocate handle for object `obj`.
+ */
+Handle
+handle_new(void *obj)
+{
+        assert(obj != NULL && !handle_is(obj));
+        
+        uintptr_t index = free_slot;
+        if (index != 0) {
+                free_slot = slots[index].next_free;
+        } else {
+                if (num_slots == max_slots) {
+                        max_slots = max_slots ? max_slots * 2 : 1024;
+                        if (max_slots - 1 > INDEX_MASK)
+                                fatal_error("Out of object handles.");
+                        mem_realloc((void **)&slots,
+                                    max_slots * sizeof(HandleSlot),
+                                    "Handle table");
+                }
+                index = num_slots++;
+                slots[index].gen = 1;
+        }
+        slots[index].obj = obj;
+        slots[index].next_free = 0;
+        return 1 | (index << 1) | (slots[index].gen << (1 + INDEX_BITS));
+}
+
+/*
+ * Invalidate handle. Its slot gets a new generation and is reused later.
+ */
+void
+handle_free(Handle h)
+{
+        assert(handle_get(h) != NULL);
+        HandleSlot *slot = &slots[handle_index(h)];
+        slot->obj = NULL;
+        slot->gen = (slot->gen + 1) & GEN_MASK;
+        if (slot->gen == 0)
+                slot->gen = 1;
+        slot->next_free = free_slot;
+        free_slot = handle_index(h);
+}
+
+/*
+ * Return object that handle refers to, or NULL if the handle is stale (or not
+ * a handle at all).
+ */
+void *
+handle_get(Handle h)
+{
+        uintptr_t index = handle_index(h);
+        if (!handle_is(h) || index == 0 || index >= num_slots)
+                return NULL;
+        HandleSlot *slot = &slots[index];
+        return (slot->gen == handle_gen(h)) ? slot->obj : NULL;
+}
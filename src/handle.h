@@ -0,0 +1,33 @@
+#ifndef GAME2D_HANDLE_H
+#define GAME2D_HANDLE_H
+
+#include "common.h"
+
+/*
+ * Generational object handles.
+ *
+ * Bodies, tiles, and shapes are handed out to scripts as handles rather than
+ * as raw pointers. A handle packs an index into the handle table together with
+ * the generation of that table slot. Freeing an object bumps its slot's
+ * generation, so a stale handle is detected in O(1) -- in release builds too,
+ * and even if the object's memory has been reused since.
+ *
+ * Handles are pointer-sized and have bit 0 set. Object pointers are aligned,
+ * so a handle can travel wherever a pointer does (as Lua light userdata, for
+ * example) and still be told apart from one (see handle_is()).
+ *
+ * Limits: 2^31 live handles with 32-bit generations on 64-bit builds; 2^22 live
+ * handles with 16-bit generations on 64-bit LuaJIT builds (handles then fit in
+ * 39 bits, see handle.c); 2^20 handles with 11-bit generations on 32-bit
+ * builds. Generations wrap around, so a stale handle is only caught as long as
+ * its slot has not been reused that many times since.
+ */
+typedef uintptr_t Handle;
+
+#define handle_is(p) (((uintptr_t)(p) & 1) != 0)
+
+Handle   handle_new(void *obj);
+void     handle_free(Handle h);
+void    *handle_get(Handle h);
+
+#endif  /* GAME2D_HANDLE_H */
@@ -6,14 +6,20 @@
 #include "misc.h"
 #include "eapi_C.h"
 #include "init.h"
+#include "manifest.h"
+#include "texcache.h"
 #include "texture.h"
 #include "OpenGL_include.h"
 #include "audio.h"
+#include "emitter.h"
+#include "stepfunc.h"
 
-/* Memory pools. */
-mem_pool mp_body, mp_camera, mp_group, mp_shape;
-mem_pool mp_sprite, mp_texture, mp_tile, mp_timer, mp_gridcell;
-mem_pool mp_world, mp_property, mp_collision;
+/*
+ * Memory pools. Bodies, tiles, shapes, timers, grid cells, and collisions are
+ * allocated from pools that each world has of its own (see World).
+ */
+mem_pool mp_camera, mp_group, mp_sprite, mp_texture;
+mem_pool mp_world, mp_property, mp_emitter, mp_stepparams;
 #if TRACE_MAX
 mem_pool mp_bodytrace, mp_tiletrace, mp_shapetrace;
 #endif
@@ -44,6 +50,10 @@ cleanup(void)
 #if ENABLE_AUDIO
         audio_close();  /* Close audio if it was opened. */
 #endif
+        if (config.pool_report)
+                mem_report();
+        manifest_close();
+        texcache_close();
         SDL_Quit();     /* Finally, kill SDL. */
 }
 
@@ -51,21 +61,18 @@ void
 setup_memory(void)
 {
         struct poolsize_t *ps = &config.poolsize;
-        mem_pool_init(&mp_body, sizeof(Body), ps->body, "Body");
+        mem_quarantine = config.pool_quarantine;
         mem_pool_init(&mp_camera, sizeof(Camera), ps->camera, "Camera");
         mem_pool_init(&mp_group, sizeof(Group), ps->group,
                       "Shape collision group");
-        mem_pool_init(&mp_shape, sizeof(Shape), ps->shape, "Shape");
         mem_pool_init(&mp_sprite, sizeof(SpriteList), ps->spritelist,
                       "SpriteList");
         mem_pool_init(&mp_texture, sizeof(Texture), ps->texture, "Texture");
-        mem_pool_init(&mp_tile, sizeof(Tile), ps->tile, "Tile");
-        mem_pool_init(&mp_timer, sizeof(Timer), ps->timer, "Timer");
-        mem_pool_init(&mp_gridcell, sizeof(GridCell), ps->gridcell, "GridCell");
         mem_pool_init(&mp_world, sizeof(World), ps->world, "World");
         mem_pool_init(&mp_property, sizeof(Property), ps->property, "Property");
-        mem_pool_init(&mp_collision, sizeof(Collision), ps->collision,
-                      "Collision");        
+        mem_pool_init(&mp_emitter, sizeof(Emitter), ps->emitter, "Emitter");
+        mem_pool_init(&mp_stepparams, sizeof(StepParams), ps->stepparams,
+                      "StepParams");
 #if ENABLE_TOUCH
         mem_pool_init(&mp_touch, sizeof(Touch), ps->touch, "Touch");
 #endif
@@ -83,6 +90,36 @@ setup_memory(void)
 #endif
 }
 
+/*
+ * Release memory that pools acquired while growing beyond their configured
+ * size. Only chunks with no allocated records are released. (Per-world pools
+ * are released whole along with their world.)
+ */
+void
+trim_memory(void)
+{
+        mem_pool *pools[] = {
+                &mp_camera, &mp_group, &mp_sprite, &mp_texture, &mp_world,
+                &mp_property, &mp_emitter, &mp_stepparams,
+#if ENABLE_TOUCH
+                &mp_touch,
+#if !ENABLE_SDL_VIDEO
+                &mp_hackevent,
+#endif
+#endif
+#if TRACE_MAX
+                &mp_bodytrace, &mp_tiletrace, &mp_shapetrace,
+#endif
+        };
+        for (unsigned i = 0; i < sizeof(pools)/sizeof(pools[0]); i++) {
+                uint released = mp_trim(pools[i]);
+                if (released > 0) {
+                        log_msg("[MEM] Pool `%s` trimmed by %u cells.",
+                                pools[i]->name, released);
+                }
+        }
+}
+
 #if PLATFORM_IOS
 #include <sys/sysctl.h>
 
@@ -407,6 +444,16 @@ parse_cmd_opt(int argc, char *argv[])
         extern int opterr;
         extern char *optarg;
         
+        /* Long options are not understood by getopt_bsd(); take them out. */
+        for (int i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "--pool-report") != 0)
+                        continue;
+                config.pool_report = 1;
+                memmove(&argv[i], &argv[i + 1], (argc - i) * sizeof(*argv));
+                argc--;
+                i--;
+        }
+        
         opterr = 0;     /* Disable getopt_bsd() error reporting. */
         while ((opt = getopt_bsd(argc, argv, "fwL:")) != -1) {
                 switch (opt) {
@@ -422,11 +469,13 @@ parse_cmd_opt(int argc, char *argv[])
                         break;
 #ifndef __APPLE__
                 default:
-                        log_msg("Usage: %s [-f] [-w] [-L app_location]",
-                                argv[0]);
+                        log_msg("Usage: %s [-f] [-w] [-L app_location] "
+                                "[--pool-report]", argv[0]);
                         log_msg("\t-w\tRun in windowed mode.");
                         log_msg("\t-f\tRun in fullscreen mode.");
                         log_msg("\t-L\tPath to application directory.");
+                        log_msg("\t--pool-report\tPrint memory pool usage on "
+                                "exit.");
                         exit(EXIT_FAILURE);
 #endif
                 }
@@ -9,6 +9,7 @@ void             bind_main_framebuffer(void);
 void             draw_main_framebuffer(void);
 
 void             setup_memory(void);
+void             trim_memory(void);
 void             cleanup(void);
 void             parse_cmd_opt(int argc, char *argv[]);
 SDL_Window      *create_window(void);
@@ -13,8 +13,11 @@
 #include "gameloop.h"
 #include "init.h"
 #include "log.h"
+#include "manifest.h"
 #include "OpenGL_include.h"
+#include "texcache.h"
 #include "texture.h"
+#include "texture_async.h"
 #include "audio.h"
 #include "misc.h"
 
@@ -34,7 +37,7 @@ void    cleanup_framebuffer(void);
 
 int     eapi_index;     /* "eapi" namespace table stack location. */
 int     errfunc_index;  /* Error handler stack location. */
-int     callfunc_index; /* eapi.__CallFunc. */
+int     idmap_index;    /* eapi.idToObjectMap (callback references). */
 
 /*
  * This function is pushed onto Lua stack, and its index is passed into
@@ -134,6 +137,11 @@ main(int argc, char *argv[])
         /* Allocate memory for pools & set atexit() which will free them. */
         setup_memory();
         atexit(cleanup);
+        if (*config.texture_cache != '\0')
+                texcache_open(config.texture_cache);
+        if (*config.manifest != '\0')
+                manifest_open(config.manifest);
+        texasync_thread_start();
 #if ENABLE_AUDIO
         audio_init();
 #endif
@@ -142,6 +150,7 @@ main(int argc, char *argv[])
 #if !ENABLE_SDL2
         UNUSED(win);
 #endif
+        texture_check_extensions();
         /* Print OpenGL extension string. */
         if (cfg_get_bool("printExtensions"))
                 log_msg("OpenGL extensions: %s", glGetString(GL_EXTENSIONS));
@@ -179,10 +188,12 @@ main(int argc, char *argv[])
 	eapi_register(L);
 	
 	/*
-         * Leave eapi.__CallFunc function on stack since we use it often.
+         * Leave eapi.idToObjectMap on stack: callbacks are looked up there
+         * directly whenever the engine calls into Lua.
          */
-	lua_getfield(L, eapi_index, "__CallFunc");
-	callfunc_index = lua_gettop(L);
+	lua_getfield(L, eapi_index, "idToObjectMap");
+	assert(lua_istable(L, -1));
+	idmap_index = lua_gettop(L);
         
         /* Execute user script. */
 	if ((luaL_loadfile(L, "script/first.lua") ||
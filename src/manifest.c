@@ -0,0 +1,351 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "manifest.h"
+#include "audio.h"
+#include "log.h"
+#include "mem.h"
+#include "texture.h"
+#include "texture_async.h"
+#include "uthash_tuned.h"
+
+/*
+ * Manifest file is plain text, one entry per line:
+ *
+ *      scene <name>            Following lines belong to this scene.
+ *      next <name>             Scene that has been entered from this one.
+ *      texture <flags> <name>  Texture loaded while scene was running.
+ *      sound <name>            Sound effect played while scene was running.
+ *      music <name>            Music played while scene was running.
+ *
+ * Lines starting with '#' are comments. The file is rewritten on exit if
+ * anything new has been recorded.
+ */
+#define MANIFEST_NEXT_MAX       4       /* Successors kept per scene. */
+
+typedef struct {
+        char            name[128];
+        int             type;           /* MANIFEST_TEXTURE etc. */
+        unsigned        flags;          /* Texture flags. */
+        UT_hash_handle  hh;
+} Asset;
+
+typedef struct {
+        char            name[64];
+        Asset           *assets;
+        char            next[MANIFEST_NEXT_MAX][64];
+        unsigned        num_next;
+        UT_hash_handle  hh;
+} Scene;
+
+static const char *type_names[] = {"texture", "sound", "music"};
+
+static char     manifest_file[128];     /* Empty if manifest is not in use. */
+static Scene    *scene_hash;
+static Scene    *current;               /* Scene that is running right now. */
+static int      switching;              /* Scene switch in progress. */
+static int      dirty;                  /* Anything new since file was read. */
+static unsigned hitches;                /* Assets loaded during gameplay. */
+
+static Scene *
+scene_lookup_or_create(const char *name)
+{
+        Scene *s;
+        HASH_FIND_STR(scene_hash, name, s);
+        if (s != NULL)
+                return s;
+        
+        s = mem_alloc(sizeof(Scene), "Manifest scene");
+        memset(s, 0, sizeof(*s));
+        assert(strlen(name) < sizeof(s->name));
+        strcpy(s->name, name);
+        HASH_ADD_STR(scene_hash, name, s);
+        return s;
+}
+
+/*
+ * Add asset to scene. Returns false if scene already had it.
+ */
+static int
+scene_add_asset(Scene *s, int type, const char *name, unsigned flags)
+{
+        Asset *a;
+        HASH_FIND_STR(s->assets, name, a);
+        if (a != NULL)
+                return 0;
+        
+        a = mem_alloc(sizeof(Asset), "Manifest asset");
+        memset(a, 0, sizeof(*a));
+        assert(strlen(name) < sizeof(a->name));
+        strcpy(a->name, name);
+        a->type = type;
+        a->flags = flags;
+        HASH_ADD_STR(s->assets, name, a);
+        return 1;
+}
+
+/*
+ * Remember that scene `next` followed scene `s`. Only the most recently seen
+ * successors are kept. Returns false if `next` was already known.
+ */
+static int
+scene_add_next(Scene *s, const char *next)
+{
+        for (unsigned i = 0; i < s->num_next; i++) {
+                if (strcmp(s->next[i], next) == 0)
+                        return 0;
+        }
+        if (s->num_next == MANIFEST_NEXT_MAX) {
+                memmove(s->next[0], s->next[1],
+                        sizeof(s->next[0]) * (MANIFEST_NEXT_MAX - 1));
+                s->num_next--;
+        }
+        assert(strlen(next) < sizeof(s->next[0]));
+        strcpy(s->next[s->num_next++], next);
+        return 1;
+}
+
+static void
+read_file(FILE *f)
+{
+        char line[256];
+        Scene *s = NULL;
+        unsigned lineno = 0;
+        while (fgets(line, sizeof(line), f) != NULL) {
+                lineno++;
+                line[strcspn(line, "\r\n")] = '\0';
+                if (*line == '\0' || *line == '#')
+                        continue;
+        
+                /* Split line into keyword and argument. */
+                char *arg = strchr(line, ' ');
+                if (arg == NULL)
+                        goto bad_line;
+                *arg++ = '\0';
+        
+                if (strcmp(line, "scene") == 0) {
+                        if (*arg == '\0' || strlen(arg) >= sizeof(s->name))
+                                goto bad_line;
+                        s = scene_lookup_or_create(arg);
+                        continue;
+                }
+                if (s == NULL || *arg == '\0')
+                        goto bad_line;
+                if (strcmp(line, "next") == 0) {
+                        if (strlen(arg) >= sizeof(s->next[0]))
+                                goto bad_line;
+                        scene_add_next(s, arg);
+                        continue;
+                }
+        
+                int type;
+                unsigned flags = 0;
+                if (strcmp(line, "texture") == 0) {
+                        type = MANIFEST_TEXTURE;
+                        char *end;
+                        flags = strtoul(arg, &end, 10);
+                        if (end == arg || *end != ' ')
+                                goto bad_line;
+                        arg = end + 1;
+                } else if (strcmp(line, "sound") == 0) {
+                        type = MANIFEST_SOUND;
+                } else if (strcmp(line, "music") == 0) {
+                        type = MANIFEST_MUSIC;
+                } else {
+                        goto bad_line;
+                }
+                if (*arg == '\0' || strlen(arg) >= sizeof(((Asset *)0)->name))
+                        goto bad_line;
+                scene_add_asset(s, type, arg, flags);
+                continue;
+        bad_line:
+                log_err("[MANIFEST] `%s` line %u ignored.", manifest_file,
+                        lineno);
+        }
+}
+
+static void
+write_file(void)
+{
+        FILE *f = fopen(manifest_file, "w");
+        if (f == NULL) {
+                log_err("[MANIFEST] Cannot write to `%s`.", manifest_file);
+                return;
+        }
+        fprintf(f, "# Assets used by each scene. Written on exit; may be "
+                "removed to start over.\n");
+        for (Scene *s = scene_hash; s != NULL; s = s->hh.next) {
+                fprintf(f, "\nscene %s\n", s->name);
+                for (unsigned i = 0; i < s->num_next; i++)
+                        fprintf(f, "next %s\n", s->next[i]);
+                for (Asset *a = s->assets; a != NULL; a = a->hh.next) {
+                        if (a->type == MANIFEST_TEXTURE) {
+                                fprintf(f, "texture %u %s\n", a->flags,
+                                        a->name);
+                        } else {
+                                fprintf(f, "%s %s\n", type_names[a->type],
+                                        a->name);
+                        }
+                }
+        }
+        if (fclose(f) != 0)
+                log_err("[MANIFEST] Could not write `%s`.", manifest_file);
+}
+
+/*
+ * Read manifest from file (if it exists) and start recording. Without a call
+ * to this function, manifest_enter() and manifest_use() do nothing.
+ */
+void
+manifest_open(const char *filename)
+{
+        assert(filename && *filename && *manifest_file == '\0');
+        assert(strlen(filename) < sizeof(manifest_file));
+        strcpy(manifest_file, filename);
+        
+        FILE *f = fopen(filename, "r");
+        if (f != NULL) {
+                read_file(f);
+                fclose(f);
+        }
+        log_msg("[MANIFEST] %u scenes in `%s`.", HASH_COUNT(scene_hash),
+                filename);
+}
+
+/*
+ * Save manifest if anything has changed.
+ */
+void
+manifest_close(void)
+{
+        if (*manifest_file == '\0')
+                return;
+        if (hitches > 0) {
+                log_msg("[MANIFEST] %u assets were loaded during gameplay.",
+                        hitches);
+        }
+        if (dirty)
+                write_file();
+        dirty = 0;
+}
+
+/*
+ * Async loader callback for textures queued by preload().
+ */
+static void
+preload_done(const char *img_name, uint flags, void *cb_data)
+{
+        UNUSED(cb_data);
+        if (!texture_is_loaded(img_name, flags))
+                log_err("[MANIFEST] Could not preload `%s`.", img_name);
+}
+
+/*
+ * Queue scene's textures with the async loader. Sounds and music have no
+ * async loader; unless `audio` is false, they are loaded right away.
+ */
+static void
+preload(const Scene *s, int audio)
+{
+#if !ENABLE_AUDIO
+        UNUSED(audio);
+#endif
+        unsigned queued = 0;
+        for (Asset *a = s->assets; a != NULL; a = a->hh.next) {
+                switch (a->type) {
+                case MANIFEST_TEXTURE:
+                        if (texasync_running() &&
+                            !texture_is_loaded(a->name, a->flags)) {
+                                texasync_load(a->name, a->flags, 0,
+                                              preload_done, NULL);
+                                queued++;
+                        }
+                        break;
+#if ENABLE_AUDIO
+                case MANIFEST_SOUND:
+                        if (audio && audio_enabled())
+                                audio_preload(a->name);
+                        break;
+                case MANIFEST_MUSIC:
+                        if (audio && audio_enabled())
+                                audio_music_preload(a->name);
+                        break;
+#endif
+                }
+        }
+        if (queued > 0) {
+                log_msg("[MANIFEST] Preloading %u textures of `%s`.", queued,
+                        s->name);
+        }
+}
+
+/*
+ * Switch to scene `name`. Its assets (as recorded on previous runs) are
+ * preloaded, and so are textures of scenes that have followed it before, so
+ * that they are ready by the time those scenes are entered.
+ *
+ * Assets loaded from here until the next frame starts are counted as part of
+ * the scene switch; loads after that are reported as hitches.
+ */
+void
+manifest_enter(const char *name)
+{
+        if (*manifest_file == '\0')
+                return;
+        assert(name && *name);
+        if (strlen(name) >= sizeof(current->name)) {
+                log_err("[MANIFEST] Scene name `%s` is too long.", name);
+                current = NULL;
+                return;
+        }
+        
+        Scene *prev = current;
+        current = scene_lookup_or_create(name);
+        if (prev != NULL && scene_add_next(prev, name))
+                dirty = 1;
+        switching = 1;
+        
+        preload(current, 1);
+        for (unsigned i = 0; i < current->num_next; i++) {
+                Scene *s;
+                HASH_FIND_STR(scene_hash, current->next[i], s);
+                if (s != NULL && s != current)
+                        preload(s, 0);
+        }
+}
+
+/*
+ * Upload textures that the async loader has finished preloading, and end the
+ * scene switch (if any). Call once per frame before rendering.
+ */
+void
+manifest_new_frame(void)
+{
+        if (*manifest_file == '\0')
+                return;
+        if (texasync_running())
+                texasync_runsync((uintptr_t)preload_done, (uintptr_t)0);
+        switching = 0;
+}
+
+/*
+ * Record use of an asset in current scene. `loaded` tells whether the caller
+ * had to load it synchronously; outside of a scene switch, that is a hitch.
+ */
+void
+manifest_use(int type, const char *name, unsigned flags, int loaded)
+{
+        if (*manifest_file == '\0' || current == NULL)
+                return;
+        assert(type >= MANIFEST_TEXTURE && type <= MANIFEST_MUSIC);
+        if (strlen(name) >= sizeof(((Asset *)0)->name))
+                return;
+        if (scene_add_asset(current, type, name, flags))
+                dirty = 1;
+        if (loaded && !switching) {
+                log_warn("[MANIFEST] Hitch: %s `%s` loaded during scene "
+                         "`%s`.", type_names[type], name, current->name);
+                hitches++;
+        }
+}
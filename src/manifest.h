@@ -0,0 +1,24 @@
+#ifndef GAME2D_MANIFEST_H
+#define GAME2D_MANIFEST_H
+
+#include "common.h"
+
+/*
+ * Asset manifest: remembers which textures, sounds and music each scene used,
+ * and which scenes followed it. On later runs, assets of a scene and those of
+ * the scenes likely to come next are loaded ahead of time, so that gameplay is
+ * not held up by loading them on first use. See manifest.c for details.
+ */
+enum {
+        MANIFEST_TEXTURE,
+        MANIFEST_SOUND,
+        MANIFEST_MUSIC
+};
+
+void    manifest_open(const char *filename);
+void    manifest_close(void);
+void    manifest_enter(const char *scene);
+void    manifest_new_frame(void);
+void    manifest_use(int type, const char *name, unsigned flags, int loaded);
+
+#endif  /* GAME2D_MANIFEST_H */
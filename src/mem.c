@@ -157,11 +157,116 @@ mem_free(void *ptr)
         free(ptr);
 }
 
+/* Pool allocation mode (see mem.h). */
+int mem_quarantine = MEM_QUARANTINE;
+
+/* Cells freed during the current epoch are not reused until the next one. */
+static uint mem_epoch;
+
+/* List of all existing pools, and statistics of pools that have been freed. */
+static mem_pool *pool_list;
+static mem_stats retired[32];
+static uint num_retired;
+
+/*
+ * Chunk header size, rounded up so that cells stay suitably aligned.
+ */
+#define CHUNK_HEADER    ((sizeof(mem_chunk) + 15) & ~(size_t)15)
+#define CHUNK_CELLS(c)  ((char *)(c) + CHUNK_HEADER)
+
+/*
+ * Add a chunk of `num_cells` cells to memory pool and append its cells to the
+ * end of free cell list.
+ */
+static void
+add_chunk(mem_pool *mp, uint num_cells)
+{
+        assert(num_cells > 0);
+        uint size = CHUNK_HEADER + mp->cell_size * num_cells;
+        mem_chunk *chunk = mem_alloc(size, mp->name);
+        memset(chunk, 0, size);
+        chunk->num_cells = num_cells;
+        chunk->next = mp->chunks;
+        mp->chunks = chunk;
+        mp->num_cells += num_cells;
+        
+        /*
+         * Create a linked list of cells: the pointer in the current cell is set
+         * to point to the previous and next cell.
+         */
+        char *first = CHUNK_CELLS(chunk);
+        char *ptr = NULL;
+        for (uint i = 0; i < num_cells; i++) {
+                ptr = first + mp->cell_size * i;
+                *((void **)ptr+0) = ptr - mp->cell_size;        /* prev */
+                *((void **)ptr+1) = ptr + mp->cell_size;        /* next */
+        }
+        *((void **)ptr+1) = NULL;           /* last->next = NULL */
+        
+        /* Append new cells to the end of free cell list. */
+        *(void **)first = mp->free_cells_last;  /* head->prev = last */
+        if (mp->free_cells_last != NULL)
+                *((void **)mp->free_cells_last+1) = first;
+        else
+                mp->free_cells = first;
+        mp->free_cells_last = ptr;
+}
+
+/*
+ * Find the chunk that cell belongs to. Return NULL if cell is not part of
+ * memory pool.
+ */
+static mem_chunk *
+find_chunk(mem_pool *mp, void *cell)
+{
+        for (mem_chunk *c = mp->chunks; c != NULL; c = c->next) {
+                char *first = CHUNK_CELLS(c);
+                if ((char *)cell >= first &&
+                    (char *)cell < first + mp->cell_size * c->num_cells)
+                        return c;
+        }
+        return NULL;
+}
+
+/*
+ * Remove pool from list of all pools.
+ */
+static void
+unlink_pool(mem_pool *mp)
+{
+        for (mem_pool **pp = &pool_list; *pp != NULL; pp = &(*pp)->next) {
+                if (*pp == mp) {
+                        *pp = mp->next;
+                        return;
+                }
+        }
+}
+
+/*
+ * Find statistics entry by name, or add a new one if there's room left.
+ */
+static mem_stats *
+stats_entry(mem_stats *stats, uint *num_stats, uint max_stats, const char *name)
+{
+        for (uint i = 0; i < *num_stats; i++) {
+                if (strcmp(stats[i].name, name) == 0)
+                        return &stats[i];
+        }
+        if (*num_stats >= max_stats)
+                return NULL;
+        
+        mem_stats *st = &stats[(*num_stats)++];
+        memset(st, 0, sizeof(*st));
+        snprintf(st->name, sizeof(st->name), "%s", name);
+        return st;
+}
+
 /*
  * Initialize a new memory pool.
  *
  * record_size  Size of one data record.
- * num_records  Number of estimated records.
+ * num_records  Number of estimated records. The pool grows by this many records
+ *              whenever it runs out of memory.
  * name         Short description of what will be stored in this pool.
  */
 void
@@ -175,39 +280,21 @@ mem_pool_init(mem_pool *mp, unsigned record_size, unsigned num_records,
                             num_records);
         }
                 
+        unlink_pool(mp);        /* In case it's initialized again. */
         memset(mp, 0, sizeof(*mp));
         snprintf(mp->name, sizeof(mp->name), "%i %s", num_records, name);
         mp->cell_size = 2 * sizeof(void *) + record_size;
-        mp->num_cells = num_records;
+        mp->chunk_cells = num_records;
+        mp->next = pool_list;
+        pool_list = mp;
         
-        /* Allocate and clear memory. */
-        uint blocksize = mp->cell_size * mp->num_cells;
-        mp->block = mem_alloc(blocksize, mp->name);
-        memset(mp->block, 0, blocksize);
-        
-        /* Init lists. */
-        mp->free_cells = mp->block;
-        mp->inuse_cells = NULL;
-
-        /*
-         * Create a linked list of cells: the pointer in the current cell is set
-         * to point to the previous and next cell.
-         */
-        char *ptr = NULL;
-        for (uint i = 0; i < mp->num_cells; i++) {
-                ptr = (char *)mp->block + mp->cell_size * i;
-                *((void **)ptr+0) = ptr - mp->cell_size;        /* prev */
-                *((void **)ptr+1) = ptr + mp->cell_size;        /* next */
-        }
-        *(void **)mp->block = NULL;         /* head->prev = NULL */
-        *((void **)ptr+1) = NULL;           /* last->next = NULL */
-
-        /* Set free_cells_last to point to last element in free cell list. */
-        mp->free_cells_last = ptr;
+        /* Allocate initial chunk. */
+        add_chunk(mp, num_records);
 }
 
 /*
- * Free any resources associated with memory pool mp.
+ * Free any resources associated with memory pool mp. Records that are still
+ * allocated are released along with everything else, in one go.
  */
 void
 mem_pool_free(mem_pool *mp)
@@ -220,9 +307,43 @@ mem_pool_free(mem_pool *mp)
                 mp->num_cells, mp->stat_current, mp->stat_alloc, mp->stat_free,
                 mp->stat_peak);
 #endif
-        /* Free all cells and the memory pool structure itself. */
-        mem_free(mp->block);
-        mem_free(mp);
+        /* Keep statistics around. */
+        unlink_pool(mp);
+        mem_stats *st = stats_entry(retired, &num_retired, ARRAYSZ(retired),
+                                    mp->name);
+        if (st != NULL) {
+                st->allocs += mp->stat_alloc;
+                st->frees += mp->stat_free;
+                if (mp->stat_peak > st->peak)
+                        st->peak = mp->stat_peak;
+        }
+        
+        /* Free all chunks. */
+        while (mp->chunks != NULL) {
+                mem_chunk *next = mp->chunks->next;
+                mem_free(mp->chunks);
+                mp->chunks = next;
+        }
+        memset(mp, 0, sizeof(*mp));
+}
+
+/*
+ * Move cells freed during an earlier epoch to the beginning of free cell list,
+ * so that they are the first to be reused.
+ */
+static void
+flush_limbo(mem_pool *mp)
+{
+        if (mp->limbo == NULL || mp->limbo_epoch == mem_epoch)
+                return;
+        
+        *((void **)mp->limbo_last+1) = mp->free_cells;  /* last->next = head */
+        if (mp->free_cells != NULL)
+                *((void **)mp->free_cells+0) = mp->limbo_last;
+        else
+                mp->free_cells_last = mp->limbo_last;
+        mp->free_cells = mp->limbo;
+        mp->limbo = mp->limbo_last = NULL;
 }
 
 /*
@@ -233,19 +354,35 @@ mem_pool_free(mem_pool *mp)
  */
 void *
 mp_alloc(mem_pool *mp)
+{
+        void *ptr = mp_alloc_raw(mp);
+        if (!mem_quarantine)
+                memset(ptr, 0, mp->cell_size - 2 * sizeof(void *));
+        return ptr;
+}
+
+/*
+ * Allocate memory from pool mp without clearing it. Unless mem_quarantine is
+ * set, the record holds whatever its previous owner left there (except for the
+ * first word), so the caller must initialize all of it.
+ */
+void *
+mp_alloc_raw(mem_pool *mp)
 {
         assert(mp);
+        flush_limbo(mp);
         if (mp->free_cells == NULL) {
-                fatal_error("[MEM] Pool `%s` out of memory. Please increase "
-                            "pool size in config.lua file.", mp->name);
+                add_chunk(mp, mp->chunk_cells);
+                log_msg("[MEM] Pool `%s` grown to %u cells. Consider "
+                        "increasing pool size in config.lua file.", mp->name,
+                        mp->num_cells);
         }
-#if MEMDEBUG
         /* Adjust statistics. */
         mp->stat_current += 1;
         mp->stat_alloc += 1;
         if (mp->stat_current > mp->stat_peak)
                 mp->stat_peak = mp->stat_current;
-#endif
+
         /* Remove first cell from free cell list. */
         void **prev = ((void **)mp->free_cells+0);
         void **next = ((void **)mp->free_cells+1);
@@ -276,17 +413,23 @@ mp_free(mem_pool *mp, void *ptr)
 #if MEMDEBUG        
         /* Check if address belongs to the pool. */
         assert(mp && ptr);
-        uint blocksize = mp->cell_size * mp->num_cells;
-        if (ptr < mp->block || ptr >= mp->block + blocksize)
+        if (find_chunk(mp, (void **)ptr-2) == NULL)
                 fatal_error("[MEM] mp_free(): pointer %p does not belong to "
                             "'%s.'", ptr, mp->name);
-
+#endif
         /* Adjust statistics. */
+        assert(mp->stat_current > 0);
         mp->stat_current -= 1;
         mp->stat_free += 1;
-#endif
-        /* Clear memory. */
-        memset(ptr, 0, mp->cell_size - 2 * sizeof(void *));
+
+        /*
+         * Clear memory. Without quarantine, clearing the first word is enough
+         * to mark an object as destroyed.
+         */
+        if (mem_quarantine)
+                memset(ptr, 0, mp->cell_size - 2 * sizeof(void *));
+        else
+                *(void **)ptr = NULL;
 
         /* Remove cell from allocated cell list. */
         void **prev = ((void **)ptr-2);
@@ -297,6 +440,20 @@ mp_free(mem_pool *mp, void *ptr)
                 *((void **)(*prev)+1) = *next;  /* ptr->prev->next = ptr->next*/
         if (*next != NULL)
                 *((void **)(*next)+0) = *prev;  /* ptr->next->prev = ptr->prev*/
+        
+        /* Without quarantine, add ptr cell to the beginning of limbo list. */
+        if (!mem_quarantine) {
+                flush_limbo(mp);
+                *prev = NULL;                           /* ptr->prev = NULL */
+                *next = mp->limbo;                      /* ptr->next = head */
+                if (mp->limbo != NULL)
+                        *((void **)mp->limbo+0) = prev; /* head->prev = ptr */
+                else
+                        mp->limbo_last = prev;
+                mp->limbo = prev;                       /* head = ptr */
+                mp->limbo_epoch = mem_epoch;
+                return;
+        }
                 
         /* Add ptr cell to the end of free cell list. */
         *next = NULL;                                   /* ptr->next = NULL */
@@ -311,6 +468,16 @@ mp_free(mem_pool *mp, void *ptr)
         mp->free_cells_last = prev;                     /* last = ptr */
 }
 
+/*
+ * Start a new epoch: memory freed up to now may be reused from here on. Called
+ * at the beginning of every world step.
+ */
+void
+mem_advance_epoch(void)
+{
+        mem_epoch++;
+}
+
 /*
  * Free all memory from a memory pool.
  */
@@ -328,9 +495,67 @@ mp_free_all(mem_pool *mp)
         while (mp->inuse_cells != NULL) {
                 mp_free(mp, (char *)mp->inuse_cells + 2 * sizeof(void *));
         }
-#if MEMDEBUG
         assert(mp->stat_current == 0 && mp->stat_alloc == mp->stat_free);
-#endif
+}
+
+/*
+ * Release chunks that contain no allocated cells, except for the initial chunk
+ * that mem_pool_init() created. Meant to be called between levels, after a
+ * high-water mark has made a pool grow. Return the number of cells released.
+ *
+ * Cost is proportional to the number of free cells times the number of chunks.
+ */
+uint
+mp_trim(mem_pool *mp)
+{
+        assert(mp);
+        if (mp->chunks == NULL || mp->chunks->next == NULL)
+                return 0;       /* Only initial chunk left. */
+        
+        /* We're between steps: cells held back in limbo are free as well. */
+        mem_advance_epoch();
+        flush_limbo(mp);
+        
+        /* Count free cells in each chunk. */
+        for (mem_chunk *c = mp->chunks; c != NULL; c = c->next)
+                c->num_free = 0;
+        for (void **cell = mp->free_cells; cell != NULL; cell = *(cell+1))
+                find_chunk(mp, cell)->num_free++;
+        
+        /* Remove cells of empty chunks from free cell list. */
+        void **cell = mp->free_cells;
+        while (cell != NULL) {
+                void **prev = *(cell+0);
+                void **next = *(cell+1);
+                mem_chunk *c = find_chunk(mp, cell);
+                if (c->next != NULL && c->num_free == c->num_cells) {
+                        if (prev == NULL)
+                                mp->free_cells = next;
+                        else
+                                *(prev+1) = next;       /* prev->next = next */
+                        if (next == NULL)
+                                mp->free_cells_last = prev;
+                        else
+                                *(next+0) = prev;       /* next->prev = prev */
+                }
+                cell = next;
+        }
+        
+        /* Free empty chunks. The last one in the list is the initial chunk. */
+        uint released = 0;
+        mem_chunk **cp = &mp->chunks;
+        while (*cp != NULL) {
+                mem_chunk *c = *cp;
+                if (c->next != NULL && c->num_free == c->num_cells) {
+                        *cp = c->next;
+                        released += c->num_cells;
+                        mem_free(c);
+                } else {
+                        cp = &c->next;
+                }
+        }
+        mp->num_cells -= released;
+        return released;
 }
 
 /*
@@ -377,3 +602,51 @@ mp_foreach(mem_pool *mp, mem_func func, void *cb_data)
                 ptr = mp_next(ptr);
         }
 }
+
+/*
+ * Gather statistics of all pools, existing and freed, grouped by pool name.
+ * Return number of entries written to `stats`.
+ */
+uint
+mem_get_stats(mem_stats *stats, uint max_stats)
+{
+        uint num_stats = 0;
+        
+        /* Start with pools that no longer exist. */
+        for (uint i = 0; i < num_retired && num_stats < max_stats; i++)
+                stats[num_stats++] = retired[i];
+        
+        for (mem_pool *mp = pool_list; mp != NULL; mp = mp->next) {
+                mem_stats *st = stats_entry(stats, &num_stats, max_stats,
+                                            mp->name);
+                if (st == NULL)
+                        break;
+                st->num_pools++;
+                st->num_cells += mp->num_cells;
+                st->current += mp->stat_current;
+                st->allocs += mp->stat_alloc;
+                st->frees += mp->stat_free;
+                if (mp->stat_peak > st->peak)
+                        st->peak = mp->stat_peak;
+        }
+        return num_stats;
+}
+
+/*
+ * Print peak usage of every pool to stderr. Unlike the log, this works in
+ * release builds too.
+ */
+void
+mem_report(void)
+{
+        mem_stats stats[64];
+        uint num_stats = mem_get_stats(stats, ARRAYSZ(stats));
+        fprintf(stderr, "[MEM] Pool report (name: peak/cells, allocs, "
+                "frees)\n");
+        for (uint i = 0; i < num_stats; i++) {
+                mem_stats *st = &stats[i];
+                fprintf(stderr, "[MEM]   %-24s %6u/%-6u %10u %10u\n",
+                        st->name, st->peak, st->num_cells, st->allocs,
+                        st->frees);
+        }
+}
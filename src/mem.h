@@ -10,12 +10,18 @@
  * memory use statistics, ability to free everything that's in the pool in one
  * go.
  *
- * A pool, in this implementation, is a sequence of contiguous "cells" of memory
- * that form a linked list. All cells have the same size that is equal to the
- * size of the record they can hold plus space for two pointers: to next and
- * previous cell. Alloc()ed cells are removed from the beginning of the list;
- * free()d cells are returned to the end of the list (the list only contains
- * free cells). Both operations are O(1).
+ * A pool, in this implementation, is a set of "cells" of memory that form a
+ * linked list. All cells have the same size that is equal to the size of the
+ * record they can hold plus space for two pointers: to next and previous cell.
+ * Alloc()ed cells are removed from the beginning of the list; free()d cells are
+ * returned to the end of the list (the list only contains free cells). Both
+ * operations are O(1).
+ *
+ * Cells live in chunks. A pool starts out with a single chunk that holds the
+ * number of records given to mem_pool_init(); when it runs out of free cells,
+ * another chunk of the same size is added. Cells never move, so pointers to
+ * allocated records stay valid while the pool grows. mp_trim() gives chunks
+ * that are entirely free back to the system (the initial chunk is kept).
  *
  * The reason for not returning freed records to the beginning of free cell list
  * is so that the memory would not get reused immediately. Immediate reuse is
@@ -27,32 +33,84 @@
  *
  * Memory freed by mp_free() is cleared to contain zero bytes only. Also memory
  * returned by mp_alloc() is all zeros as well.
+ *
+ * The above "quarantine" mode is meant for debugging. With mem_quarantine set
+ * to false, freed cells are not cleared (only their first word is, so objects
+ * that begin with an `objtype` field read as destroyed), and they are reused
+ * most-recently-freed first, while still in cache. To keep "was this destroyed
+ * during the current step" checks working, cells freed during one world step
+ * are held back until mem_advance_epoch() is called at the start of the next.
+ * mp_alloc() then clears the whole record, while mp_alloc_raw() leaves that to
+ * constructors that set every field themselves.
  */
 
 /* Change to 1 for statistics and debugging info to be printed. */
 #define MEMDEBUG 0
 
+/* Default for mem_quarantine (see above). */
+#ifndef MEM_QUARANTINE
+#  ifdef NDEBUG
+#    define MEM_QUARANTINE 0
+#  else
+#    define MEM_QUARANTINE 1
+#  endif
+#endif
+
+extern int mem_quarantine;
+
+/*
+ * Chunk of pool memory. Cells follow the header.
+ */
+typedef struct mem_chunk {
+        struct mem_chunk *next; /* Next (older) chunk of the same pool. */
+        uint    num_cells;      /* Number of cells in this chunk. */
+        uint    num_free;       /* Free cell count (only valid in mp_trim()). */
+} mem_chunk;
+
 /*
  * Memory pool structure.
  */
-typedef struct {
+typedef struct mem_pool_t {
         uint    cell_size;      /* Size of one cell. */
-        uint    num_cells;      /* Total number of cells. */
-        void    *block;         /* Memory owned by pool. */
+        uint    num_cells;      /* Total number of cells (all chunks). */
+        uint    chunk_cells;    /* Number of cells added when pool grows. */
+        mem_chunk *chunks;      /* Memory owned by pool, newest chunk first. */
         void    *free_cells;    /* Beginning of free cell list. */
         void    *free_cells_last; /* Last cell in free cell list. */
+        void    *limbo;         /* Cells freed during current epoch. */
+        void    *limbo_last;    /* Last cell in limbo list. */
+        uint    limbo_epoch;    /* Epoch that limbo cells were freed in. */
         void    *inuse_cells;   /* Beginning of allocated cell list. */
         char    name[32];       /* A short description of what's in the pool. */
+        struct mem_pool_t *next; /* Next in list of all pools. */
 
-#if MEMDEBUG
         /* Allocation statistics. */
         uint    stat_current;   /* Number of currently allocated cells. */
         uint    stat_alloc;     /* Number of mp_alloc() calls for this pool. */
         uint    stat_free;      /* Number of mp_free() calls for this pool. */
         uint    stat_peak;      /* Peak number of allocated cells. */
-#endif
 } mem_pool;
 
+/*
+ * Allocation statistics of all pools that share a name (for instance, the
+ * per-world pools of every world), including pools that no longer exist.
+ *
+ * num_pools    Number of pools by this name that currently exist.
+ * num_cells    Total number of cells in existing pools.
+ * current      Number of currently allocated cells.
+ * peak         Highest peak number of allocated cells of any one pool.
+ * allocs       Number of mp_alloc() calls.
+ * frees        Number of mp_free() calls.
+ */
+typedef struct {
+        char    name[32];
+        uint    num_pools;
+        uint    num_cells;
+        uint    current;
+        uint    peak;
+        uint    allocs, frees;
+} mem_stats;
+
 /* Standard allocation with some error checking. */
 void    *mem_alloc(uint size, const char *descr);
 void     mem_realloc(void **ptr, uint size, const char *descr);
@@ -65,8 +123,15 @@ void     mem_pool_free(mem_pool *mp);
 
 /* Pool allocation routines. */
 void    *mp_alloc(mem_pool *mp);
+void    *mp_alloc_raw(mem_pool *mp);
 void     mp_free(mem_pool *mp, void *ptr);
 void     mp_free_all(mem_pool *mp);
+uint     mp_trim(mem_pool *mp);
+void     mem_advance_epoch(void);
+
+/* Pool statistics. */
+uint     mem_get_stats(mem_stats *stats, uint max_stats);
+void     mem_report(void);
 
 /* Traverse allocated structures. */
 void    *mp_first(mem_pool *mp);
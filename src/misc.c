@@ -49,6 +49,7 @@ object_name(void *obj)
         case OBJTYPE_TIMER_C: return "Timer (C)";
         case OBJTYPE_TIMER_LUA: return "Timer (Lua)";
         case OBJTYPE_TIMERPTR: return "Timer pointer";
+        case OBJTYPE_TIMER_TASK: return "Timer (task)";
         }
         
         snprintf(str, sizeof(str), "(unknown: %i)", *(int *)obj);
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 #include "property.h"
 #include "log.h"
@@ -10,6 +11,10 @@ prop_free(Property *p)
         assert(p->refc);
         if (--(p->refc) > 0)
                 return;
+        
+        /* Keyframe track is owned by the property. */
+        if (p->anim_type == ANIM_PATH)
+                mem_free(p->_.path.track);
                 
         extern mem_pool mp_property;
         mp_free(&mp_property, p);
@@ -141,3 +146,150 @@ interp_color(uint8_t type, uint32_t start, uint32_t end, float duration,
         fatal_error("Invalid animation type: (%i).", type);
         abort();
 }
+
+/*
+ * Allocate a keyframe track with room for `num_keys` keys. Caller fills in the
+ * keys and attaches the track to a Property (see ANIM_PATH).
+ */
+PropPath *
+path_new(uint8_t loop, unsigned num_keys)
+{
+        assert(num_keys >= 2);
+        PropPath *path = mem_alloc(sizeof(PropPath) + num_keys * sizeof(PropKey),
+                                   "Keyframe path");
+        path->loop = loop;
+        path->num_keys = num_keys;
+        return path;
+}
+
+/*
+ * Find path segment that corresponds to `delta` seconds since animation start.
+ * Segment keys are stored in `a` and `b`, and `frac` receives eased position
+ * within the segment (0..1). Returns true once a clamped path has come to its
+ * final value.
+ */
+static int
+path_locate(const Property *p, float delta, const PropKey **a,
+            const PropKey **b, float *frac)
+{
+        const PropPath *path = p->_.path.track;
+        const PropKey *keys = path->keys;
+        unsigned last = path->num_keys - 1;
+        float duration = p->duration;
+        int done = 0;
+        
+        assert(p->anim_type == ANIM_PATH && duration > 0.0);
+        switch (path->loop) {
+        case ANIM_LOOP:
+                if (delta > 0.0)
+                        delta = fmod(delta, duration);
+                break;
+        case ANIM_REVERSE_LOOP:
+                if (delta > 0.0 && (delta = fmod(delta, duration * 2)) > duration)
+                        delta = duration * 2 - delta;
+                break;
+        case ANIM_REVERSE_CLAMP:
+                if (delta >= duration * 2) {
+                        delta = 0.0;
+                        done = 1;
+                } else if (delta > duration) {
+                        delta = duration * 2 - delta;
+                }
+                break;
+        case ANIM_CLAMP:
+                if (delta >= duration) {
+                        *a = *b = &keys[last];
+                        *frac = 0.0;
+                        return 1;
+                }
+                break;
+        default:
+                fatal_error("Invalid path loop type: (%i).", path->loop);
+        }
+        
+        /* Before first key: hold first value. */
+        if (delta <= keys[0].time) {
+                *a = *b = &keys[0];
+                *frac = 0.0;
+                return done;
+        }
+        
+        /* Binary search for the last key with time <= delta. */
+        unsigned lo = 0, hi = last;
+        while (hi - lo > 1) {
+                unsigned mid = (lo + hi) / 2;
+                if (keys[mid].time <= delta)
+                        lo = mid;
+                else
+                        hi = mid;
+        }
+        *a = &keys[lo];
+        *b = &keys[hi];
+        
+        /* Eased position within segment. */
+        float seg = (*b)->time - (*a)->time;
+        float d = delta - (*a)->time;
+        if (seg <= 0.0 || d >= seg) {
+                *frac = 1.0;
+                return done;
+        }
+        switch ((*b)->ease) {
+        case ANIM_CLAMP_EASEIN:
+                *frac = interp_easein(0.0, 1.0, seg, d);
+                break;
+        case ANIM_CLAMP_EASEOUT:
+                *frac = interp_easeout(0.0, 1.0, seg, d);
+                break;
+        case ANIM_CLAMP_EASEINOUT:
+                *frac = interp_easeinout(0.0, 1.0, seg, d);
+                break;
+        default:
+                *frac = interp_linear(0.0, 1.0, seg, d);
+        }
+        return done;
+}
+
+/*
+ * Evaluate vector path `delta` seconds after its start. Like interp_color(),
+ * returns true if the value will not change any more.
+ */
+int
+path_vectf(const Property *p, float delta, vect_f *val)
+{
+        const PropKey *a, *b;
+        float f;
+        int done = path_locate(p, delta, &a, &b, &f);
+        *val = (vect_f){
+                a->_.vectf.x + (b->_.vectf.x - a->_.vectf.x) * f,
+                a->_.vectf.y + (b->_.vectf.y - a->_.vectf.y) * f
+        };
+        return done;
+}
+
+int
+path_color(const Property *p, float delta, uint32_t *val)
+{
+        const PropKey *a, *b;
+        float f;
+        int done = path_locate(p, delta, &a, &b, &f);
+        if (a == b || f <= 0.0) {
+                *val = a->_.color;
+                return done;
+        }
+        uint32_t s = a->_.color, e = b->_.color;
+        *val = color_32bit(COLOR_RED(s) + (COLOR_RED(e) - COLOR_RED(s)) * f,
+                           COLOR_GREEN(s) + (COLOR_GREEN(e) - COLOR_GREEN(s)) * f,
+                           COLOR_BLUE(s) + (COLOR_BLUE(e) - COLOR_BLUE(s)) * f,
+                           COLOR_ALPHA(s) + (COLOR_ALPHA(e) - COLOR_ALPHA(s)) * f);
+        return done;
+}
+
+int
+path_angle(const Property *p, float delta, float *val)
+{
+        const PropKey *a, *b;
+        float f;
+        int done = path_locate(p, delta, &a, &b, &f);
+        *val = a->_.angle + (b->_.angle - a->_.angle) * f;
+        return done;
+}
@@ -15,9 +15,41 @@ enum {
         ANIM_LOOP,              /* Linear looping animation. */
         ANIM_REVERSE_LOOP,      /* Linear looping animation, reverses once it
                                    reaches its end. */
-        ANIM_REVERSE_CLAMP      /* Linear animation, reverses once then stops.*/
+        ANIM_REVERSE_CLAMP,     /* Linear animation, reverses once then stops.*/
+        ANIM_PATH               /* Keyframe track (see PropPath below). */
 };
 
+/*
+ * Keyframe of a path animation.
+ *
+ * time         Seconds since path start.
+ * ease         Easing of the segment that ends at this key: ANIM_CLAMP
+ *              (linear), ANIM_CLAMP_EASEIN, ANIM_CLAMP_EASEOUT or
+ *              ANIM_CLAMP_EASEINOUT. Ignored for the first key.
+ */
+typedef struct {
+        float           time;
+        uint8_t         ease;
+        union {
+                vect_f          vectf;
+                uint32_t        color;
+                float           angle;
+        } _;
+} PropKey;
+
+/*
+ * Keyframe track owned by a Property with anim_type = ANIM_PATH. Key times are
+ * non-decreasing; the last key time is the duration of the whole path.
+ *
+ * loop         How path repeats: ANIM_CLAMP, ANIM_LOOP, ANIM_REVERSE_LOOP, or
+ *              ANIM_REVERSE_CLAMP.
+ */
+typedef struct {
+        uint8_t         loop;
+        unsigned        num_keys;
+        PropKey         keys[];
+} PropPath;
+
 /*
  * A union of various values that can be animated.
  *
@@ -51,6 +83,10 @@ typedef struct {
                 struct {
                         ShapeDef start, end;
                 } shapedef;                
+                struct {
+                        vect_f pivot;   /* Shares position with angle.pivot. */
+                        PropPath *track;
+                } path;
         } _;
 } Property;
 
@@ -58,6 +94,12 @@ void      prop_free(Property *p);
 Property *prop_new(void);
 #define   prop_copy(p) ((p)->refc++, (p))
 
+/* Keyframe paths. */
+PropPath *path_new(uint8_t loop, unsigned num_keys);
+int       path_vectf(const Property *p, float delta, vect_f *val);
+int       path_color(const Property *p, float delta, uint32_t *val);
+int       path_angle(const Property *p, float delta, float *val);
+
 /* typedef float (*interp_func)(float, float, float, float); */
 
 static inline float
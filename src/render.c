@@ -383,6 +383,8 @@ draw_visible_tiles(Camera *cam, BB visible_area)
                         }
                         texture_bind(sl == NULL ? NULL : sl->tex);
                 }
+                if (sl != NULL && sl->tex->id == 0)
+                        continue;       /* Texture is being reloaded. */
                                 
                 /* Apply rotation. */
                 Property *rot = t->angle;
@@ -615,10 +617,16 @@ draw_tile_BBs(Camera *cam, BB visible_area)
 
 #endif  /* ENABLE_TILE_GRID */
 
-static void
+/* Number of line segments used to draw circle shapes. */
+#define CIRCLE_SEGMENTS 24
+
+/*
+ * Fill buffer with shape outline vertices, return their count.
+ */
+static unsigned
 prepare_shape_buf(Shape *s, unsigned char *buf)
 {
-        assert(buf && s && s->shape_type == SHAPE_RECTANGLE);
+        assert(buf && s);
         
         /* Put color values into buffer. */
         uint32_t color;
@@ -626,6 +634,19 @@ prepare_shape_buf(Shape *s, unsigned char *buf)
                 color = color_32bit(1.0, 0.0, 0.0, 1.0);
         else
                 color = s->color;
+        
+        if (s->shape_type == SHAPE_CIRCLE) {
+                Circle c = shape_def(s).circle;
+                for (unsigned i = 0; i < CIRCLE_SEGMENTS; i++) {
+                        float a = i * (2.0 * M_PI / CIRCLE_SEGMENTS);
+                        unsigned char *v = &buf[VERT_SPACE*i];
+                        *((uint32_t *)&v[VERT_COLOR_OFFSET]) = color;
+                        *((GLfloat *)&v[VERT_COORD_OFFSET]    ) = c.offset.x + c.radius * cosf(a);
+                        *((GLfloat *)&v[VERT_COORD_OFFSET] + 1) = c.offset.y + c.radius * sinf(a);
+                }
+                return CIRCLE_SEGMENTS;
+        }
+        
         *((uint32_t *)&buf[VERT_SPACE*0 + VERT_COLOR_OFFSET]) = color;
         *((uint32_t *)&buf[VERT_SPACE*1 + VERT_COLOR_OFFSET]) = color;
         *((uint32_t *)&buf[VERT_SPACE*2 + VERT_COLOR_OFFSET]) = color;
@@ -642,6 +663,7 @@ prepare_shape_buf(Shape *s, unsigned char *buf)
         *((GLfloat *)&buf[VERT_SPACE*2 + VERT_COORD_OFFSET] + 1) = rect.t;
         *((GLfloat *)&buf[VERT_SPACE*3 + VERT_COORD_OFFSET]    ) = rect.l;
         *((GLfloat *)&buf[VERT_SPACE*3 + VERT_COORD_OFFSET] + 1) = rect.t;
+        return 4;
 }
 
 static void
@@ -656,7 +678,8 @@ draw_visible_shapes(World *world, BB visible_area)
         if (num_shapes == 0)
                 return;
         
-        unsigned char buf[VERT_SPACE * 4]; /* Storage for shape verex data. */
+        /* Storage for shape vertex data. */
+        unsigned char buf[VERT_SPACE * CIRCLE_SEGMENTS];
         glVertexPointer(2, GL_FLOAT, VERT_SPACE, buf + VERT_COORD_OFFSET);
         glColorPointer(4, GL_UNSIGNED_BYTE, VERT_SPACE,
                        buf + VERT_COLOR_OFFSET);
@@ -684,8 +707,7 @@ draw_visible_shapes(World *world, BB visible_area)
                         body_translation(current_body);
                 }
                 
-                prepare_shape_buf(s, buf);
-                glDrawArrays(GL_LINE_LOOP, 0, 4);
+                glDrawArrays(GL_LINE_LOOP, 0, prepare_shape_buf(s, buf));
         }        
         glPopMatrix();
 }
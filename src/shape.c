@@ -62,6 +62,8 @@ shape_local_bb(Shape *s)
 void
 shape_bb_changed(Shape *s)
 {
+        s->world_bb_stamp = 0;  /* Invalidate cached world box. */
+        
         if (!grid_stored(&s->go))
                 return;         /* Shape is not in the tree. */
  
@@ -72,11 +74,17 @@ shape_bb_changed(Shape *s)
 }
 
 /*
- * Return true if shape overlaps bounding box (coords relative to world origin).
+ * Return shape bounding box in world coordinates. The box is computed at most
+ * once per world step (see world_step()) and again after something calls
+ * shape_bb_changed(), e.g. when shape's body is moved.
  */
-int
-shape_vs_bb(Shape *s, BB bb)
+BB
+shape_world_bb(Shape *s)
 {
+        World *world = s->body->world;
+        if (s->world_bb_stamp == world->bb_stamp)
+                return s->world_bb;
+        
         ShapeDef def = shape_def(s);
         
         /* Rounded body position. */
@@ -84,63 +92,106 @@ shape_vs_bb(Shape *s, BB bb)
         int body_x = posround(bpos.x);
         int body_y = posround(bpos.y);
         
+        BB bb;
         switch (s->shape_type) {
-        case SHAPE_CIRCLE:
-                fatal_error("not implemented");
-                return 0;
+        case SHAPE_CIRCLE: {
+                int x = body_x + def.circle.offset.x;
+                int y = body_y + def.circle.offset.y;
+                int r = def.circle.radius;
+                bb = (BB){.l = x - r, .r = x + r, .b = y - r, .t = y + r};
+                break;
+        }
         case SHAPE_RECTANGLE:
+                bb = (BB){
+                        .l = def.rect.l + body_x,
+                        .r = def.rect.r + body_x,
+                        .b = def.rect.b + body_y,
+                        .t = def.rect.t + body_y
+                };
+                break;
+        default:
+                fatal_error("Invalid shape type (%i).", s->shape_type);
+                abort();
+        }
+        s->world_bb = bb;
+        s->world_bb_stamp = world->bb_stamp;
+        return bb;
+}
+
+/*
+ * Circle shape in world coordinates, recovered from its cached world box.
+ */
+static Circle
+shape_world_circle(Shape *s)
+{
+        assert(s->shape_type == SHAPE_CIRCLE);
+        BB bb = shape_world_bb(s);
+        return (Circle){
+                .radius = (bb.r - bb.l) / 2,
+                .offset = {(bb.l + bb.r) / 2, (bb.b + bb.t) / 2}
+        };
+}
+
+/*
+ * Return true if shape overlaps bounding box (coords relative to world origin).
+ */
+int
+shape_vs_bb(Shape *s, BB bb)
+{
+        switch (s->shape_type) {
+        case SHAPE_CIRCLE: {
+                Circle c = shape_world_circle(s);
+                return circle_overlap_bb(&c, &bb);
+        }
+        case SHAPE_RECTANGLE: {
                 /* Basic bounding box overlap test. */
-                def.rect.l += body_x;
-                def.rect.r += body_x;
-                def.rect.b += body_y;
-                def.rect.t += body_y;
-                return bb_overlap(&def.rect, &bb);
+                BB wbb = shape_world_bb(s);
+                return bb_overlap(&wbb, &bb);
+        }
         }
         fatal_error("Invalid shape type (%i).", s->shape_type);
         abort();
 }
 
 /*
- * Return collision resolve if two shapes collide.
+ * Return collision resolve if two shapes collide. Resolve distances move shape
+ * [b] out of shape [a] (see bb_intersect_resolve()).
  */
 int
 shape_vs_shape(Shape *a, Shape *b, BB *resolve)
 {
-        ShapeDef def_a = shape_def(a);
-        ShapeDef def_b = shape_def(b);
-        
-        vect_f bpos_a = body_absolute_pos(a->body);
-        vect_f bpos_b = body_absolute_pos(b->body);
-        
-        assert(a->shape_type == SHAPE_RECTANGLE);
-        assert(b->shape_type == SHAPE_RECTANGLE);
+        /* Cached world boxes; only integer comparisons remain for boxes. */
+        BB bb_a = shape_world_bb(a);
+        BB bb_b = shape_world_bb(b);
         
-        /* Translate to world coords. */
-        int body_x = posround(bpos_a.x);
-        int body_y = posround(bpos_a.y);
-        def_a.rect.l += body_x;
-        def_a.rect.r += body_x;
-        def_a.rect.b += body_y;
-        def_a.rect.t += body_y;
+        /* Circles cannot collide if their boxes do not. */
+        BB tmp;
+        if (!bb_intersect_resolve(&bb_a, &bb_b, &tmp))
+                return 0;
         
-        /* Translate to world coords. */
-        body_x = posround(bpos_b.x);
-        body_y = posround(bpos_b.y);
-        def_b.rect.l += body_x;
-        def_b.rect.r += body_x;
-        def_b.rect.b += body_y;
-        def_b.rect.t += body_y;
+        if (a->shape_type == SHAPE_RECTANGLE) {
+                if (b->shape_type == SHAPE_RECTANGLE) {
+                        *resolve = tmp;
+                        return 1;
+                }
+                Circle c_b = shape_world_circle(b);
+                return bb_circle_intersect_resolve(&bb_a, &c_b, resolve);
+        }
         
-        return bb_intersect_resolve(&def_a.rect, &def_b.rect, resolve);
+        Circle c_a = shape_world_circle(a);
+        if (b->shape_type == SHAPE_RECTANGLE)
+                return circle_bb_intersect_resolve(&c_a, &bb_b, resolve);
+        Circle c_b = shape_world_circle(b);
+        return circle_intersect_resolve(&c_a, &c_b, resolve);
 }
 
 Shape *
 shape_new(Body *body, Group *group, uint8_t shape_type, ShapeDef def)
 {
         /* Allocate and set objtype. */
-        extern mem_pool mp_shape;
-        Shape *s = mp_alloc(&mp_shape);
+        Shape *s = mp_alloc(&body->world->shape_pool);
         s->objtype = OBJTYPE_SHAPE;
+        s->handle = handle_new(s);
                 
         /* Set shape type, definition, and group. */
         s->shape_type = shape_type;
@@ -156,37 +207,75 @@ shape_new(Body *body, Group *group, uint8_t shape_type, ShapeDef def)
         BB bb = shape_local_bb(s);
         body_sweep_bb(body, &bb);
         grid_add(&body->world->grid, &s->go, s, bb);
-
+        
+        /* Body can now be found through the grid. */
+        body_update_nocturnal(body);
+        world_shape_changed(s);
         return s;
 }
 
+/*
+ * Copy shape properties from `orig`.
+ */
+static void
+shape_copy(Shape *s, const Shape *orig)
+{
+        s->shape_type = orig->shape_type;
+        s->def = prop_copy(orig->def);
+        s->color = orig->color;
+        s->flags = orig->flags;
+        s->group = orig->group;
+}
+
+/*
+ * Add shape to grid and world's active set once its body is in place.
+ */
+static void
+shape_grid_add(Shape *s)
+{
+        BB bb = shape_local_bb(s);
+        body_sweep_bb(s->body, &bb);
+        grid_add(&s->body->world->grid, &s->go, s, bb);
+        
+        /* Body can now be found through the grid. */
+        body_update_nocturnal(s->body);
+        world_shape_changed(s);
+}
+
 Shape *
 shape_clone(Body *parent, const Shape *orig)
 {
         /* Allocate and set objtype. */
-        extern mem_pool mp_shape;
-        Shape *s = mp_alloc(&mp_shape);
+        Shape *s = mp_alloc(&parent->world->shape_pool);
         s->objtype = OBJTYPE_SHAPE;
+        s->handle = handle_new(s);
         
         /* Copy properties. */
-        s->shape_type = orig->shape_type;
-        s->def = prop_copy(orig->def);
-        s->color = orig->color;
-        s->flags = orig->flags;
-        s->group = orig->group;
+        shape_copy(s, orig);
         
         /* Add to parent. */
         s->body = parent;
         DL_APPEND(parent->shapes, s);
         
-        /* Add to grid. */
-        BB bb = shape_local_bb(s);
-        body_sweep_bb(parent, &bb);
-        grid_add(&parent->world->grid, &s->go, s, bb);
-
+        shape_grid_add(s);
         return s;
 }
 
+/*
+ * Turn a shape of a recycled body back into a copy of `orig` (see
+ * body_reuse()). Shape must not be in the grid.
+ */
+void
+shape_reset(Shape *s, const Shape *orig)
+{
+        assert(!grid_stored(&s->go) && !s->active_index);
+        
+        prop_free(s->def);
+        shape_copy(s, orig);
+        s->world_bb_stamp = 0;
+        shape_grid_add(s);
+}
+
 void
 shape_free(Shape *s)
 {
@@ -194,15 +283,28 @@ shape_free(Shape *s)
         assert(s->shape_type == SHAPE_CIRCLE ||
                s->shape_type == SHAPE_RECTANGLE);
         
-        /* Remove from shape tree if it's in there. */
+        /* Remove from shape tree and world's active set. */
         Body *body = s->body;
+        world_shape_removed(s);
         if (grid_stored(&s->go))
                 grid_remove(&body->world->grid, &s->go);
         
         /* Remove shape from its body's list. */
         assert((s->prev != NULL || s->next != NULL) && body->shapes);
         DL_DELETE(body->shapes, s);
+        body_update_nocturnal(body);
         
+        shape_release(s);
+        mp_free(&body->world->shape_pool, s);
+}
+
+/*
+ * Free what shape owns outside of its world's memory pools: definition
+ * property, trace, and handle. Used directly when a whole world is destroyed.
+ */
+void
+shape_release(Shape *s)
+{
         /* Destroy shape definition property. */
         prop_free(s->def);
         
@@ -222,8 +324,8 @@ shape_free(Shape *s)
                 mp_free(&mp_shapetrace, trace);
         }
 #endif
-        extern mem_pool mp_shape;
-        mp_free(&mp_shape, s);
+        handle_free(s->handle);
+        s->objtype = 0;
 }
 
 #if TRACE_MAX
@@ -5,6 +5,7 @@
 #include "geometry.h"
 #include "property.h"
 #include "grid.h"
+#include "handle.h"
 #include "uthash_tuned.h"
 
 struct Body_t;
@@ -43,6 +44,7 @@ typedef struct {
  */
 typedef struct Shape_t {
         int             objtype;        /* = OBJTYPE_SHAPE */
+        Handle          handle;         /* Given out to scripts. */
         struct Body_t   *body;          /* Body the shape belongs to. */
 
         uint8_t         shape_type;     /* Circle or rectangle. */
@@ -50,6 +52,15 @@ typedef struct Shape_t {
 
         uint32_t        color;          /* Color for display in shape editor. */
         unsigned        flags;
+        unsigned        active_index;   /* Index + 1 into world's active shape
+                                           array, or zero. */
+        
+        /*
+         * Cached bounding box in world coordinates (integer, body position
+         * rounded). Valid while `world_bb_stamp` equals world's `bb_stamp`.
+         */
+        BB              world_bb;
+        unsigned        world_bb_stamp;
         
 #if TRACE_MAX
         ShapeState      *trace;
@@ -66,6 +77,7 @@ int              shape_vs_bb(Shape *, BB bb);
 int              shape_vs_shape(Shape *a, Shape *b, BB *resolve);
 
 void             shape_bb_changed(Shape *);
+BB               shape_world_bb(Shape *);
 
 ShapeDef         shape_def(Shape *);
 void             shape_set_def(Shape *, ShapeDef def);
@@ -74,7 +86,9 @@ void             shape_anim_def(Shape *, uint8_t, ShapeDef, float, float);
 Shape           *shape_new(struct Body_t *, struct Group_t *, uint8_t stype,
                            ShapeDef def);
 Shape           *shape_clone(struct Body_t *, const Shape *);
+void             shape_reset(Shape *, const Shape *);
 void             shape_free(Shape *);
+void             shape_release(Shape *);
 void             shape_record_trace(Shape *, unsigned trace_index);
 
 #endif /* GAME2D_SHAPE_H */
@@ -3,6 +3,49 @@
 #include "stepfunc.h"
 #include "util_lua.h"
 #include "assert_lua.h"
+#include "mem.h"
+#include "world.h"
+
+/*
+ * Allocate zeroed step function parameters.
+ */
+StepParams *
+stepparams_new(void)
+{
+        extern mem_pool mp_stepparams;
+        return mp_alloc(&mp_stepparams);
+}
+
+/*
+ * Copy step parameters, running state included.
+ */
+StepParams *
+stepparams_copy(const StepParams *p)
+{
+        StepParams *copy = stepparams_new();
+        *copy = *p;
+        return copy;
+}
+
+/*
+ * Copy step parameters for a cloned (or reused) body. Running state is not
+ * carried over: the clone sets it up from its own position on its first step,
+ * instead of jumping to where the original was.
+ */
+StepParams *
+stepparams_clone(const StepParams *p)
+{
+        StepParams *copy = stepparams_copy(p);
+        copy->init = 0;
+        return copy;
+}
+
+void
+stepparams_free(StepParams *p)
+{
+        extern mem_pool mp_stepparams;
+        mp_free(&mp_stepparams, p);
+}
 
 void
 stepfunc_std(lua_State *L, void *body, intptr_t data)
@@ -40,13 +83,15 @@ stepfunc_std(lua_State *L, void *body, intptr_t data)
  * regular velocity and acceleration values:
  *
  *     vel.x        current angular velocity
- *     vel.y        desired angular velocity (read from user args)
+ *     vel.y        desired angular velocity (from step parameters)
  *     acc.x        distance to parent (calculated from initial position)
  *     acc.y        multiplier (how fast desired velocity is achieved)
  */
 void
 stepfunc_rot(lua_State *L, void *body, intptr_t data)
 {
+        UNUSED(L);
+        StepParams *p = (StepParams *)data;
         vect_f pos = GetPos(body);
         vect_f vel = GetVel(body);
         vect_f acc = GetAcc(body);
@@ -57,34 +102,11 @@ stepfunc_rot(lua_State *L, void *body, intptr_t data)
                 acc.x = sqrtf(pos.x * pos.x + pos.y * pos.y);
                 if (acc.x == 0.0)
                         log_warn("stdfunc_rot: zero distance to parent.");
-                        
-                /* Get user args. */
-                lua_getglobal(L, "eapi");                       /* + eapi */
-                L_get_strfield(L, -1, "idToObjectMap");         /* + idToObj */
-                lua_pushinteger(L, data);
-                lua_rawget(L, -2);                              /* + args */
-                int arg_index = lua_gettop(L);
-                
-                /* Target velocity. */
-                lua_pushinteger(L, 1);
-                lua_rawget(L, arg_index);                       /* + vel */
-                vel.y = lua_tonumber(L, -1);
                 
-                /* Initial angular velocity. */
-                lua_pushinteger(L, 2);
-                lua_rawget(L, arg_index);
-                vel.x = lua_isnil(L, -1) ? 0.0 : lua_tonumber(L, -1);
-                
-                /* Multiplier. */
-                lua_pushinteger(L, 3);                          /* + mult */
-                lua_rawget(L, arg_index);
-                acc.y = lua_isnil(L, -1) ? 1.0 : lua_tonumber(L, -1);
-                info_assert(L, acc.y > 0.0 && acc.y <= 1.0, "Acceleration "
-                            "multiplier out of range.");
-                
-                /* Store values and pop garbage. */
+                vel.y = p->u.rot.dvel;
+                vel.x = p->u.rot.ivel;
+                acc.y = p->u.rot.mult;
                 SetAcc(body, acc);
-                lua_pop(L, 6);
         }
         
         /* Figure out current angle. */
@@ -101,3 +123,190 @@ stepfunc_rot(lua_State *L, void *body, intptr_t data)
         angle += vel.x * dt;
         SetPos(body, (vect_f){acc.x * cosf(angle), acc.x * sinf(angle)});
 }
+
+/*
+ * Return target body if it still exists (see handle.h), NULL otherwise.
+ */
+static Body *
+live_target(Handle target)
+{
+        return (target != 0) ? handle_get(target) : NULL;
+}
+
+/*
+ * Homing missile:
+ *     eapi.SetStepC(body, eapi.STEPFUNC_HOMING, target, turnRate, speed=0)
+ *
+ * Body turns toward `target` at most `turnRate` radians per second while
+ * moving at constant `speed` (zero keeps the speed the body already has).
+ * Once the target is gone, body keeps flying straight.
+ */
+void
+stepfunc_homing(lua_State *L, void *body, intptr_t data)
+{
+        UNUSED(L);
+        Body *b = body;
+        StepParams *p = (StepParams *)data;
+        float dt = b->world->step_sec;
+        
+        vect_f vel = b->vel;
+        float speed = p->u.homing.speed;
+        if (speed == 0.0)
+                speed = sqrtf(vel.x * vel.x + vel.y * vel.y);
+        float angle = atan2f(vel.y, vel.x);
+        
+        Body *target = live_target(p->u.homing.target);
+        if (target != NULL) {
+                vect_f d = vect_f_sub(body_absolute_pos(target),
+                                      body_absolute_pos(b));
+                if (d.x != 0.0 || d.y != 0.0) {
+                        /* Turn by the shorter way, no more than allowed. */
+                        float diff = atan2f(d.y, d.x) - angle;
+                        while (diff > M_PI)
+                                diff -= 2.0 * M_PI;
+                        while (diff < -M_PI)
+                                diff += 2.0 * M_PI;
+                        float max_turn = p->u.homing.turn * dt;
+                        if (diff > max_turn)
+                                diff = max_turn;
+                        else if (diff < -max_turn)
+                                diff = -max_turn;
+                        angle += diff;
+                }
+        }
+        
+        vel = (vect_f){speed * cosf(angle), speed * sinf(angle)};
+        b->vel = vel;
+        vect_f pos = body_pos(b);
+        body_set_pos(b, (vect_f){pos.x + vel.x * dt, pos.y + vel.y * dt});
+}
+
+/*
+ * Sine-wave movement:
+ *     eapi.SetStepC(body, eapi.STEPFUNC_SINE, amplitude, frequency, phase=0)
+ *
+ * An invisible center point moves just like with STEPFUNC_STD (velocity and
+ * acceleration); the body itself oscillates around it, perpendicular to the
+ * direction of motion. Frequency is in Hz, phase in radians.
+ */
+void
+stepfunc_sine(lua_State *L, void *body, intptr_t data)
+{
+        UNUSED(L);
+        Body *b = body;
+        StepParams *p = (StepParams *)data;
+        float dt = b->world->step_sec;
+        
+        if (!p->init) {
+                p->init = 1;
+                p->u.sine.center = body_pos(b);
+                p->u.sine.time = 0.0;
+        }
+        
+        /* Move center. */
+        b->vel.x += b->acc.x * dt;
+        b->vel.y += b->acc.y * dt;
+        p->u.sine.center.x += b->vel.x * dt;
+        p->u.sine.center.y += b->vel.y * dt;
+        p->u.sine.time += dt;
+        
+        /* Offset body along the normal of its velocity. */
+        vect_f n = {0.0, 1.0};
+        float len = sqrtf(b->vel.x * b->vel.x + b->vel.y * b->vel.y);
+        if (len > 0.0)
+                n = (vect_f){-b->vel.y / len, b->vel.x / len};
+        float offset = p->u.sine.amplitude * sinf(2.0 * M_PI *
+            p->u.sine.frequency * p->u.sine.time + p->u.sine.phase);
+        body_set_pos(b, (vect_f){p->u.sine.center.x + n.x * offset,
+                                 p->u.sine.center.y + n.y * offset});
+}
+
+/*
+ * Orbit around parent body:
+ *     eapi.SetStepC(body, eapi.STEPFUNC_ORBIT, angvel, radius=nil)
+ *
+ * Angular velocity is in radians per second. If `radius` is omitted, current
+ * distance to parent is used. Unlike STEPFUNC_ROT the speed is constant and
+ * velocity/acceleration are left alone.
+ */
+void
+stepfunc_orbit(lua_State *L, void *body, intptr_t data)
+{
+        UNUSED(L);
+        Body *b = body;
+        StepParams *p = (StepParams *)data;
+        
+        if (!p->init) {
+                vect_f pos = body_pos(b);
+                p->init = 1;
+                p->u.orbit.angle = atan2f(pos.y, pos.x);
+                p->u.orbit.dist = p->u.orbit.radius;
+                if (p->u.orbit.dist == 0.0)
+                        p->u.orbit.dist = sqrtf(pos.x * pos.x + pos.y * pos.y);
+        }
+        
+        p->u.orbit.angle += p->u.orbit.angvel * b->world->step_sec;
+        float r = p->u.orbit.dist;
+        body_set_pos(b, (vect_f){r * cosf(p->u.orbit.angle),
+                                 r * sinf(p->u.orbit.angle)});
+}
+
+/*
+ * Standard movement with drag:
+ *     eapi.SetStepC(body, eapi.STEPFUNC_DRAG, k)
+ *
+ * Velocity decays by a factor of exp(-k) every second, so a body with no
+ * acceleration eventually comes to rest.
+ */
+void
+stepfunc_drag(lua_State *L, void *body, intptr_t data)
+{
+        Body *b = body;
+        StepParams *p = (StepParams *)data;
+        float decay = expf(-p->u.drag.k * b->world->step_sec);
+        b->vel.x *= decay;
+        b->vel.y *= decay;
+        stepfunc_std(L, body, 0);
+}
+
+/*
+ * Follow a body with delay:
+ *     eapi.SetStepC(body, eapi.STEPFUNC_CHASE, lag, target=nil, offset=nil)
+ *
+ * Body's absolute position eases toward target's absolute position (plus
+ * `offset`). `lag` is the time constant in seconds: the remaining distance
+ * shrinks by a factor of e every `lag` seconds. Without a target (or once it
+ * is gone) the body follows its own parent, which gives the usual "trailing
+ * segment" effect for snake-like enemies. A body without a parent (static or
+ * camera body) has an absolute position, and heads for the origin instead.
+ */
+void
+stepfunc_chase(lua_State *L, void *body, intptr_t data)
+{
+        UNUSED(L);
+        Body *b = body;
+        StepParams *p = (StepParams *)data;
+        
+        vect_f parent_pos = {0.0, 0.0};
+        if (b->parent != NULL)
+                parent_pos = body_absolute_pos(b->parent);
+        if (!p->init) {
+                p->init = 1;
+                p->u.chase.pos = body_absolute_pos(b);
+        }
+        
+        Body *target = live_target(p->u.chase.target);
+        vect_f goal = target ? body_absolute_pos(target) : parent_pos;
+        goal.x += p->u.chase.offset.x;
+        goal.y += p->u.chase.offset.y;
+        
+        float t = 1.0;
+        if (p->u.chase.lag > 0.0)
+                t = 1.0 - expf(-b->world->step_sec / p->u.chase.lag);
+        vect_f *pos = &p->u.chase.pos;
+        pos->x += (goal.x - pos->x) * t;
+        pos->y += (goal.y - pos->y) * t;
+        
+        /* Body position is relative to parent. */
+        body_set_pos(b, vect_f_sub(*pos, parent_pos));
+}
@@ -1,7 +1,58 @@
 #ifndef GAME2D_STEPFUNC_H
 #define GAME2D_STEPFUNC_H
 
+#include "common.h"
+#include "body.h"
+#include "geometry.h"
+
+/*
+ * Parameters of native step functions. A body that uses one of the functions
+ * below owns a copy of this struct (see BODY_STEP_PARAMS); it is filled in when
+ * the step function is set, so stepping never has to call back into Lua.
+ *
+ * init         Zero until step function has set up its running state (sine
+ *              center and time, orbit angle and distance, chase position).
+ * target       Handle of body to home in on (homing) or to follow (chase).
+ */
+typedef struct {
+        int     init;
+        union {
+                struct {
+                        float   dvel, ivel, mult;
+                } rot;
+                struct {
+                        Handle  target;
+                        float   turn, speed;
+                } homing;
+                struct {
+                        float   amplitude, frequency, phase, time;
+                        vect_f  center;
+                } sine;
+                struct {
+                        float   angvel, radius, angle, dist;
+                } orbit;
+                struct {
+                        float   k;
+                } drag;
+                struct {
+                        Handle  target;
+                        float   lag;
+                        vect_f  offset, pos;
+                } chase;
+        } u;
+} StepParams;
+
+StepParams *stepparams_new(void);
+StepParams *stepparams_copy(const StepParams *p);
+StepParams *stepparams_clone(const StepParams *p);
+void        stepparams_free(StepParams *p);
+
 void    stepfunc_std(lua_State *, void *, intptr_t);
 void    stepfunc_rot(lua_State *, void *, intptr_t);
+void    stepfunc_homing(lua_State *, void *, intptr_t);
+void    stepfunc_sine(lua_State *, void *, intptr_t);
+void    stepfunc_orbit(lua_State *, void *, intptr_t);
+void    stepfunc_drag(lua_State *, void *, intptr_t);
+void    stepfunc_chase(lua_State *, void *, intptr_t);
 
 #endif  /* GAME2D_STEPFUNC_H */
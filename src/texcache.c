@@ -0,0 +1,302 @@
+#include <SDL.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "texcache.h"
+#include "log.h"
+#include "mem.h"
+#include "uthash_tuned.h"
+
+/*
+ * Cache file is a sequence of records, each one a header followed by w * h
+ * tightly packed RGBA pixels (without power-of-two padding). Records are
+ * appended as images get decoded; if a name appears more than once, the last
+ * record wins. Header size and pixel data are multiples of four bytes, so all
+ * records stay aligned within the mapped file.
+ */
+#define TEXCACHE_MAGIC          "TXC1"
+#define TEXCACHE_MAX_SIZE       16384   /* Sanity limit on image dimensions. */
+
+typedef struct {
+        char            magic[4];
+        char            name[128];
+        uint32_t        mtime;          /* Source file modification time. */
+        uint32_t        src_size;       /* Source file size. */
+        uint32_t        w, h;
+} Record;
+
+typedef struct {
+        const Record    *rec;
+        UT_hash_handle  hh;
+} Entry;
+
+typedef struct {
+        char            name[128];
+        UT_hash_handle  hh;
+} Stored;
+
+static const unsigned char *map;        /* Cache file contents. */
+static size_t           map_size;
+
+/* Built by texcache_open() and only read after that, so no locking needed. */
+static Entry            *entry_hash;
+
+static FILE             *append_file;   /* New records are written here. */
+static SDL_mutex        *append_mutex;  /* Loader threads store, too. */
+static Stored           *stored_hash;   /* Names appended this session. */
+
+static int
+source_stat(const char *name, uint32_t *mtime, uint32_t *size)
+{
+        struct stat st;
+        if (stat(name, &st) != 0)
+                return 0;
+        *mtime = (uint32_t)st.st_mtime;
+        *size = (uint32_t)st.st_size;
+        return 1;
+}
+
+/*
+ * Map cache file into memory. Returns false if there is nothing to map.
+ */
+static int
+map_file(const char *filename)
+{
+#ifndef _WIN32
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0)
+                return 0;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+                close(fd);
+                return 0;
+        }
+        void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);      /* Mapping stays valid. */
+        if (addr == MAP_FAILED) {
+                log_err("[TEXCACHE] Could not map `%s`.", filename);
+                return 0;
+        }
+        map = addr;
+        map_size = st.st_size;
+        return 1;
+#else
+        /* No mmap(): read the whole file instead. */
+        FILE *f = fopen(filename, "rb");
+        if (f == NULL)
+                return 0;
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        rewind(f);
+        if (size <= 0) {
+                fclose(f);
+                return 0;
+        }
+        unsigned char *buf = mem_alloc(size, "Texture cache");
+        if (fread(buf, size, 1, f) != 1) {
+                log_err("[TEXCACHE] Could not read `%s`.", filename);
+                mem_free(buf);
+                fclose(f);
+                return 0;
+        }
+        fclose(f);
+        map = buf;
+        map_size = size;
+        return 1;
+#endif
+}
+
+static void
+unmap_file(void)
+{
+        if (map == NULL)
+                return;
+#ifndef _WIN32
+        munmap((void *)map, map_size);
+#else
+        mem_free((void *)map);
+#endif
+        map = NULL;
+        map_size = 0;
+}
+
+static void
+free_entries(void)
+{
+        Entry *e, *tmp;
+        HASH_ITER(hh, entry_hash, e, tmp) {
+                HASH_DEL(entry_hash, e);
+                mem_free(e);
+        }
+}
+
+static size_t
+record_size(const Record *rec)
+{
+        return sizeof(Record) + (size_t)rec->w * rec->h * 4;
+}
+
+/*
+ * Index records of mapped cache file by name. Returns false if the file is
+ * damaged or made up mostly of outdated records, in which case it should be
+ * rebuilt.
+ */
+static int
+index_records(void)
+{
+        size_t offset = 0, stale = 0;
+        while (offset < map_size) {
+                const Record *rec = (const Record *)&map[offset];
+                if (map_size - offset < sizeof(Record) ||
+                    memcmp(rec->magic, TEXCACHE_MAGIC, 4) != 0 ||
+                    memchr(rec->name, '\0', sizeof(rec->name)) == NULL ||
+                    rec->w == 0 || rec->w > TEXCACHE_MAX_SIZE ||
+                    rec->h == 0 || rec->h > TEXCACHE_MAX_SIZE ||
+                    map_size - offset < record_size(rec))
+                        return 0;
+        
+                /* Later records replace earlier ones by the same name. */
+                Entry *e;
+                HASH_FIND_STR(entry_hash, rec->name, e);
+                if (e != NULL) {
+                        stale += record_size(e->rec);
+                        e->rec = rec;
+                } else {
+                        e = mem_alloc(sizeof(Entry), "Texture cache entry");
+                        e->rec = rec;
+                        HASH_ADD_KEYPTR(hh, entry_hash, rec->name,
+                                        strlen(rec->name), e);
+                }
+                offset += record_size(rec);
+        }
+        return (stale <= map_size / 2);
+}
+
+/*
+ * Open (or create) cache file. Existing records are mapped into memory and
+ * indexed; new ones are appended to the same file.
+ */
+void
+texcache_open(const char *filename)
+{
+        assert(filename && *filename && append_mutex == NULL);
+        const char *mode = "ab";
+        if (map_file(filename) && !index_records()) {
+                log_msg("[TEXCACHE] Rebuilding `%s`.", filename);
+                free_entries();
+                unmap_file();
+                mode = "wb";
+        }
+        log_msg("[TEXCACHE] %u images in `%s`.", HASH_COUNT(entry_hash),
+                filename);
+        
+        append_mutex = SDL_CreateMutex();
+        append_file = fopen(filename, mode);
+        if (append_file == NULL)
+                log_err("[TEXCACHE] Cannot write to `%s`.", filename);
+}
+
+/*
+ * Stop adding records. The mapping is left alone since loader threads may
+ * still be reading from it; it goes away with the process.
+ */
+void
+texcache_close(void)
+{
+        if (append_mutex == NULL)
+                return;
+        SDL_mutexP(append_mutex);
+        {
+                if (append_file != NULL)
+                        fclose(append_file);
+                append_file = NULL;
+        }
+        SDL_mutexV(append_mutex);
+}
+
+/*
+ * Fill `ti` with cached pixels of image file `name`. Returns false if the image
+ * is not in cache, or its source file has changed since it was cached. May be
+ * called from any thread.
+ */
+int
+texcache_lookup(const char *name, TexImage *ti)
+{
+        Entry *e;
+        HASH_FIND_STR(entry_hash, name, e);
+        if (e == NULL)
+                return 0;
+        
+        const Record *rec = e->rec;
+        uint32_t mtime, size;
+        if (!source_stat(name, &mtime, &size) || mtime != rec->mtime ||
+            size != rec->src_size)
+                return 0;       /* Source has changed. */
+        
+        texture_image_alloc(ti, rec->w, rec->h);
+        const unsigned char *src = (const unsigned char *)(rec + 1);
+        unsigned pitch = ti->pow_w * 4;
+        for (unsigned y = 0; y < rec->h; y++) {
+                memcpy(&ti->pixels[y * pitch], &src[y * rec->w * 4],
+                       rec->w * 4);
+        }
+        return 1;
+}
+
+/*
+ * Append decoded image to cache file. Each name is only appended once per
+ * session: an image that gets evicted and reloaded is decoded again (the index
+ * is not updated after texcache_open()), but need not be stored again. May be
+ * called from any thread.
+ */
+void
+texcache_store(const char *name, const TexImage *ti)
+{
+        if (append_mutex == NULL)
+                return;         /* Cache is not in use. */
+        
+        Record rec;
+        memset(&rec, 0, sizeof(rec));
+        memcpy(rec.magic, TEXCACHE_MAGIC, sizeof(rec.magic));
+        if (strlen(name) >= sizeof(rec.name) ||
+            !source_stat(name, &rec.mtime, &rec.src_size))
+                return;
+        strcpy(rec.name, name);
+        rec.w = ti->w;
+        rec.h = ti->h;
+        
+        SDL_mutexP(append_mutex);
+        Stored *st;
+        HASH_FIND_STR(stored_hash, name, st);
+        if (append_file != NULL && st == NULL) {
+                st = mem_alloc(sizeof(Stored), "Texture cache name");
+                strcpy(st->name, name);
+                HASH_ADD_STR(stored_hash, name, st);
+                
+                /* Write header, then image rows without padding. */
+                int ok = (fwrite(&rec, sizeof(rec), 1, append_file) == 1);
+                unsigned pitch = ti->pow_w * 4;
+                for (unsigned y = 0; ok && y < ti->h; y++) {
+                        ok = (fwrite(&ti->pixels[y * pitch], ti->w * 4, 1,
+                                     append_file) == 1);
+                }
+        
+                /*
+                 * A partly written record is detected (and the file rebuilt)
+                 * when the cache is opened next time.
+                 */
+                if (!ok) {
+                        log_err("[TEXCACHE] Write failed, no longer adding "
+                                "images.");
+                        fclose(append_file);
+                        append_file = NULL;
+                }
+        }
+        SDL_mutexV(append_mutex);
+}
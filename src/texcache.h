@@ -0,0 +1,18 @@
+#ifndef GAME2D_TEXCACHE_H
+#define GAME2D_TEXCACHE_H
+
+#include "common.h"
+#include "texture.h"
+
+/*
+ * Texture cache: a single file holding decoded images so that they need not go
+ * through SDL_image again on the next run. Entries are keyed by image file
+ * name and become invalid once the source file's modification time or size
+ * changes. See texcache.c for the file layout.
+ */
+void    texcache_open(const char *filename);
+void    texcache_close(void);
+int     texcache_lookup(const char *name, TexImage *ti);
+void    texcache_store(const char *name, const TexImage *ti);
+
+#endif  /* GAME2D_TEXCACHE_H */
@@ -5,8 +5,11 @@
 #include "mem.h"
 #include "misc.h"
 #include "log.h"
+#include "manifest.h"
 #include "spritelist.h"
+#include "texcache.h"
 #include "texture.h"
+#include "texture_async.h"
 #include "utlist.h"
 
 #define valid_texture(x)                                        \
@@ -26,6 +29,17 @@ static unsigned bound_texture = 0;
 static unsigned     loaded_size; /* Approx total size of loaded textures. */
 static unsigned     loaded_max_size = 1024 * 1024 * 512; /* 512 MB */
 
+/*
+ * Frame counter (see texture_new_frame()), and its values at the last few
+ * texture_free_unused() calls.
+ */
+static unsigned     frame = 1;
+static unsigned     free_frames[TEXTURE_HISTORY];
+
+/* Optional OpenGL features (see texture_check_extensions()). */
+static int          have_npot;
+static int          have_s3tc;
+
 static inline Texture *
 texture_alloc(const char *fullname, unsigned flags)
 {
@@ -37,14 +51,39 @@ texture_alloc(const char *fullname, unsigned flags)
 }
 
 
-static inline void
+/*
+ * Write texture's hash key into `buf`: image name, prefixed with "f=1;" if the
+ * texture is filtered, and with "c=<format bits>;" if it has a format hint, so
+ * that the same image loaded in different formats makes different textures.
+ */
+void
 texture_fullname(const char *name, unsigned flags, char *buf, unsigned bufsize)
 {
         assert(name && *name);
         int filter = flags & TEXFLAG_FILTER;
+        unsigned format = flags & TEXFLAG_FORMAT;
+        if (format != 0) {
+                snprintf(buf, bufsize, filter ? "f=1;c=%x;%s" : "c=%x;%s",
+                         format, name);
+                return;
+        }
         snprintf(buf, bufsize, filter ? "f=1;%s" : "%s" , name);
 }
 
+/*
+ * Image name of a texture: its hash key without texture_fullname() prefixes.
+ */
+static const char *
+texture_image_name(const Texture *tex)
+{
+        const char *name = tex->name;
+        if (tex->flags & TEXFLAG_FILTER)
+                name += 4;      /* "f=1;" */
+        if (tex->flags & TEXFLAG_FORMAT)
+                name = strchr(name, ';') + 1;
+        return name;
+}
+
 /*
  * Return true if texture is loaded into OpenGL.
  */
@@ -67,7 +106,9 @@ texture_unload(Texture *tex)
         assert(valid_texture(tex) && tex->id != 0);
         glDeleteTextures(1, &tex->id);
         tex->id = 0;
-        loaded_size -= (tex->pow_w * tex->pow_h * 4);
+        tex->reloading = 0;
+        loaded_size -= tex->size;
+        tex->size = 0;
         tex->w = tex->pow_w = 0;
         tex->h = tex->pow_h = 0;
 }
@@ -104,40 +145,72 @@ texture_free(Texture *tex)
 }
 
 /*
- * Free textures that have not been used in a while.
+ * Free textures that have not been used since TEXTURE_HISTORY calls to this
+ * function ago.
  */
 void
 texture_free_unused(void)
 {
-        Texture *tex, *tmp;
+        unsigned oldest = free_frames[0];
+        memmove(&free_frames[0], &free_frames[1],
+                sizeof(free_frames) - sizeof(free_frames[0]));
+        free_frames[TEXTURE_HISTORY - 1] = frame;
         
+        Texture *tex, *tmp;
         HASH_ITER(hh, texture_hash, tex, tmp) {
-                if (--tex->usage < 1)
+                if (tex->last_used < oldest)
                         texture_free(tex);
         }
 }
 
 /*
- * Free older textures to keep total texture memory size under
- * `loaded_max_size`.
+ * Unload least recently used textures to keep total texture memory size under
+ * `loaded_max_size`. Render targets and textures used during the current frame
+ * are left alone.
  */
 static void
 texture_cleanup(void)
 {
-        if (loaded_size <= loaded_max_size)
-                return;         /* Under limit. */
-        
-        /* Clear out some older textures. */
-        Texture *tex, *tex_tmp;
-        HASH_ITER(hh, texture_hash, tex, tex_tmp) {
-                if (tex->id != 0) {
-                        texture_unload(tex);
-                        if (loaded_size <= loaded_max_size)
-                                break;
+        while (loaded_size > loaded_max_size) {
+                Texture *lru = NULL, *tex, *tmp;
+                HASH_ITER(hh, texture_hash, tex, tmp) {
+                        if (tex->id == 0 || tex->pinned ||
+                            tex->last_used == frame)
+                                continue;
+                        if (lru == NULL || tex->last_used < lru->last_used)
+                                lru = tex;
                 }
+                if (lru == NULL)
+                        return;         /* Nothing left to unload. */
+                texture_unload(lru);
         }
 }
 
+/*
+ * Async loader callback for textures reloaded by texture_bind(). By now the
+ * image has been loaded into OpenGL (see texasync_runsync()), unless it failed.
+ */
+static void
+reload_done(const char *img_name, uint flags, void *cb_data)
+{
+        UNUSED(cb_data);
+        if (!texture_is_loaded(img_name, flags))
+                log_err("[TEXTURE] Could not reload `%s`.", img_name);
+}
+
+/*
+ * Start a new frame: upload textures that the async loader has reloaded and
+ * advance the frame counter that least recently used textures are told apart
+ * by. Call once per frame before rendering.
+ */
+void
+texture_new_frame(void)
+{
+        if (texasync_running())
+                texasync_runsync((uintptr_t)reload_done, (uintptr_t)0);
+        frame++;
+}
+
 void
 texture_limit(unsigned MB)
 {
@@ -145,6 +218,45 @@ texture_limit(unsigned MB)
         texture_cleanup();
 }
 
+/*
+ * See which optional texture features OpenGL supports. Must be called once
+ * OpenGL context exists, before any textures are loaded.
+ */
+void
+texture_check_extensions(void)
+{
+        have_npot = check_extension("GL_ARB_texture_non_power_of_two");
+        have_s3tc = check_extension("GL_EXT_texture_compression_s3tc");
+        log_msg("[TEXTURE] Non-power-of-two textures: %s, S3TC: %s.",
+                have_npot ? "yes" : "no", have_s3tc ? "yes" : "no");
+}
+
+/*
+ * Return texture size needed to hold an image of given size (width or height):
+ * the image size itself if non-power-of-two textures are supported, nearest
+ * power of two otherwise.
+ */
+unsigned
+texture_pad(unsigned size)
+{
+        return have_npot ? size : nearest_pow2(size);
+}
+
+/*
+ * Approximate number of bits a texture pixel takes up in video memory.
+ */
+static unsigned
+bits_per_pixel(unsigned flags)
+{
+        if (flags & (TEXFLAG_RGB565 | TEXFLAG_RGBA4444 | TEXFLAG_LA88))
+                return 16;
+        if ((flags & TEXFLAG_COMPRESS) && have_s3tc)
+                return 8;
+        if (flags & TEXFLAG_INTENSITY)
+                return 8;
+        return 32;
+}
+
 /*
  * Users must not manually set texture width and height. This function should be
  * used instead.
@@ -157,12 +269,13 @@ texture_set_size(Texture *tex, unsigned width, unsigned height)
         assert(tex->pow_w == 0 && tex->pow_h == 0);
         tex->w = width;
         tex->h = height;
-        tex->pow_w = nearest_pow2(width);
-        tex->pow_h = nearest_pow2(height);
+        tex->pow_w = texture_pad(width);
+        tex->pow_h = texture_pad(height);
+        tex->size = tex->pow_w * tex->pow_h * bits_per_pixel(tex->flags) / 8;
         assert(valid_texture(tex) && tex->id != 0);
                 
         /* Cleanup if max size exceeded. */
-        loaded_size += (tex->pow_w * tex->pow_h * 4);
+        loaded_size += tex->size;
         texture_cleanup();
         
         log_msg("Load `%s`   total: %.2f MB", tex->name,
@@ -194,50 +307,78 @@ gentex_checkerboard(unsigned width, unsigned height)
 }
 #endif
 
-static void
-surface_to_texture(SDL_Surface *img, unsigned flags, unsigned *w, unsigned *h)
+/*
+ * Byte order of pixels that are fed into OpenGL (GL_RGBA, GL_UNSIGNED_BYTE).
+ */
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+#define RGBA_RMASK      0xff000000
+#define RGBA_GMASK      0x00ff0000
+#define RGBA_BMASK      0x0000ff00
+#define RGBA_AMASK      0x000000ff
+#else
+#define RGBA_RMASK      0x000000ff
+#define RGBA_GMASK      0x0000ff00
+#define RGBA_BMASK      0x00ff0000
+#define RGBA_AMASK      0xff000000
+#endif
+
+/*
+ * Allocate pixel buffer for an image of given size. Only the power-of-two
+ * padding (to the right of and below the image) is cleared; caller fills in
+ * the rest. Release buffer with texture_image_free().
+ */
+void
+texture_image_alloc(TexImage *ti, unsigned w, unsigned h)
+{
+        assert(w > 0 && h > 0);
+        ti->w = w;
+        ti->h = h;
+        ti->pow_w = texture_pad(w);
+        ti->pow_h = texture_pad(h);
+        ti->bpp = 4;
+        ti->format = GL_RGBA;
+        ti->type = GL_UNSIGNED_BYTE;
+        unsigned pitch = ti->pow_w * 4;
+        unsigned char *pixels = mem_alloc(pitch * ti->pow_h, "Texture pixels");
+        if (ti->pow_w > w) {
+                for (unsigned y = 0; y < h; y++) {
+                        memset(&pixels[y * pitch + w * 4], 0,
+                               (ti->pow_w - w) * 4);
+                }
+        }
+        memset(&pixels[h * pitch], 0, (ti->pow_h - h) * pitch);
+        ti->pixels = pixels;
+}
+
+/*
+ * Convert image into an upload-ready pixel buffer (see TexImage). This does
+ * not touch any OpenGL state, so it may be called from any thread (see
+ * texture_async.c). Release buffer with texture_image_free().
+ */
+void
+texture_image_init(TexImage *ti, SDL_Surface *img)
 {
+        texture_image_alloc(ti, img->w, img->h);
+        unsigned pitch = ti->pow_w * 4;
+        
+        /*
+         * Wrap a surface around the top left corner of pixel buffer, so that
+         * SDL_BlitSurface() does all the conversion work and writes straight
+         * into the buffer. Freeing this surface leaves the pixels alone.
+         */
+        SDL_Surface *dst = SDL_CreateRGBSurfaceFrom(ti->pixels, img->w, img->h,
+                                                    32, pitch, RGBA_RMASK,
+                                                    RGBA_GMASK, RGBA_BMASK,
+                                                    RGBA_AMASK);
+        assert(dst != NULL);
 #if ENABLE_SDL2
-        /* OpenGL pixel format for destination surface. */
-        int bpp;
-        Uint32 Rmask, Gmask, Bmask, Amask;
-        SDL_PixelFormatEnumToMasks(SDL_PIXELFORMAT_ABGR8888, &bpp, &Rmask,
-                                   &Gmask, &Bmask, &Amask);
-        
-        /* Create surface that will hold pixels passed into OpenGL. */
-        SDL_Surface *img_rgba8888 = SDL_CreateRGBSurface(0, img->w, img->h, bpp,
-                                                         Rmask, Gmask, Bmask,
-                                                         Amask);
         /*
          * Disable blending for source surface. If this is not done, all
          * destination surface pixels end up with crazy alpha values.
          */
         SDL_SetSurfaceAlphaMod(img, 0xFF);
         SDL_SetSurfaceBlendMode(img, SDL_BLENDMODE_NONE);
-        
-        /* Blit to this surface, effectively converting the format. */
-        SDL_BlitSurface(img, NULL, img_rgba8888, NULL);
 #else
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-        Uint32 rmask = 0xff000000;
-        Uint32 gmask = 0x00ff0000;
-        Uint32 bmask = 0x0000ff00;
-        Uint32 amask = 0x000000ff;
-#else
-        Uint32 rmask = 0x000000ff;
-        Uint32 gmask = 0x0000ff00;
-        Uint32 bmask = 0x00ff0000;
-        Uint32 amask = 0xff000000;
-#endif
-        /*
-         * Create a surface with such a pixel format that we can feed its pixels
-         * directly into OpenGL.
-         */
-        Uint32 sflags = SDL_SWSURFACE | SDL_SRCALPHA;
-        assert(!SDL_MUSTLOCK(img));     /* Shouldn't require locking. */
-        SDL_Surface *img_rgba8888 = SDL_CreateRGBSurface(sflags, img->w, img->h,
-                                                         32, rmask, gmask,
-                                                         bmask, amask);
         /*
          * From SDL documentation wiki:
          * When you're blitting between two alpha surfaces, normally the alpha
@@ -247,38 +388,124 @@ surface_to_texture(SDL_Surface *img, unsigned flags, unsigned *w, unsigned *h)
          * can be surprising when you're trying to combine one image with
          * another and both have transparent backgrounds.
          */
+        assert(!SDL_MUSTLOCK(img));     /* Shouldn't require locking. */
         img->flags &= ~SDL_SRCALPHA;
-        
-        /*
-         * Copy loaded image data onto a surface that we can feed into OpenGL.
-         * We let SDL_BlitSurface() do all the conversion work.
-         */
-        SDL_BlitSurface(img, NULL, img_rgba8888, NULL);
 #endif
-        /* Store width and height as return values. */
-        assert(w && h);
-        *w = img->w;
-        *h = img->h;
-        unsigned pow_w = nearest_pow2(img->w);
-        unsigned pow_h = nearest_pow2(img->h);
+        SDL_BlitSurface(img, NULL, dst, NULL);
+        SDL_FreeSurface(dst);
+}
+
+/*
+ * Convert RGBA image into the pixel format requested by format hint in `flags`
+ * (see TextureFlags). Conversion is done in place; the pixel buffer keeps its
+ * size even though only part of it is used afterwards. Like the functions
+ * above, this may be called from any thread.
+ */
+void
+texture_image_convert(TexImage *ti, unsigned flags)
+{
+        assert(ti->bpp == 4 && ti->format == GL_RGBA && ti->pixels != NULL);
+        unsigned hint = flags & (TEXFLAG_RGB565 | TEXFLAG_RGBA4444 |
+                                 TEXFLAG_LA88);
+        if (hint == 0)
+                return;         /* Stays RGBA. */
         
         /*
-         * Create a blank texture with power-of-two dimensions. Then load
-         * converted image data into its lower left.
+         * Destination pixels are smaller, so writing never overtakes reading.
+         * Padding is converted along with the image; zero stays zero.
          */
-        GLint iformat = (flags & TEXFLAG_INTENSITY) ? GL_INTENSITY : GL_RGBA;
-        glTexImage2D(GL_TEXTURE_2D, 0, iformat, pow_w, pow_h, 0, GL_RGBA,
-                     GL_UNSIGNED_BYTE, NULL);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, img->w, img->h, GL_RGBA,
-                        GL_UNSIGNED_BYTE, img_rgba8888->pixels);
+        const unsigned char *src = ti->pixels;
+        unsigned num_pixels = ti->pow_w * ti->pow_h;
+        switch (hint) {
+        case TEXFLAG_RGB565: {
+                uint16_t *dst = (uint16_t *)ti->pixels;
+                for (unsigned i = 0; i < num_pixels; i++, src += 4) {
+                        dst[i] = ((src[0] >> 3) << 11) | ((src[1] >> 2) << 5) |
+                                 (src[2] >> 3);
+                }
+                ti->format = GL_RGB;
+                ti->type = GL_UNSIGNED_SHORT_5_6_5;
+                break;
+        }
+        case TEXFLAG_RGBA4444: {
+                uint16_t *dst = (uint16_t *)ti->pixels;
+                for (unsigned i = 0; i < num_pixels; i++, src += 4) {
+                        dst[i] = ((src[0] >> 4) << 12) | ((src[1] >> 4) << 8) |
+                                 ((src[2] >> 4) << 4) | (src[3] >> 4);
+                }
+                ti->format = GL_RGBA;
+                ti->type = GL_UNSIGNED_SHORT_4_4_4_4;
+                break;
+        }
+        case TEXFLAG_LA88: {
+                unsigned char *dst = ti->pixels;
+                for (unsigned i = 0; i < num_pixels; i++, src += 4) {
+                        dst[2 * i] = (src[0] * 77 + src[1] * 150 +
+                                      src[2] * 29) >> 8;
+                        dst[2 * i + 1] = src[3];
+                }
+                ti->format = GL_LUMINANCE_ALPHA;
+                ti->type = GL_UNSIGNED_BYTE;
+                break;
+        }
+        default:
+                fatal_error("Conflicting texture format hints (flags: %u).",
+                            flags);
+        }
+        ti->bpp = 2;
+}
+
+void
+texture_image_free(TexImage *ti)
+{
+        mem_free(ti->pixels);
+        ti->pixels = NULL;
+}
+
+/*
+ * Load image into currently bound texture. This is the only work left for the
+ * main thread: a single glTexImage2D() call (plus mipmap generation).
+ */
+static void
+image_to_texture(const TexImage *ti, unsigned flags)
+{
+        assert(ti->pixels != NULL);
+        
+        /* Internal format matches pixels (see texture_image_convert()). */
+        GLint iformat = GL_RGBA;
+        if (ti->type == GL_UNSIGNED_SHORT_5_6_5)
+                iformat = GL_RGB5;
+        else if (ti->type == GL_UNSIGNED_SHORT_4_4_4_4)
+                iformat = GL_RGBA4;
+        else if (ti->format == GL_LUMINANCE_ALPHA)
+                iformat = GL_LUMINANCE8_ALPHA8;
+        else if (flags & TEXFLAG_INTENSITY)
+                iformat = GL_INTENSITY;
+        else if ((flags & TEXFLAG_COMPRESS) && have_s3tc)
+                iformat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        glTexImage2D(GL_TEXTURE_2D, 0, iformat, ti->pow_w, ti->pow_h, 0,
+                     ti->format, ti->type, ti->pixels);
         
         if ((flags & TEXFLAG_FILTER) && glGenerateMipmap != NULL)
                 glGenerateMipmap(GL_TEXTURE_2D);
-        
-        SDL_FreeSurface(img_rgba8888);
         check_gl_errors();
 }
 
+static void
+surface_to_texture(SDL_Surface *img, unsigned flags, unsigned *w, unsigned *h)
+{
+        TexImage ti;
+        texture_image_init(&ti, img);
+        texture_image_convert(&ti, flags);
+        image_to_texture(&ti, flags);
+        texture_image_free(&ti);
+        
+        /* Store width and height as return values. */
+        assert(w && h);
+        *w = img->w;
+        *h = img->h;
+}
+
 #if ENABLE_SQLITE
 /*
  * Read image data from database, and load it into OpenGL by calling
@@ -336,6 +563,36 @@ surface_from_db(const char *name)
 }
 #endif  /* ENABLE_SQLITE */
 
+/*
+ * Read image into an upload-ready pixel buffer. Images from files go through
+ * the texture cache (see texcache.c), so they only need decoding when the
+ * cache does not have them yet. Image is converted into the pixel format that
+ * `flags` ask for. Returns false if image could not be loaded.
+ */
+static int
+load_image(const char *name, unsigned flags, TexImage *ti)
+{
+        ti->pixels = NULL;
+#if ENABLE_SQLITE
+        SDL_Surface *img = surface_from_db(name);
+#else
+        SDL_Surface *img = NULL;
+        if (!texcache_lookup(name, ti))
+                img = IMG_Load(name);
+#endif
+        if (img != NULL) {
+                texture_image_init(ti, img);
+                SDL_FreeSurface(img);
+#if !ENABLE_SQLITE
+                texcache_store(name, ti);   /* Cache holds RGBA. */
+#endif
+        } else if (ti->pixels == NULL) {
+                return 0;
+        }
+        texture_image_convert(ti, flags);
+        return 1;
+}
+
 static void
 enable_texturing(void)
 {
@@ -441,37 +698,48 @@ texture_bind(Texture *tex)
                 return;
         }
         
+        /* Remember when texture was last used (see texture_cleanup()). */
+        tex->last_used = frame;
+        
         /* Do nothing if texturing enabled and texture already bound. */
         if (bound_texture != 0 && bound_texture == tex->id)
                 return;
         
         /* See if texture is loaded into OpenGL. */
         if (tex->id == 0) {
-                /* Remove "f=1;" from name if the texture is filtered. */
                 int filter = tex->flags & TEXFLAG_FILTER;
-                const char *img_name = filter ? &tex->name[4] : tex->name;
-#if PLATFORM_IOS
-                SDL_Surface *img = surface_from_db(img_name);
-#else
-                SDL_Surface *img = IMG_Load(img_name);
-#endif
-                if (img == NULL)
+                const char *img_name = texture_image_name(tex);
+                
+                /*
+                 * Texture has been unloaded to save memory. Have it reloaded
+                 * in the background rather than stall this frame; until then
+                 * it stays unbound (see texture_new_frame()).
+                 */
+                if (texasync_running()) {
+                        if (!tex->reloading) {
+                                tex->reloading = 1;
+                                texasync_load(img_name, tex->flags, 0,
+                                              reload_done, NULL);
+                        }
+                        return;
+                }
+                TexImage ti;
+                if (!load_image(img_name, tex->flags, &ti))
                         return; /* Image could not be loaded. */
                 
                 /* Generate texture ID, bind it, set parameters. */
                 gen_and_bind(&tex->id, filter);
                 
                 /* Read image data into OpenGL. */
-                unsigned w, h;
-                surface_to_texture(img, tex->flags, &w, &h);
-                SDL_FreeSurface(img);
+                image_to_texture(&ti, tex->flags);
+                texture_image_free(&ti);
                 
                 /* Remove texture from hash and re-add at the end. */
                 assert(valid_texture(tex));
                 HASH_DEL(texture_hash, tex);
                 HASH_ADD_STR(texture_hash, name, tex);
 
-                texture_set_size(tex, w, h);
+                texture_set_size(tex, ti.w, ti.h);
                 update_matrix(tex);
                 return;
         }
@@ -505,7 +773,7 @@ lookup_or_create(const char *img_name, unsigned flags)
         }
         
         /* Mark texture as recently used and add it to hash. */
-        tex->usage = TEXTURE_HISTORY;
+        tex->last_used = frame;
         HASH_ADD_STR(texture_hash, name, tex);
         
         return tex;
@@ -526,16 +794,13 @@ Texture *
 texture_load(const char *img_name, unsigned flags)
 {
         Texture *tex = lookup_or_create(img_name, flags);
+        manifest_use(MANIFEST_TEXTURE, img_name, flags, tex->id == 0);
         if (tex->id != 0)
                 return tex;     /* Texture is loaded and ready! */
         
         /* Read image data. */
-#if ENABLE_SQLITE
-        SDL_Surface *img = surface_from_db(img_name);
-#else
-        SDL_Surface *img = IMG_Load(img_name);
-#endif
-        if (img == NULL) {
+        TexImage ti;
+        if (!load_image(img_name, flags, &ti)) {
                 texture_free(tex);
                 return NULL;    /* Not found. */
         }
@@ -544,12 +809,11 @@ texture_load(const char *img_name, unsigned flags)
         gen_and_bind(&tex->id, (flags & TEXFLAG_FILTER));
         
         /* Load data into OpenGL. */
-        unsigned w, h;
-        surface_to_texture(img, flags, &w, &h);
-        SDL_FreeSurface(img);
+        image_to_texture(&ti, flags);
+        texture_image_free(&ti);
         
         /* Store width & height in texture struct. */
-        texture_set_size(tex, w, h);
+        texture_set_size(tex, ti.w, ti.h);
         return tex;
 }
 
@@ -577,6 +841,43 @@ texture_preload_surface(const char *img_name, unsigned flags, SDL_Surface *img)
         return tex;
 }
 
+/*
+ * Same thing as texture_preload_surface() except image has already been
+ * converted (see texture_image_init()), most likely on another thread.
+ */
+Texture *
+texture_preload_image(const char *img_name, unsigned flags, const TexImage *ti)
+{
+        Texture *tex = lookup_or_create(img_name, flags);
+        if (tex->id != 0)
+                return tex;     /* Texture is loaded and ready! */
+        
+        /* Generate texture ID, bind it, load image data into OpenGL. */
+        gen_and_bind(&tex->id, (flags & TEXFLAG_FILTER));
+        image_to_texture(ti, flags);
+        tex->reloading = 0;     /* Done, whoever queued the load. */
+        
+        /* Store width & height in texture struct. */
+        texture_set_size(tex, ti->w, ti->h);
+        return tex;
+}
+
+/*
+ * Async loader could not load image (see texasync_runsync()). If texture_bind()
+ * is waiting for it, let it try again, no matter who queued the load.
+ */
+void
+texture_preload_failed(const char *img_name, unsigned flags)
+{
+        char fullname[128];
+        texture_fullname(img_name, flags, fullname, sizeof(fullname));
+        
+        Texture *tex;
+        HASH_FIND_STR(texture_hash, fullname, tex);
+        if (tex != NULL)
+                tex->reloading = 0;
+}
+
 /*
  * This loads texture data from memory. It's an optimization hack for the few
  * instances where image data is fetched over network or somehow ends up in
@@ -617,6 +918,7 @@ texture_load_blank(const char *img_name, unsigned flags)
         /* Unload texture from OpenGL if it's in there. */
         if (tex->id != 0)
                 texture_unload(tex);
+        tex->pinned = 1;        /* Contents can't be reloaded from file. */
         
         /* Generate texture ID, bind it, set parameters. */
         gen_and_bind(&tex->id, (flags & TEXFLAG_FILTER));
@@ -8,27 +8,64 @@
 
 struct SpriteList_t;
 
-/* Determines how long unused textures stay in memory. */
+/*
+ * Number of texture_free_unused() calls (i.e., scene changes) that an unused
+ * texture survives.
+ */
 #define TEXTURE_HISTORY         5
 
+/*
+ * Texture flags. At most one of the format hints may be given; they trade
+ * color depth for less video memory (and, except for TEXFLAG_COMPRESS, less
+ * data to upload). TEXFLAG_COMPRESS is ignored if S3TC compression is not
+ * supported.
+ *
+ * TEXFLAG_RGB565       16-bit color, no alpha.
+ * TEXFLAG_RGBA4444     16-bit color with alpha.
+ * TEXFLAG_LA88         Luminance and alpha (grayscale images, gradients).
+ * TEXFLAG_COMPRESS     Let driver compress texture (S3TC DXT5).
+ */
 enum TextureFlags {
         TEXFLAG_FILTER     = (1 << 0),
-        TEXFLAG_INTENSITY  = (1 << 1)
+        TEXFLAG_INTENSITY  = (1 << 1),
+        TEXFLAG_RGB565     = (1 << 2),
+        TEXFLAG_RGBA4444   = (1 << 3),
+        TEXFLAG_LA88       = (1 << 4),
+        TEXFLAG_COMPRESS   = (1 << 5)
 };
+#define TEXFLAG_FORMAT  (TEXFLAG_RGB565 | TEXFLAG_RGBA4444 | TEXFLAG_LA88 | \
+                         TEXFLAG_COMPRESS)
 
 /*
- * Images are loaded as OpenGL textures. As such, both their width and height
- * must be numbers that are powers of two. If an image does not have power of
- * two dimensions, its buffer is extended to the smallest possible enclosing
- * power of two size.
+ * Decoded image, ready to be uploaded into OpenGL as is. Pixels are tightly
+ * packed in a buffer of texture size (see texture_pad()); the image takes up
+ * its first `h` rows and `w` columns, the rest is zero. Images start out as
+ * RGBA, one byte per channel, until converted by texture_image_convert().
+ */
+typedef struct {
+        unsigned w, h;          /* Image width and height in pixels. */
+        unsigned pow_w, pow_h;  /* Pixel buffer width and height. */
+        unsigned bpp;           /* Bytes per pixel. */
+        GLenum   format, type;  /* Pixel format and type for glTexImage2D(). */
+        unsigned char *pixels;
+} TexImage;
+
+/*
+ * Images are loaded as OpenGL textures. Unless non-power-of-two textures are
+ * supported, both their width and height must be numbers that are powers of
+ * two. If an image does not have power of two dimensions, its buffer is
+ * extended to the smallest possible enclosing power of two size.
  */
 typedef struct Texture_t {
         GLuint   id;            /* OpenGL texture ID. */
         char     name[128];     /* Texture name = hash key. */
         unsigned w, h;          /* Image width and height in pixels. */
         unsigned pow_w, pow_h;  /* Power of two extended widht & height. */
+        unsigned size;          /* Approximate video memory size (bytes). */
         unsigned flags;
-        int      usage;         /* Determines how recent was last use. */
+        unsigned last_used;     /* Frame number of last use. */
+        int      pinned;        /* Never unloaded (render targets). */
+        int      reloading;     /* Waiting for async loader to reload. */
         struct SpriteList_t *sprites;   /* Hash of sprite lists. */
 #if 0
         GLuint   vbo_id;        /* Texcoord vertex buffer ID. */
@@ -37,13 +74,25 @@ typedef struct Texture_t {
         UT_hash_handle hh;      /* We hash textures by name. */
 } Texture;
 
+void     texture_fullname(const char *name, unsigned flags, char *buf,
+                          unsigned bufsize);
 int      texture_is_loaded(const char *name, unsigned flags);
 Texture *texture_load(const char *name, unsigned flags);
 Texture *texture_preload(const char *, unsigned, const void *, unsigned);
 Texture *texture_preload_surface(const char *, unsigned, SDL_Surface *);
+Texture *texture_preload_image(const char *, unsigned, const TexImage *);
+void     texture_preload_failed(const char *name, unsigned flags);
 Texture *texture_load_blank(const char *name, unsigned flags);
 
+void     texture_image_alloc(TexImage *ti, unsigned w, unsigned h);
+void     texture_image_init(TexImage *ti, SDL_Surface *img);
+void     texture_image_convert(TexImage *ti, unsigned flags);
+void     texture_image_free(TexImage *ti);
+
+void     texture_check_extensions(void);
+unsigned texture_pad(unsigned size);
 void     texture_free_unused(void);
+void     texture_new_frame(void);
 void     texture_bind(Texture *tex);
 void     texture_bind_id(unsigned texid);
 int      texture_would_change(Texture *tex);
@@ -4,14 +4,27 @@
 #include "config.h"
 #include "mem.h"
 #include "misc.h"
+#include "texcache.h"
 #include "utlist.h"
+#if !ENABLE_SDL2 && !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+/*
+ * Maximum amount of decoded image data (bytes) that finished tasks may hold.
+ * Workers do not pick up new tasks while this is exceeded. Since image size is
+ * only known after decoding, each worker may go over the budget by one image.
+ */
+#define TEXASYNC_BUDGET         (32 * 1024 * 1024)
 
-/* Maximum number of finished tasks. Make sure this is at least 2. */
-#define TEXASYNC_FINISHED_MAX 2
+/* Upper limit on the number of loader threads. */
+#define TEXASYNC_THREADS_MAX    8
 
 typedef struct Task_t {
-        int                             active;
+        int                             active;   /* In active_tasks queue. */
+        int                             running;  /* Picked up by a worker. */
         char                            filename[128];
+        char                            key[128];  /* See texture_fullname(). */
 
         /* User may provide memory location to read image data from. */
         void                            *img_data;
@@ -26,43 +39,56 @@ typedef struct Task_t {
         TextureLoaded                   sync_cb;
         void                            *cb_data;
 
-        /* Surface is loaded into OpeGL synchronously during `runsync`. */
-        SDL_Surface                     *surf;
+        /*
+         * Upload-ready image, loaded into OpenGL synchronously during
+         * `runsync`. Size is the number of bytes its pixels take up.
+         */
+        TexImage                        image;
+        uint                            size;
         
         struct Task_t                   *prev, *next;
         UT_hash_handle                  hh;
 } Task;
 
 /*
- * Two task queues: one for pending and ongoing tasks, and the other for
- * finished tasks.
- * Also a hash where we can look up tasks by their name (filename).
+ * Two task queues: one for pending tasks, and the other for finished tasks.
+ * Tasks that a worker is currently running are in neither.
+ * Also a hash where we can look up tasks by texture name (`key`), so that
+ * filtered and unfiltered textures of the same image are separate tasks.
  */
 static Task             *active_tasks;
 static Task             *finished_tasks;
-static uint             num_finished;
+static uint             finished_bytes; /* Total size of finished surfaces. */
 static Task             *task_hash;
 
 static SDL_mutex        *storage_mutex; /* Safe access to task storage. */
 static SDL_cond         *checktask_cond;  /* Signalled when a task is inserted into queue. */
 static mem_pool         mp_tasks;       /* Memory pool for tasks. */
+static uint             num_threads;    /* Number of worker threads. */
+
+#if ENABLE_SQLITE
+static SDL_mutex        *db_mutex;      /* Workers share one DB statement. */
+#endif
 
 static void
 load(const char *filename, uint flags, void *img_data, uint img_size, uintptr_t group, TextureLoaded sync_cb, void *cb_data)
 {
         assert(sync_cb != NULL);
+        char key[128];
+        texture_fullname(filename, flags, key, sizeof(key));
         SDL_mutexP(storage_mutex);
         {
-                /* See if task for this filename already exists. */
+                /* See if task for this texture already exists. */
                 Task *task;
-                HASH_FIND_STR(task_hash, filename, task);
+                HASH_FIND_STR(task_hash, key, task);
                 if (task == NULL) {
                         task = mp_alloc(&mp_tasks);
                         
-                        /* Set task filename and add to hash. */
+                        /* Set task filename and key, add to hash. */
                         assert(*filename != '\0' && strlen(filename) < sizeof(task->filename));
                         strcpy(task->filename, filename);
-                        HASH_ADD_STR(task_hash, filename, task);
+                        strcpy(task->key, key);
+                        HASH_ADD_STR(task_hash, key, task);
                         
                         /* Set source buffer and size. */
                         task->img_data = img_data;
@@ -71,7 +97,6 @@ load(const char *filename, uint flags, void *img_data, uint img_size, uintptr_t
                         if (texture_is_loaded(filename, flags)) {
                                 /* Already loaded: add to finished_tasks. */
                                 DL_PREPEND(finished_tasks, task);
-                                num_finished++;
                         } else {
                                 /*
                                  * Insert into active list and signal task
@@ -82,7 +107,10 @@ load(const char *filename, uint flags, void *img_data, uint img_size, uintptr_t
                                 SDL_CondSignal(checktask_cond);
                         }
                 } else if (task->active) {
-                        /* Move to the front of active task queue. */
+                        /*
+                         * Still waiting for a worker: move to the front of
+                         * active task queue.
+                         */
                         DL_DELETE(active_tasks, task);
                         DL_PREPEND(active_tasks, task);
                 }
@@ -119,9 +147,9 @@ texasync_loadmem(const char *filename, uint flags, void *img_data, uint img_size
 static void
 free_task(Task *task)
 {
-        /* Free surface if it's been allocated. */
-        if (task->surf != NULL)
-                SDL_FreeSurface(task->surf);
+        /* Free image pixels if they've been allocated. */
+        if (task->image.pixels != NULL)
+                texture_image_free(&task->image);
         
         /* Free user buffer if it was given. */
         if (task->img_data != NULL)
@@ -135,7 +163,8 @@ free_task(Task *task)
 }
 
 /*
- * Clear all tasks. There may still remain one currently executing task.
+ * Clear all tasks. There may still remain one currently executing task per
+ * worker thread.
  */
 void
 texasync_clear(void)
@@ -145,11 +174,11 @@ texasync_clear(void)
                 while (finished_tasks != NULL) {
                         Task *task = finished_tasks;
                         DL_DELETE(finished_tasks, task);
-                        free_task(task);
                         
-                        /* Update finished task counter. */
-                        assert(num_finished > 0);
-                        num_finished--;
+                        /* Update finished task byte counter. */
+                        assert(finished_bytes >= task->size);
+                        finished_bytes -= task->size;
+                        free_task(task);
                 }
                 
                 while (active_tasks != NULL) {
@@ -191,7 +220,8 @@ texasync_runsync(uintptr_t group, ...)
         {
                 Task *task, *tmp;
                 DL_FOREACH_SAFE(finished_tasks, task, tmp) {
-                        assert(task->sync_cb && !task->active);
+                        assert(task->sync_cb && !task->active &&
+                               !task->running);
                         for (uint i = 0; i < num_groups; i++) {
                                 if (task->group != group_array[i])
                                         continue;
@@ -207,11 +237,12 @@ texasync_runsync(uintptr_t group, ...)
                                  */
                                 SDL_mutexV(storage_mutex);
                                 {
-                                        /* Preload texture from surface. */
-                                        if (task->surf != NULL) {
-                                                texture_preload_surface(task->filename, task->flags, task->surf);
-                                                SDL_FreeSurface(task->surf);
-                                                task->surf = NULL;
+                                        /* Preload texture from image. */
+                                        if (task->image.pixels != NULL) {
+                                                texture_preload_image(task->filename, task->flags, &task->image);
+                                                texture_image_free(&task->image);
+                                        } else {
+                                                texture_preload_failed(task->filename, task->flags);
                                         }
                                         task->sync_cb(task->filename, task->flags, task->cb_data);
                                 }
@@ -219,129 +250,196 @@ texasync_runsync(uintptr_t group, ...)
                                 
                                 /* Free task. */
                                 DL_DELETE(finished_tasks, task);
+                                assert(finished_bytes >= task->size);
+                                finished_bytes -= task->size;
                                 free_task(task);
-                                
-                                /* Update finished task counter. */
-                                assert(num_finished > 0);
-                                num_finished--;
                                 break;
                         }                        
                 }
                 
                 /*
-                 * If number of finished tasks is below maximum value, signal
-                 * async thread to check for new tasks to process.
+                 * If finished tasks are below byte budget, wake up workers to
+                 * check for new tasks to process.
                  */
-                if (num_finished < TEXASYNC_FINISHED_MAX)
-                        SDL_CondSignal(checktask_cond);
+                if (active_tasks != NULL && finished_bytes < TEXASYNC_BUDGET)
+                        SDL_CondBroadcast(checktask_cond);
         }
         SDL_mutexV(storage_mutex);
 }
 
-static int
-run_task(Task *task)
+#if ENABLE_SQLITE
+/*
+ * Copy image data out of database. Returns a buffer that caller must free with
+ * mem_free(), and stores its size in `size`.
+ */
+static void *
+read_from_db(const char *filename, uint *size)
+{
+        void *buf;
+        SDL_mutexP(db_mutex);
+        {
+                /* Prepare statement. */
+                static sqlite3_stmt *stmt;
+                if (stmt == NULL)
+                        prep_stmt(&stmt, "SELECT data FROM Image WHERE name=?1");
+                
+                /* Insert @2x into name if this is a high-res device. */
+                const char *name = filename;
+                char x2_name[128];
+                if (config.screen_width > 500)
+                        name = x2_add(name, x2_name, sizeof(x2_name));
+                
+                /* Bind name argument and run the query. */
+                log_msg("[TEXTURE-ASYNC] Load '%s' from DB.", name);
+                sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+                RCCHECK(sqlite3_step(stmt), SQLITE_ROW);
+                
+                /* Extract data. */
+                int img_size = sqlite3_column_bytes(stmt, 0);
+                const void *img_data = sqlite3_column_blob(stmt, 0);
+                assert(img_size > 0 && img_data != NULL);
+                
+                /*
+                 * Copy data so that decoding can run without holding the DB
+                 * mutex, then reset statement.
+                 */
+                buf = mem_alloc(img_size, "Async image data");
+                memcpy(buf, img_data, img_size);
+                *size = img_size;
+                RCCHECK(sqlite3_reset(stmt), SQLITE_OK);
+        }
+        SDL_mutexV(db_mutex);
+        return buf;
+}
+#endif  /* ENABLE_SQLITE */
+
+/*
+ * Decode image and convert it into a pixel buffer that can be passed to OpenGL
+ * as is. Runs on a worker thread without holding the storage mutex, so texture
+ * flags are passed in separately.
+ */
+static void
+run_task(Task *task, uint flags)
 {
-        assert(task->surf == NULL);
+        assert(task->image.pixels == NULL && task->running);
         assert(task->filename && *task->filename != '\0');
         
-        /* See if user gave us a buffer to read image data from. */
+        SDL_Surface *img = NULL;
         if (task->img_data != NULL) {
-                task->surf = IMG_Load_RW(SDL_RWFromConstMem(task->img_data, task->img_size), 0);
-                assert(task->surf != NULL);
+                /* User gave us a buffer to read image data from. */
+                img = IMG_Load_RW(SDL_RWFromConstMem(task->img_data,
+                                                     task->img_size), 1);
                 
                 /* Free user buffer. */
                 mem_free(task->img_data);
                 task->img_data = NULL;
-                return 1;
-        }
+        } else {
 #if ENABLE_SQLITE
-        /* Prepare statement. */
-        static sqlite3_stmt *stmt;
-        if (stmt == NULL)
-                prep_stmt(&stmt, "SELECT data FROM Image WHERE name=?1");
-        
-        /* Insert @2x into name if this is a high-res device. */
-        const char *name = task->filename;
-        char x2_name[128];
-        if (config.screen_width > 500)
-                name = x2_add(name, x2_name, sizeof(x2_name));
-        
-        /* Bind name argument and run the query. */
-        log_msg("[TEXTURE-ASYNC] Load '%s' from DB.", name);
-        sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
-        RCCHECK(sqlite3_step(stmt), SQLITE_ROW);
-        
-        /* Extract data. */
-        int img_size = sqlite3_column_bytes(stmt, 0);
-        const void *img_data = sqlite3_column_blob(stmt, 0);
-        assert(img_size > 0 && img_data != NULL);
-        
-        /* Load image from database blob data and reset statement. */
-        task->surf = IMG_Load_RW(SDL_RWFromConstMem(img_data, img_size), 0);
-        assert(task->surf != NULL);        
-        RCCHECK(sqlite3_reset(stmt), SQLITE_OK);
-        
-        return 1;
+                uint size;
+                void *buf = read_from_db(task->filename, &size);
+                img = IMG_Load_RW(SDL_RWFromConstMem(buf, size), 1);
+                mem_free(buf);
 #else
-        abort();
+                /* Skip decoding if image is in texture cache. */
+                if (!texcache_lookup(task->filename, &task->image))
+                        img = IMG_Load(task->filename);
 #endif
+        }
+        
+        /*
+         * Format conversion and power-of-two padding are done here too, off
+         * the main thread.
+         */
+        if (img != NULL) {
+                texture_image_init(&task->image, img);
+                SDL_FreeSurface(img);
+#if !ENABLE_SQLITE
+                if (task->img_size == 0)
+                        texcache_store(task->filename, &task->image);
+#endif
+        }
+        if (task->image.pixels == NULL) {
+                log_err("[TEXTURE-ASYNC] %s -- %s", task->filename,
+                        IMG_GetError());
+                return;
+        }
+        texture_image_convert(&task->image, flags);
+        task->size = task->image.pow_w * task->image.pow_h * task->image.bpp;
 }
 
 static int
 texasync_thread(void *data)
 {
         UNUSED(data);
+        SDL_mutexP(storage_mutex);
         for (;;) {
-                SDL_mutexP(storage_mutex);
-                {
                 /*
-                 * If queue is empty, unlock the mutex and wait until we are
-                 * signalled to check for a new task.
+                 * Wait until there is a task in queue, and finished tasks are
+                 * below budget. Since loading textures is memory-intensive, we
+                 * only keep a limited amount of decoded data around.
                  */
-                if (active_tasks == NULL || num_finished >= TEXASYNC_FINISHED_MAX)
+                while (active_tasks == NULL || finished_bytes >= TEXASYNC_BUDGET)
                         SDL_CondWait(checktask_cond, storage_mutex);
                 
+                /* Pick first task from the queue (most recently added). */
+                Task *task = active_tasks;
+                DL_DELETE(active_tasks, task);
+                assert(task && task->active && !task->running);
+                task->active = 0;
+                task->running = 1;
+                uint flags = task->flags;
+                
+                /* Unlock mutex to do blocking operation. */
+                SDL_mutexV(storage_mutex);
+                {
+                        run_task(task, flags);
+                }
+                SDL_mutexP(storage_mutex);
+                task->running = 0;
+                
                 /*
-                 * Since loading textures is memory-intensive, we only keep a
-                 * small amount of finished tasks around.
+                 * Add to finished task list if synchronous callback is set. If
+                 * not, destroy the task.
                  */
-                if (active_tasks != NULL && num_finished < TEXASYNC_FINISHED_MAX) {
-                        /*
-                         * Pick first task from the queue (most recently
-                         * added).
-                         */
-                        Task *task = active_tasks;
-                        DL_DELETE(active_tasks, task);
-                        assert(task && task->active);
-                        
-                        /* Unlock mutex to do blocking operation. */
-                        SDL_mutexV(storage_mutex);
-                        {
-                                run_task(task);
-                        }
-                        SDL_mutexP(storage_mutex);
-                        
-                        /* Change task state. */
-                        task->active = 0;
-                        
-                        /*
-                         * Add to finished task list if synchronous callback is
-                         * set. If not, destroy the task.
-                         */
-                        if (task->sync_cb != NULL) {
-                                DL_APPEND(finished_tasks, task);
-                                num_finished++;
-                        }
-                        else {
-                                free_task(task);
-                        }
-                }
+                if (task->sync_cb != NULL) {
+                        DL_APPEND(finished_tasks, task);
+                        finished_bytes += task->size;
+                } else {
+                        free_task(task);
                 }
-                SDL_mutexV(storage_mutex);
         }
         abort();
 }
 
+/*
+ * Number of loader threads: one for each core except the one that the main
+ * thread runs on.
+ */
+static uint
+thread_count(void)
+{
+#if ENABLE_SDL2
+        int cores = SDL_GetCPUCount();
+#elif defined(_SC_NPROCESSORS_ONLN)
+        int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#else
+        int cores = 2;
+#endif
+        if (cores <= 1)
+                return 1;
+        return (cores - 1 < TEXASYNC_THREADS_MAX) ? cores - 1 :
+                                                    TEXASYNC_THREADS_MAX;
+}
+
+/*
+ * Return true if loader threads have been started.
+ */
+int
+texasync_running(void)
+{
+        return (num_threads > 0);
+}
+
 void
 texasync_thread_start(void)
 {
@@ -351,10 +449,26 @@ texasync_thread_start(void)
         /* Set up queue mutex and condition variable. */
         storage_mutex = SDL_CreateMutex();
         checktask_cond = SDL_CreateCond();
+#if ENABLE_SQLITE
+        db_mutex = SDL_CreateMutex();
+#endif
+        /*
+         * Initialize image format loaders here, on the main thread: otherwise
+         * the first IMG_Load() calls would do it concurrently from the loader
+         * threads.
+         */
+        int formats = IMG_INIT_PNG | IMG_INIT_JPG;
+        if ((IMG_Init(formats) & formats) != formats)
+                log_warn("[TEXTURE-ASYNC] IMG_Init: %s", IMG_GetError());
         
+        num_threads = thread_count();
+        for (uint i = 0; i < num_threads; i++) {
 #if ENABLE_SDL2
-        SDL_CreateThread(texasync_thread, "Async Texture Loader Thread", NULL);
+                SDL_CreateThread(texasync_thread, "Async Texture Loader Thread",
+                                 NULL);
 #else
-        SDL_CreateThread(texasync_thread, NULL);
+                SDL_CreateThread(texasync_thread, NULL);
 #endif
+        }
+        log_msg("[TEXTURE-ASYNC] Started %u loader threads.", num_threads);
 }
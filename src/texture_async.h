@@ -7,6 +7,7 @@
 typedef void (*TextureLoaded)(const char *img_name, uint flags, void *cb_data);
 
 void    texasync_thread_start(void);
+int     texasync_running(void);
 void    texasync_load(const char *img_name, uint flags, uintptr_t group,
                       TextureLoaded sync_cb, void *cb_data);
 void    texasync_loadmem(const char *img_name, uint flags,
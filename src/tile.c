@@ -19,7 +19,9 @@ tile_filter(void *ptr)
 static BB
 tile_local_bb(Tile *t)
 {
-        vect_f start_pos = t->pos->_.vectf.start;
+        /* Keyframe path starts at its first key. */
+        vect_f start_pos = (t->pos->anim_type == ANIM_PATH) ?
+            t->pos->_.path.track->keys[0]._.vectf : t->pos->_.vectf.start;
         vect_f start_sz = t->size->_.vectf.start;
         if (start_sz.x < 0) {
                 start_sz.x = -start_sz.x;
@@ -35,7 +37,8 @@ tile_local_bb(Tile *t)
         
         /* See if position and/or size is animated. */
         if (t->pos->anim_type != ANIM_NONE || t->size->anim_type != ANIM_NONE) {
-                vect_f end_pos = (t->pos->anim_type != ANIM_NONE) ? t->pos->_.vectf.end : start_pos;
+                vect_f end_pos = (t->pos->anim_type != ANIM_NONE &&
+                    t->pos->anim_type != ANIM_PATH) ? t->pos->_.vectf.end : start_pos;
                 vect_f end_sz = (t->size->anim_type != ANIM_NONE) ? t->size->_.vectf.end : start_sz;
 
                 /* Union of start and final bounding boxes. */                
@@ -45,6 +48,20 @@ tile_local_bb(Tile *t)
                         .b=floorf(end_pos.y),
                         .t=ceilf(end_pos.y + end_sz.y)
                 });
+                
+                /* Path: add a box at every key position. */
+                if (t->pos->anim_type == ANIM_PATH) {
+                        const PropPath *path = t->pos->_.path.track;
+                        for (unsigned i = 1; i < path->num_keys; i++) {
+                                vect_f k = path->keys[i]._.vectf;
+                                bb_union(&bb, (BB){
+                                        .l=floorf(k.x),
+                                        .r=ceilf(k.x + end_sz.x),
+                                        .b=floorf(k.y),
+                                        .t=ceilf(k.y + end_sz.y)
+                                });
+                        }
+                }
         }
         
         /*
@@ -109,11 +126,11 @@ tile_bb_changed(Tile *t)
 Tile *
 tile_new(Body *body, vect_f pos, vect_f size, float depth, int grid_store)
 {
-        extern mem_pool mp_tile;
-        Tile *t = mp_alloc(&mp_tile);
+        Tile *t = mp_alloc(&body->world->tile_pool);
         
         assert(t && body);
         t->objtype = OBJTYPE_TILE;
+        t->handle = handle_new(t);
         t->body = body;
         t->depth = depth;
         
@@ -132,6 +149,7 @@ tile_new(Body *body, vect_f pos, vect_f size, float depth, int grid_store)
                 BB bb = tile_local_bb(t);
                 body_sweep_bb(body, &bb);
                 grid_add(&body->world->grid, &t->go, t, bb);
+                body_update_nocturnal(body);
         }
 #else
         UNUSED(grid_store);
@@ -139,15 +157,12 @@ tile_new(Body *body, vect_f pos, vect_f size, float depth, int grid_store)
         return t;
 }
 
-Tile *
-tile_clone(Body *parent, const Tile *orig)
+/*
+ * Copy tile properties from `orig`.
+ */
+static void
+tile_copy(Tile *t, const Tile *orig)
 {
-        /* Allocate and set objtype. */
-        extern mem_pool mp_tile;
-        Tile *t = mp_alloc(&mp_tile);
-        t->objtype = OBJTYPE_TILE;
-        
-        /* Copy properties. */
         t->sprite_list = orig->sprite_list;
         t->pos = prop_copy(orig->pos);
         t->size = prop_copy(orig->size);
@@ -158,36 +173,101 @@ tile_clone(Body *parent, const Tile *orig)
         if (orig->angle != NULL)
                 t->angle = prop_copy(orig->angle);
         t->depth = orig->depth;
-        t->flags = orig->flags;
+        t->flags = orig->flags & ~TILE_GRID_CLONE;
+}
+
+#if ENABLE_TILE_GRID
+/*
+ * Add tile to grid if `orig` was (or would be) stored there.
+ */
+static void
+tile_grid_add_like(Tile *t, const Tile *orig)
+{
+        if (!grid_stored(&orig->go) && !(orig->flags & TILE_GRID_CLONE))
+                return;
+        
+        BB bb = tile_local_bb(t);
+        body_sweep_bb(t->body, &bb);
+        grid_add(&t->body->world->grid, &t->go, t, bb);
+        body_update_nocturnal(t->body);
+}
+#endif
+
+Tile *
+tile_clone(Body *parent, const Tile *orig)
+{
+        /* Allocate and set objtype. */
+        Tile *t = mp_alloc(&parent->world->tile_pool);
+        t->objtype = OBJTYPE_TILE;
+        t->handle = handle_new(t);
+        
+        /* Copy properties. */
+        tile_copy(t, orig);
                 
         /* Add to parent. */
         t->body = parent;
         DL_APPEND(parent->tiles, t);
         
 #if ENABLE_TILE_GRID
-        /* Add to grid if original was stored there. */
-        if (orig->go.flags & GRIDFLAG_STORED) {
-                BB bb = tile_local_bb(t);
-                body_sweep_bb(parent, &bb);
-                grid_add(&parent->world->grid, &t->go, t, bb);
-        }
+        tile_grid_add_like(t, orig);
 #endif
         return t;
 }
 
+/*
+ * Turn a tile of a recycled body back into a copy of `orig` (see
+ * body_reuse()). Tile must not be in the grid.
+ */
+void
+tile_reset(Tile *t, const Tile *orig)
+{
+        assert(!grid_stored(&t->go));
+        
+        /* Drop old properties (and any animation along with them). */
+        prop_free(t->pos);
+        prop_free(t->size);
+        if (t->frame != NULL)
+                prop_free(t->frame);
+        if (t->color != NULL)
+                prop_free(t->color);
+        if (t->angle != NULL)
+                prop_free(t->angle);
+        t->frame = t->color = t->angle = NULL;
+        
+        tile_copy(t, orig);
+#if ENABLE_TILE_GRID
+        tile_grid_add_like(t, orig);
+#endif
+}
+
 void
 tile_free(Tile *t)
 {
         assert(t && t->body);
         
         /* Remove from quad tree if it's in there. */
-        if (grid_stored(&t->go))
+        int was_stored = grid_stored(&t->go);
+        if (was_stored)
                 grid_remove(&t->body->world->grid, &t->go);
         
         /* Remove from body's tile list. */
         assert((t->prev != NULL || t->next != NULL) && t->body->tiles);
         DL_DELETE(t->body->tiles, t);
+        if (was_stored)
+                body_update_nocturnal(t->body);
         
+        World *world = t->body->world;
+        tile_release(t);
+        mp_free(&world->tile_pool, t);
+}
+
+/*
+ * Free what tile owns outside of its world's memory pools: properties, trace,
+ * and handle. Used directly when a whole world is destroyed.
+ */
+void
+tile_release(Tile *t)
+{
         /* Free properties. */
         prop_free(t->pos);
         prop_free(t->size);
@@ -221,8 +301,8 @@ tile_free(Tile *t)
                 mp_free(&mp_tiletrace, trace);
         }
 #endif
-        extern mem_pool mp_tile;
-        mp_free(&mp_tile, t);
+        handle_free(t->handle);
+        t->objtype = 0;
 }
 
 #if TRACE_MAX
@@ -359,6 +439,11 @@ tile_color(Tile *t)
         GET_TIME(t, anim, now, delta, duration);
         
         uint32_t val;
+        if (anim->anim_type == ANIM_PATH) {
+                if (path_color(anim, delta, &val))
+                        tile_set_color(t, val);
+                return val;
+        }
         if (interp_color(anim->anim_type, start, end, duration, delta, &val))
                 tile_set_color(t, val);
         return val;
@@ -401,6 +486,14 @@ tile_angle(Tile *t)
         float now, delta, duration;
         GET_TIME(t, anim, now, delta, duration);
         
+        /* Keyframe path. */
+        if (anim->anim_type == ANIM_PATH) {
+                float val;
+                if (path_angle(anim, delta, &val))
+                        tile_set_angle(t, anim->_.path.pivot, val);
+                return val;
+        }
+        
         /* If animation has not started yet, return start value. */
         if (delta <= 0.0)
                 return start;
@@ -579,6 +672,14 @@ tile_pos(Tile *t)
         float now, delta, duration;
         GET_TIME(t, anim, now, delta, duration);
         
+        /* Keyframe path. */
+        if (anim->anim_type == ANIM_PATH) {
+                vect_f val;
+                if (path_vectf(anim, delta, &val))
+                        tile_set_pos(t, val);
+                return val;
+        }
+        
         /* If animation has not started yet, return start value. */
         if (delta <= 0.0)
                 return start;
@@ -767,3 +868,44 @@ tile_anim_size(Tile *t, uint8_t type, vect_f end, float duration,
         SET_ANIM(t, size, vectf, type, start_value, end, start_time, duration);
         tile_bb_changed(t);
 }
+
+/*
+ * Create a property that animates along keyframe `path` (takes ownership).
+ */
+static Property *
+path_prop_new(Tile *t, PropPath *path, float start_time)
+{
+        assert(path->num_keys >= 2 && path->keys[path->num_keys - 1].time > 0);
+        Property *anim = prop_new();
+        anim->anim_type = ANIM_PATH;
+        anim->start_time = start_time + t->body->step * t->body->world->step_sec;
+        anim->duration = path->keys[path->num_keys - 1].time;
+        anim->_.path.track = path;
+        return anim;
+}
+
+void
+tile_path_pos(Tile *t, PropPath *path, float start_time)
+{
+        prop_free(t->pos);
+        t->pos = path_prop_new(t, path, start_time);
+        tile_bb_changed(t);
+}
+
+void
+tile_path_color(Tile *t, PropPath *path, float start_time)
+{
+        if (t->color != NULL)
+                prop_free(t->color);
+        t->color = path_prop_new(t, path, start_time);
+}
+
+void
+tile_path_angle(Tile *t, PropPath *path, vect_f pivot, float start_time)
+{
+        if (t->angle != NULL)
+                prop_free(t->angle);
+        t->angle = path_prop_new(t, path, start_time);
+        t->angle->_.path.pivot = pivot;
+        tile_bb_changed(t);
+}
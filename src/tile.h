@@ -6,6 +6,7 @@
 #include "geometry.h"
 #include "property.h"
 #include "grid.h"
+#include "handle.h"
 #include "spritelist.h"
 
 #define BLEND_SHIFT     0
@@ -17,6 +18,8 @@
  * TILE_FLIP_Y          Vertical flip.
  * TILE_SMOOTH          Do not round position and size.
  * TILE_VISITED         For traversal functions.
+ * TILE_GRID_CLONE      Tile was taken out of the grid by body_detach(); its
+ *                      clones are put back into the grid.
  */
 enum {
         TILE_BLEND       = 7<<BLEND_SHIFT,
@@ -25,7 +28,8 @@ enum {
 #if !ALL_SMOOTH
         TILE_SMOOTH      = 1<<5,
 #endif
-        TILE_VISITED     = 1<<6
+        TILE_VISITED     = 1<<6,
+        TILE_GRID_CLONE  = 1<<7
 };
 
 /* Available blend functions (number stored within flags). */
@@ -57,6 +61,7 @@ typedef struct {
  */
 typedef struct Tile_t {
         int             objtype;                /* = OBJTYPE_TILE */
+        Handle          handle;                 /* Given out to scripts. */
         Body            *body;                  /* Body object = owner. */
         
         SpriteList      *sprite_list;           /* Graphic. */
@@ -81,7 +86,9 @@ int      tile_filter(void *ptr);
 
 Tile    *tile_new(Body *, vect_f pos, vect_f size, float depth, int grid_store);
 Tile    *tile_clone(Body *parent, const Tile *orig);
+void     tile_reset(Tile *t, const Tile *orig);
 void     tile_free(Tile *);
+void     tile_release(Tile *);
 void     tile_record_trace(Tile *, unsigned trace_index);
 
 #if ENABLE_TILE_GRID
@@ -116,4 +123,10 @@ void     tile_anim_color(Tile *t, uint8_t type, uint32_t end, float duration,
 void     tile_anim_angle(Tile *t, uint8_t type, vect_f pivot, float end,
                          float duration, float start_time);
 
+/* Animate tile properties along keyframe paths. */
+void     tile_path_pos(Tile *t, PropPath *path, float start_time);
+void     tile_path_color(Tile *t, PropPath *path, float start_time);
+void     tile_path_angle(Tile *t, PropPath *path, vect_f pivot,
+                         float start_time);
+
 #endif
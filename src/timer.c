@@ -6,19 +6,19 @@
 #include "mem.h"
 #include "timer.h"
 
+/*
+ * Allocate timer from memory pool `mp` (see World).
+ */
 Timer *
-timer_new(void *owner, unsigned now, unsigned sched, int type, intptr_t func,
-          intptr_t data)
+timer_new(mem_pool *mp, void *owner, unsigned now, unsigned sched, int type,
+          intptr_t func, intptr_t data)
 {
         assert(owner && func && sched >= now);
-        assert(type == OBJTYPE_TIMER_C || type == OBJTYPE_TIMER_LUA);
-        
-        /* Timer IDs keep increasing; zero is not a valid ID. */
-        static unsigned timer_id_gen;
+        assert(type == OBJTYPE_TIMER_C || type == OBJTYPE_TIMER_LUA ||
+               type == OBJTYPE_TIMER_TASK);
         
         /* Allocate. */
-        extern mem_pool mp_timer;
-        Timer *timer = mp_alloc(&mp_timer);
+        Timer *timer = mp_alloc(mp);
         
         /* Initialize. */
         timer->objtype = type;
@@ -28,15 +28,13 @@ timer_new(void *owner, unsigned now, unsigned sched, int type, intptr_t func,
         timer->created = now;
         timer->scheduled = sched;
         timer->canceled = UINT_MAX;
-        
-        /* Timer ID wrap-around check. */
-        timer->timer_id = ++timer_id_gen ? timer_id_gen : ++timer_id_gen;
+        timer->handle = handle_new(timer);
         
         return timer;
 }
 
 void
-timer_free(Timer *timer, int clear_state)
+timer_free(mem_pool *mp, Timer *timer, int clear_state)
 {
         /*
          * Execute destructor if set (used for clearing associated script
@@ -46,6 +44,6 @@ timer_free(Timer *timer, int clear_state)
                 timer->clearfunc(timer);
         }
 
-        extern mem_pool mp_timer;
-        mp_free(&mp_timer, timer);
+        handle_free(timer->handle);
+        mp_free(mp, timer);
 }
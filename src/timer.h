@@ -2,6 +2,8 @@
 #define GAME2D_TIMER_H
 
 #include "common.h"
+#include "handle.h"
+#include "mem.h"
 
 struct Timer_t;
 
@@ -12,17 +14,16 @@ typedef void (*TimerClear)(struct Timer_t *t);
 /*
  * Timer structure holds a task that has been scheduled to run at a later time.
  *
- * objtype      OBJTYPE_TIMER_LUA or OBJTYPE_TIMER_C, depending on what the
- *              "func" member designates.
+ * objtype      OBJTYPE_TIMER_LUA, OBJTYPE_TIMER_C, or OBJTYPE_TIMER_TASK,
+ *              depending on what the "func" member designates. Task timers
+ *              resume a Lua coroutine and are rescheduled whenever it yields.
  * owner        Object that owns the timer.
- * timer_id     User scripts may hold on to Timer pointers so that they would be
- *              able to cancel the timer. If a timer has already been executed,
- *              then its memory might be reused by another timer. Thus blindly
- *              cancelling it would be a mistake. timer_id gives us the ability
- *              to tell if user is referencing the correct timer.
- *              Zero is a valid timer_id value.
+ * handle       Given out to scripts so that they would be able to cancel the
+ *              timer. Once the timer has been executed or cancelled (or its
+ *              world destroyed) the handle goes stale, even if timer memory
+ *              has been reused or released since.
  * func         TimerFunction pointer or index into eapi.__idToObjectMap for Lua
- *              functions.
+ *              functions (coroutines for task timers).
  * data         User callback data.
  * created      Step number when timer was created.
  * scheduled    Step number when timer must be executed.
@@ -33,7 +34,7 @@ typedef struct Timer_t {
         int             objtype;
         
         void            *owner;
-        unsigned        timer_id;
+        Handle          handle;
         intptr_t        func;
         intptr_t        data;
         
@@ -47,18 +48,16 @@ typedef struct Timer_t {
 } Timer;
 
 /*
- * Structure that is returned to user scripts. In addition to a Timer pointer,
- * it also holds the timer_id which lets us know if user is referencing the
- * correct Timer.
+ * Structure that is returned to user scripts. It holds the timer handle rather
+ * than a Timer pointer, so that it can be safely used after the timer is gone.
  */
 typedef struct {
         int       objtype;
-        Timer     *ptr;
-        unsigned  timer_id;
+        Handle    handle;
 } TimerPtr;
 
-Timer   *timer_new(void *owner, unsigned now, unsigned sched, int type,
-                   intptr_t func, intptr_t data);
-void     timer_free(Timer *timer, int clear_state);
+Timer   *timer_new(mem_pool *mp, void *owner, unsigned now, unsigned sched,
+                   int type, intptr_t func, intptr_t data);
+void     timer_free(mem_pool *mp, Timer *timer, int clear_state);
 
 #endif /* GAME2D_TIMER_H */
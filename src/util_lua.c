@@ -11,6 +11,7 @@
 #include "geometry.h"
 #include "config.h"
 #include "spritelist.h"
+#include "tile.h"
 #include "utstring.h"
 #include "assert_lua.h"
 
@@ -18,6 +19,63 @@
  * Lua utility routines.
  */
 
+/*
+ * Callbacks are referenced from the engine by integer IDs: keys into the
+ * eapi.idToObjectMap table (see eapi.lua). The table is kept on the stack at
+ * `idmap_index`, so functions and their saved arguments are fetched directly
+ * with lua_rawgeti() instead of going through a Lua-side dispatcher.
+ */
+void
+L_callback_push(lua_State *L, intptr_t func_id)
+{
+        extern int idmap_index;
+        lua_rawgeti(L, idmap_index, func_id);                   /* + func */
+        assert(lua_isfunction(L, -1));
+}
+
+/*
+ * Call the function pushed by L_callback_push() with `num_args` arguments that
+ * follow it on the stack. User arguments saved under `arg_id` (zero if there
+ * are none) are appended to these. If `remove` is true, function and user
+ * arguments are removed from eapi.idToObjectMap (one-shot callbacks).
+ */
+void
+L_callback_call(lua_State *L, intptr_t func_id, intptr_t arg_id, int remove,
+                int num_args, int num_ret)
+{
+        extern int idmap_index, errfunc_index;
+        
+        if (arg_id != 0) {
+                lua_rawgeti(L, idmap_index, arg_id);            /* + args */
+                int args_index = lua_gettop(L);
+                assert(lua_istable(L, args_index));
+                
+                /* Unpack saved arguments up to the first nil (like ipairs). */
+                for (int i = 1;; i++) {
+                        luaL_checkstack(L, 1, "Too many callback arguments.");
+                        lua_rawgeti(L, args_index, i);
+                        if (lua_isnil(L, -1)) {
+                                lua_pop(L, 1);
+                                break;
+                        }
+                        num_args++;
+                }
+                lua_remove(L, args_index);                      /* - args */
+        }
+        
+        if (remove) {
+                lua_pushnil(L);
+                lua_rawseti(L, idmap_index, func_id);
+                if (arg_id != 0) {
+                        lua_pushnil(L);
+                        lua_rawseti(L, idmap_index, arg_id);
+                }
+        }
+        
+        if (lua_pcall(L, num_args, num_ret, errfunc_index))
+                fatal_error("[Lua] %s", lua_tostring(L, -1));
+}
+
 /*
  * Print Lua stack (for debugging purposes).
  */
@@ -67,13 +125,25 @@ L_arg_cstr(lua_State *L, int index)
         return lua_tostring(L, index);
 }
 
+/*
+ * Get userdata argument. Object handles (see L_push_object()) are resolved to
+ * the objects they refer to; a stale handle is an error even in release
+ * builds.
+ */
 void *
 L_arg_userdata(lua_State *L, int index)
 {
         info_assert_va(L, lua_islightuserdata(L, index),
                        "Argument %d: expected userdata, got `%s`.",
                        index, lua_typename(L, lua_type(L, index)));
-        return lua_touserdata(L, index);
+        void *ptr = lua_touserdata(L, index);
+        if (!handle_is(ptr))
+                return ptr;
+        
+        void *obj = handle_get((Handle)ptr);
+        if (obj == NULL)
+                luaL_error(L, "Argument %d: object no longer exists.", index);
+        return obj;
 }
 
 int
@@ -393,6 +463,36 @@ L_push_vectf(lua_State *L, vect_f v)
         lua_rawset(L, -3);
 }
 
+/*
+ * Return vector from a Lua C function. Vector API functions are registered
+ * twice (see EAPI_SET_VECTFUNC in eapi_Lua.c): the plain version returns an
+ * {x=?, y=?} table, while the "XY" version (upvalue 1 is true) returns x and y
+ * as two numbers and creates no garbage. If `out` is the stack index of a table
+ * (see L_arg_out()), the plain version stores x and y in it and returns it
+ * instead of creating a new table.
+ */
+int
+L_return_vectf(lua_State *L, vect_f v, int out)
+{
+        if (lua_toboolean(L, lua_upvalueindex(1))) {
+                lua_pushnumber(L, v.x);
+                lua_pushnumber(L, v.y);
+                return 2;
+        }
+        if (out == 0) {
+                L_push_vectf(L, v);
+                return 1;
+        }
+        lua_pushvalue(L, out);          /* ... out */
+        lua_pushstring(L, "x");
+        lua_pushnumber(L, v.x);
+        lua_rawset(L, -3);
+        lua_pushstring(L, "y");
+        lua_pushnumber(L, v.y);
+        lua_rawset(L, -3);
+        return 1;
+}
+
 void
 L_push_vecti(lua_State *L, vect_i v)
 {
@@ -428,6 +528,30 @@ L_push_BB(lua_State *L, BB bb)
         lua_rawset(L, -3);
 }
 
+/*
+ * Push game object pointer. Bodies, tiles, and shapes are pushed as their
+ * handles (see handle.h), other objects as they are.
+ */
+void
+L_push_object(lua_State *L, void *obj)
+{
+        Handle h = 0;
+        if (obj != NULL) {
+                switch (*(int *)obj) {
+                case OBJTYPE_BODY:
+                        h = ((Body *)obj)->handle;
+                        break;
+                case OBJTYPE_TILE:
+                        h = ((Tile *)obj)->handle;
+                        break;
+                case OBJTYPE_SHAPE:
+                        h = ((Shape *)obj)->handle;
+                        break;
+                }
+        }
+        lua_pushlightuserdata(L, h ? (void *)h : obj);
+}
+
 void
 L_push_color(lua_State *L, uint32_t color)
 {
@@ -75,12 +75,26 @@ vect_i          *L_argptr_vecti(lua_State *L, int index, vect_i *store);
 vect_f          *L_argptr_vectf(lua_State *L, int index, vect_f *store);
 BB              *L_argptr_BB(lua_State *L, int index, BB *store);
 
+/* Return a vector from vector API functions (see L_return_vectf()). */
+#define          L_arg_out(L, index) (lua_istable((L), (index)) ? (index) : 0)
+int              L_return_vectf(lua_State *L, vect_f v, int out);
+
 /* Push values onto stack. */
 void             L_push_vecti(lua_State *L, vect_i v);
 void             L_push_vectf(lua_State *L, vect_f v);
 void             L_push_BB(lua_State *L, BB bb);
 void             L_push_boolpair(lua_State *L, int first, int second);
 void             L_push_color(lua_State *L, uint32_t color);
+void             L_push_object(lua_State *L, void *obj);
+
+/*
+ * Call Lua callbacks registered through eapi.lua. Push the function with
+ * L_callback_push(), then the engine-supplied arguments, then invoke
+ * L_callback_call(), which appends saved user arguments and calls the function.
+ */
+void             L_callback_push(lua_State *L, intptr_t func_id);
+void             L_callback_call(lua_State *L, intptr_t func_id, intptr_t arg_id,
+                                 int remove, int num_args, int num_ret);
 
 /* Get complex values from stack. */
 uint32_t         L_getstk_color(lua_State *L, int index);
@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <math.h>
 #include "log.h"
+#include "mem.h"
 #include "camera.h"
 #include "config.h"
 #include "shape.h"
@@ -66,24 +67,18 @@ invoke_collision_handler(Handler *handler, Shape *A, Shape *B, int new,
                 return cf(A, B, new, resolve, handler->data);
         }
 #if ENABLE_LUA
-        extern int callfunc_index;
-        lua_pushvalue(L, callfunc_index);
-        assert(lua_isfunction(L, -1));          /* ... callfunc */
-        
         assert(handler->type == HANDLER_LUA);
-        lua_pushinteger(L, handler->func);      /* ... callfunc func_id */
-        lua_pushinteger(L, handler->data);      /* + arg_id */
-        lua_pushboolean(L, 0);                  /* + false */                
+        L_callback_push(L, handler->func);      /* + func */
         
         /* Push shape or `nil` if it was destroyed. */
         if (A != NULL)
-                lua_pushlightuserdata(L, A);
+                L_push_object(L, A);
         else
                 lua_pushnil(L);
                 
         /* Push shape or `nil` if it was destroyed. */
         if (B != NULL)
-                lua_pushlightuserdata(L, B);
+                L_push_object(L, B);
         else
                 lua_pushnil(L);
         
@@ -97,9 +92,7 @@ invoke_collision_handler(Handler *handler, Shape *A, Shape *B, int new,
         lua_pushboolean(L, new);
         
         /* Call Lua function. */
-        extern int errfunc_index;
-        if (lua_pcall(L, 7, 1, errfunc_index))
-                fatal_error("[Lua] %s", lua_tostring(L, -1));
+        L_callback_call(L, handler->func, handler->data, 0, 4, 1);
                 
         /* Get user return value. */
         int ignore = lua_toboolean(L, -1);
@@ -159,8 +152,8 @@ add_potential_collisions(Shape *s, Collision *collision_array,
                         col->handler = *handler;
                         col->shape_A = s;
                         col->shape_B = other_s;
-                        col->group_A = s->group;
-                        col->group_B = other_s->group;
+                        col->handle_A = s->handle;
+                        col->handle_B = other_s->handle;
                 }
         }
 }
@@ -205,7 +198,8 @@ resolve_collisions(World *world, Shape *active_shapes[], unsigned num_shapes,
         Collision collision_array[1000];
         for (unsigned i = 0; i < num_shapes; i++) {
                 Shape *s = active_shapes[i];
-                if (s->body == NULL || s->body->world != world)
+                if (s->objtype != OBJTYPE_SHAPE || s->body == NULL ||
+                    s->body->world != world)
                         continue;       /* Shape was Destroy()ed. */
                 add_potential_collisions(s, collision_array,
                                          ARRAYSZ(collision_array),
@@ -225,19 +219,12 @@ resolve_collisions(World *world, Shape *active_shapes[], unsigned num_shapes,
                 Shape *shape_A = col->shape_A;
                 Shape *shape_B = col->shape_B;
                 
-                /* 
-                 * It is possible (if unlikely) that a shape was destroyed, and
-                 * then some other shape reused its memory. Here we make sure
-                 * that the shape that's currently there belongs to this world
-                 * and collision group is the same as before. So even if it is
-                 * a different shape, at least it's kind of like the old one.
+                /*
+                 * Skip if either shape was destroyed by an earlier handler
+                 * (its memory may have been reused by another shape since).
                  */
-                if (shape_A->body == NULL ||
-                    shape_B->body == NULL ||
-                    shape_A->body->world != world ||
-                    shape_B->body->world != world ||
-                    shape_A->group != col->group_A ||
-                    shape_B->group != col->group_B)
+                if (handle_get(col->handle_A) != shape_A ||
+                    handle_get(col->handle_B) != shape_B)
                         continue;
                 
                 /* Compute resolution box. */
@@ -261,8 +248,7 @@ resolve_collisions(World *world, Shape *active_shapes[], unsigned num_shapes,
                         new = 1;
                         
                         /* Allocate and setup collision struct. */
-                        extern mem_pool mp_collision;
-                        past_col = mp_alloc(&mp_collision);
+                        past_col = mp_alloc_raw(&world->collision_pool);
                         *past_col = *col;
                         past_col->ignore = 0;
                         
@@ -294,15 +280,16 @@ resolve_collisions(World *world, Shape *active_shapes[], unsigned num_shapes,
                 Shape *shape_A = col->shape_A;
                 Shape *shape_B = col->shape_B;
                 
-                /* If shape A (or B) was destroyed, set its pointer to NULL. */
-                if (shape_A->body == NULL ||
-                    shape_A->body->world != world ||
-                    shape_A->group != col->group_A) {
+                /*
+                 * If shape A (or B) was destroyed or recycled (no longer in
+                 * the grid), set its pointer to NULL.
+                 */
+                if (handle_get(col->handle_A) != shape_A ||
+                    !grid_stored(&shape_A->go)) {
                         shape_A = NULL;
                 }
-                if (shape_B->body == NULL ||
-                    shape_B->body->world != world ||
-                    shape_B->group != col->group_B) {
+                if (handle_get(col->handle_B) != shape_B ||
+                    !grid_stored(&shape_B->go)) {
                         shape_B = NULL;
                 }
                 
@@ -313,12 +300,23 @@ resolve_collisions(World *world, Shape *active_shapes[], unsigned num_shapes,
                 }
                 
                 /* Destroy collision. */
-                extern mem_pool mp_collision;
                 HASH_DEL(world->collisions, col);
-                mp_free(&mp_collision, col);
+                mp_free(&world->collision_pool, col);
         }
 }
 
+/*
+ * Initial size of a world memory pool: the size from config.lua, unless the
+ * world asked for fewer records (see world_new()).
+ */
+static unsigned
+pool_size(unsigned hint, int configured)
+{
+        assert(configured > 0);
+        return (hint != 0 && hint < (unsigned)configured) ? hint :
+            (unsigned)configured;
+}
+
 /*
  * Create a new world and return its pointer.
  *
@@ -326,10 +324,13 @@ resolve_collisions(World *world, Shape *active_shapes[], unsigned num_shapes,
  * step_ms              World step duration in milliseconds.
  * grid_area            Space partitioning grid area.
  * cell_size            Size of each rectangular grid cell.
+ * pool_hint            If nonzero, world's memory pools start out with at most
+ *                      this many records instead of the sizes set in
+ *                      config.lua. Pools grow on demand either way.
  */
 World *
 world_new(const char *name, unsigned step_ms, BB grid_area, unsigned cell_size,
-          unsigned trace_skip)
+          unsigned trace_skip, unsigned pool_hint)
 {
         log_msg("Create world '%s'", name);
 
@@ -347,10 +348,25 @@ world_new(const char *name, unsigned step_ms, BB grid_area, unsigned cell_size,
         world->step_ms = step_ms;
         world->step_sec = (float)step_ms / 1000.0;
         world->trace_skip = trace_skip;
+        world->allow_sleep = !ALL_NOCTURNAL;
+        world->bb_stamp = 1;
         
         extern uint64_t game_time;
         world->next_step_time = game_time;
         
+        /* Set up memory pools. */
+        struct poolsize_t *ps = &config.poolsize;
+        mem_pool_init(&world->body_pool, sizeof(Body),
+                      pool_size(pool_hint, ps->body), "Body");
+        mem_pool_init(&world->tile_pool, sizeof(Tile),
+                      pool_size(pool_hint, ps->tile), "Tile");
+        mem_pool_init(&world->shape_pool, sizeof(Shape),
+                      pool_size(pool_hint, ps->shape), "Shape");
+        mem_pool_init(&world->timer_pool, sizeof(Timer),
+                      pool_size(pool_hint, ps->timer), "Timer");
+        mem_pool_init(&world->collision_pool, sizeof(Collision),
+                      pool_size(pool_hint, ps->collision), "Collision");
+        
         /* Set up space partitioning. */
         grid_init(&world->grid, grid_area, cell_size);
         
@@ -370,11 +386,60 @@ world_free(World *world)
         /* World must be already cleared. */
         assert(world->killme);
         
+        /* Step arrays outlive world_kill() (see there). */
+        if (world->step_bodies != NULL)
+                mem_free(world->step_bodies);
+        if (world->step_shapes != NULL)
+                mem_free(world->step_shapes);
+        
+        /* Drop everything that was allocated within the world. */
+        mem_pool_free(&world->body_pool);
+        mem_pool_free(&world->tile_pool);
+        mem_pool_free(&world->shape_pool);
+        mem_pool_free(&world->timer_pool);
+        mem_pool_free(&world->collision_pool);
+        
         /* Free memory. */
         extern mem_pool mp_world;
         mp_free(&mp_world, world);
 }
 
+/*
+ * Release whatever the objects of a dying world own outside of the world's
+ * memory pools. Objects are visited straight from the pools, in no particular
+ * order; there is no need to unlink them from lists or the grid, since all of
+ * that memory goes away at once in world_free(). Until then, released objects
+ * read as destroyed (objtype is zero).
+ */
+static void
+release_objects(World *world)
+{
+        /* Release script references held by timers. */
+        for (Timer *t = mp_first(&world->timer_pool); t; t = mp_next(t)) {
+                if (t->clearfunc != NULL)
+                        t->clearfunc(t);
+                handle_free(t->handle);
+                t->objtype = 0;
+        }
+        for (Tile *t = mp_first(&world->tile_pool); t; t = mp_next(t))
+                tile_release(t);
+        for (Shape *s = mp_first(&world->shape_pool); s; s = mp_next(s))
+                shape_release(s);
+        for (Body *b = mp_first(&world->body_pool); b; b = mp_next(b))
+                body_release(b);
+        
+        /* Static body is part of the world struct. */
+        Body *sb = &world->static_body;
+        body_release(sb);
+        sb->children = NULL;
+        sb->tiles = NULL;
+        sb->shapes = NULL;
+        sb->timer_list = NULL;
+        
+        world->nocturnal = world->transient = NULL;
+        world->num_active_bodies = world->num_active_shapes = 0;
+}
+
 /*
  * Destroy everything owned by world.
  */
@@ -386,10 +451,10 @@ world_kill(World *world)
         if (config.grid_info)
                 grid_info(&world->grid, world->name);
 #endif
-        /* Destroy static body (and all other bodies along with it). */
-        body_destroy(&world->static_body);
-        
-        /* Clear out any cameras that are "filming" this world. */
+        /*
+         * Clear out any cameras that are "filming" this world. Their bodies
+         * are freed the usual way, before the rest is released in bulk.
+         */
         extern Camera *cam_list;
         Camera *cam, *cam_tmp;
         DL_FOREACH_SAFE(cam_list, cam, cam_tmp) {
@@ -401,6 +466,9 @@ world_kill(World *world)
                 cam_free(cam);
         }
         
+        /* Release bodies, tiles, shapes, and timers. */
+        release_objects(world);
+        
         /* Clear group hash. */
         Group *group;
         extern mem_pool mp_group;
@@ -414,18 +482,37 @@ world_kill(World *world)
         /* Clear collision handler map. */
         memset(world->handler_map, 0, sizeof(world->handler_map));
         
-        /* Destroy any remaining collisions. */
-        Collision *col;
-        extern mem_pool mp_collision;
-        while (world->collisions) {
-                col = world->collisions;
-                HASH_DEL(world->collisions, col);
-                mp_free(&mp_collision, col);
-        }
+        /* Forget remaining collisions (their memory goes with the world). */
+        HASH_CLEAR(hh, world->collisions);
         
-        /* Destroy world grid. */
+        /* Destroy world grid (this frees its cells as well). */
         grid_destroy(&world->grid);
         
+        /*
+         * Free activity arrays (bodies and shapes are all gone by now). Step
+         * arrays are left to world_free(): world_step() may still be going
+         * through them if a script killed the world mid-step.
+         */
+        assert(world->num_active_bodies == 0 && world->num_active_shapes == 0);
+        if (world->active_bodies != NULL)
+                mem_free(world->active_bodies);
+        if (world->active_shapes != NULL)
+                mem_free(world->active_shapes);
+        world->active_bodies = NULL;
+        world->active_shapes = NULL;
+        world->max_active_bodies = 0;
+        world->max_active_shapes = 0;
+        
+        /* Turn culling off (transient list is empty by now). */
+        assert(world->transient == NULL);
+        if (world->culled != NULL)
+                mem_free(world->culled);
+        world->culled = NULL;
+        world->max_culled = 0;
+        world->bounds_on = 0;
+        world->bounds_cam = NULL;
+        world->bounds_func = world->bounds_cb_data = 0;
+        
         /* Mark world as ready for being freed. */
         world->killme = 1;
 }
@@ -441,7 +528,10 @@ run_timers(World *world, Body *active_bodies[], unsigned num_active,
         /* Invoke timers for active bodies. */
         Body *b;
         for (unsigned i = 0; i < num_active; i++) {
-                if ((b = active_bodies[i])->world != world)
+                if (world->killme)
+                        return;         /* World destroyed by a timer. */
+                b = active_bodies[i];
+                if (b->objtype != OBJTYPE_BODY || b->world != world)
                         continue;       /* Body was Destroy()ed. */
                 if (body_active(b))
                         body_run_timers(b, L);
@@ -450,6 +540,8 @@ run_timers(World *world, Body *active_bodies[], unsigned num_active,
         /* Run camera timers. */
         extern Camera *cam_list;
         for (Camera *cam = cam_list; cam != NULL; cam = cam->next) {
+                if (world->killme)
+                        return;
                 if (cam->body.world != world || cam->disabled)
                         continue;
                 if (body_active(&cam->body))
@@ -468,7 +560,10 @@ step_bodies(World *world, Body *active_bodies[], unsigned num_active,
         /* Step active bodies. */
         Body *b;
         for (unsigned i = 0; i < num_active; i++) {
-                if ((b = active_bodies[i])->world != world)
+                if (world->killme)
+                        return;         /* World destroyed by a script. */
+                b = active_bodies[i];
+                if (b->objtype != OBJTYPE_BODY || b->world != world)
                         continue;       /* Body was Destroy()ed. */
                 if (body_active(b))
                         step_func(b, L, b);
@@ -477,6 +572,8 @@ step_bodies(World *world, Body *active_bodies[], unsigned num_active,
         /* Step camera bodies. */
         extern Camera *cam_list;
         for (Camera *cam = cam_list; cam != NULL; cam = cam->next) {
+                if (world->killme)
+                        return;
                 if (cam->body.world != world || cam->disabled)
                         continue;
                 if (body_active(&cam->body))
@@ -484,35 +581,186 @@ step_bodies(World *world, Body *active_bodies[], unsigned num_active,
         }
 }
 
-unsigned        g_num_active_bodies;
-Body            **g_active_bodies;
+/*
+ * Make sure `array` can hold at least `need` elements.
+ */
+#define ARRAY_RESERVE(array, max, need, descr)                                 \
+do {                                                                           \
+        if ((need) > (max)) {                                                  \
+                unsigned newmax_ = (max) ? (max) * 2 : 256;                    \
+                while (newmax_ < (need))                                       \
+                        newmax_ *= 2;                                          \
+                void *ptr_ = (array);                                          \
+                mem_realloc(&ptr_, newmax_ * sizeof(*(array)), (descr));       \
+                (array) = ptr_;                                                \
+                (max) = newmax_;                                               \
+        }                                                                      \
+} while (0)
+
+/*
+ * Add object to dense array and remember its index (plus one) in object's
+ * `active_index` member.
+ */
+#define ARRAY_ADD(array, num, max, obj, descr)                                 \
+do {                                                                           \
+        assert((obj)->active_index == 0);                                      \
+        ARRAY_RESERVE(array, max, (num) + 1, descr);                           \
+        (array)[(num)++] = (obj);                                              \
+        (obj)->active_index = (num);                                           \
+} while (0)
+
+/*
+ * Remove object from dense array by moving the last element into its place.
+ */
+#define ARRAY_REMOVE(array, num, obj)                                          \
+do {                                                                           \
+        unsigned i_ = (obj)->active_index - 1;                                 \
+        assert(i_ < (num) && (array)[i_] == (obj));                            \
+        (array)[i_] = (array)[--(num)];                                        \
+        (array)[i_]->active_index = i_ + 1;                                    \
+        (obj)->active_index = 0;                                               \
+} while (0)
+
+/*
+ * Update active body array membership after body was created, paused or
+ * resumed. Body shapes are updated as well.
+ */
+void
+world_body_changed(Body *b)
+{
+        World *world = b->world;
+        int want = (b->parent != NULL && body_active(b));
+        if (want && !b->active_index) {
+                ARRAY_ADD(world->active_bodies, world->num_active_bodies,
+                          world->max_active_bodies, b, "Active bodies");
+        } else if (!want && b->active_index) {
+                ARRAY_REMOVE(world->active_bodies, world->num_active_bodies, b);
+        }
+        
+        Shape *s;
+        DL_FOREACH(b->shapes, s) {
+                world_shape_changed(s);
+        }
+}
+
+/*
+ * Remove body from active array (body is being destroyed).
+ */
+void
+world_body_removed(Body *b)
+{
+        if (b->active_index)
+                ARRAY_REMOVE(b->world->active_bodies,
+                             b->world->num_active_bodies, b);
+}
+
+/*
+ * Update active shape array membership after shape was created, its body paused
+ * or resumed, or its group's collision handlers changed.
+ */
+void
+world_shape_changed(Shape *s)
+{
+        World *world = s->body->world;
+        int want = (body_active(s->body) && s->group->num_handlers > 0);
+        if (want && !s->active_index) {
+                ARRAY_ADD(world->active_shapes, world->num_active_shapes,
+                          world->max_active_shapes, s, "Active shapes");
+        } else if (!want && s->active_index) {
+                ARRAY_REMOVE(world->active_shapes, world->num_active_shapes, s);
+        }
+}
+
+void
+world_shape_removed(Shape *s)
+{
+        if (s->active_index)
+                ARRAY_REMOVE(s->body->world->active_shapes,
+                             s->body->world->num_active_shapes, s);
+}
 
-unsigned        g_num_active_shapes;
-Shape           **g_active_shapes;
+static void
+group_changed(Body *b, Group *group)
+{
+        Shape *s;
+        DL_FOREACH(b->shapes, s) {
+                if (s->group == group)
+                        world_shape_changed(s);
+        }
+        
+        Body *child;
+        DL_FOREACH(b->children, child) {
+                group_changed(child, group);
+        }
+}
 
-#if !ALL_NOCTURNAL && ENABLE_TILE_GRID
+/*
+ * Call when group gets its first collision handler or loses its last one.
+ * Handler registration is rare, so just walk the body tree.
+ */
+void
+world_group_changed(World *world, Group *group)
+{
+        group_changed(&world->static_body, group);
+        
+        extern Camera *cam_list;
+        Camera *cam;
+        DL_FOREACH(cam_list, cam) {
+                if (cam->body.world == world)
+                        group_changed(&cam->body, group);
+        }
+}
+
+/*
+ * World being stepped, so smart_filter() can access its step arrays.
+ */
+static World *g_step_world;
+
+static void
+step_add_body(World *world, Body *b)
+{
+        ARRAY_RESERVE(world->step_bodies, world->max_step_bodies,
+                      world->num_step_bodies + 1, "Step bodies");
+        world->step_bodies[world->num_step_bodies++] = b;
+}
 
+static void
+step_add_shape(World *world, Shape *s)
+{
+        ARRAY_RESERVE(world->step_shapes, world->max_step_shapes,
+                      world->num_step_shapes + 1, "Step shapes");
+        world->step_shapes[world->num_step_shapes++] = s;
+}
+
+/*
+ * Grid filter that puts bodies and shapes found near cameras into activity
+ * arrays. Works with shapes alone; tiles are found too if the tile grid is
+ * enabled.
+ */
 static int
 smart_filter(void *ptr)
 {
         /*
-         * Ignore nocturnal bodies and their shapes (added later).
-         * Ignore paused bodies.
+         * Ignore bodies from the nocturnal list and their shapes (added
+         * later). Ignore paused bodies.
          */
         Shape *s = ptr;
         Body *b = s->body;      /* Same offset for Shape and Tile. */
-        if ((b->flags & BODY_NOCTURNAL) || !body_active(b))
+        if (body_nocturnal(b) || !body_active(b))
                 return 0;
         
         /*
-         * Add bodies to array that:
-         *   - are not the static body or a camera (parent != NULL);
-         *   - have not yet been added (VISITED flag not set);
+         * Add body and its ancestors (they carry it around) to array, unless
+         * they are the static body or a camera (parent == NULL), or have
+         * already been added (VISITED flag set).
          */
-        if (b->parent != NULL && !(b->flags & BODY_VISITED)) {
-                assert(g_num_active_bodies < ACTIVE_BODIES_MAX);
-                g_active_bodies[g_num_active_bodies++] = b;
-                b->flags |= BODY_VISITED;
+        for (Body *a = b; a->parent != NULL; a = a->parent) {
+                if (a->flags & BODY_VISITED)
+                        break;
+                if (!body_active(a) || body_nocturnal(a))
+                        continue;
+                step_add_body(g_step_world, a);
+                a->flags |= BODY_VISITED;
         }
         
         /*
@@ -523,47 +771,81 @@ smart_filter(void *ptr)
          */
         if (s->objtype == OBJTYPE_SHAPE) {
                 if (!(s->flags & SHAPE_VISITED) && s->group->num_handlers > 0) {
-                        assert(g_num_active_shapes < ACTIVE_SHAPES_MAX);
-                        g_active_shapes[g_num_active_shapes++] = s;
+                        step_add_shape(g_step_world, s);
                         s->flags |= SHAPE_VISITED;
                 }
         }
         return 0;
 }
-#else   /* !ALL_NOCTURNAL && ENABLE_TILE_GRID */
 
+/*
+ * Fill step arrays with bodies and shapes within camera vicinity, plus
+ * everything on the nocturnal list.
+ */
 static void
-dumb_add_all(Body *b)
+vicinity_add(World *world)
 {
-        /* Ignore shapes of paused bodies. */
-        if (body_active(b)) {
-                Shape *s;
-                DL_FOREACH(b->shapes, s) {
-                        if (s->group->num_handlers == 0)
-                                continue;
-                        assert(g_num_active_shapes < ACTIVE_SHAPES_MAX);
-                        g_active_shapes[g_num_active_shapes++] = s;
+        /* Let bodies whose wake-up period is over go back to sleep. */
+        Body *noc, *noc_tmp;
+        for (noc = world->nocturnal; noc != NULL; noc = noc_tmp) {
+                noc_tmp = noc->nocturnal_next;
+                if (noc->wake_step != 0 && noc->wake_step <= noc->step) {
+                        noc->wake_step = 0;
+                        body_update_nocturnal(noc);
                 }
         }
-
+        
         /*
-         * Add children to `active_bodies` and descend further down the body
-         * hierarchy.
+         * Get shapes and bodies within camera vicinity.
          */
-        Body *child;
-        DL_FOREACH(b->children, child) {
-                if (body_active(child)) {
-                        assert(g_num_active_bodies < ACTIVE_BODIES_MAX);
-                        g_active_bodies[g_num_active_bodies++] = child;
-                }
+        extern Camera *cam_list;
+        Camera *cam;
+        g_step_world = world;
+        DL_FOREACH(cam_list, cam) {
+                if (cam->body.world != world)
+                        continue;       /* Camera not inside this world. */
                 
-                /* Recursive descent. */
-                dumb_add_all(child);
+                vect_f cam_pos = body_pos(&cam->body);
+                vect_f vicinity = {
+                        cam->size.x * config.cam_vicinity_factor,
+                        cam->size.y * config.cam_vicinity_factor
+                };
+                BB activity_bb = {
+                        .l=cam_pos.x - cam->size.x/2 - vicinity.x,
+                        .r=cam_pos.x + cam->size.x/2 + vicinity.x,
+                        .b=cam_pos.y - cam->size.y/2 - vicinity.y,
+                        .t=cam_pos.y + cam->size.y/2 + vicinity.y
+                };
+                grid_lookup(&world->grid, activity_bb, NULL, 0, smart_filter);
+        }
+                
+        /*
+         * Unset VISITED flag for both bodies and shapes.
+         */
+        for (unsigned i = 0; i < world->num_step_bodies; i++) {
+                world->step_bodies[i]->flags &= ~BODY_VISITED;
+        }
+        for (unsigned i = 0; i < world->num_step_shapes; i++) {
+                world->step_shapes[i]->flags &= ~SHAPE_VISITED;
+        }
+        
+        /* Process nocturnal bodies. */
+        for (noc = world->nocturnal; noc != NULL; noc = noc->nocturnal_next) {
+                if (!body_active(noc))
+                        continue;       /* Ignore paused bodies. */
+                
+                /* Add body to `step_bodies`. */
+                step_add_body(world, noc);
+                
+                /* Add shapes to `step_shapes`. */
+                Shape *s;
+                DL_FOREACH(noc->shapes, s) {
+                        if (s->group->num_handlers > 0)
+                                step_add_shape(world, s);
+                }
         }
 }
 
-#endif  /* ALL_NOCTURNAL || !ENABLE_TILE_GRID */
-
 #ifndef NDEBUG
 /*
  * Unset intersect flag for all shapes that belong to body and do it recursively
@@ -584,6 +866,116 @@ unset_intersect_flag(Body *b)
 }
 #endif  /* NDEBUG */
 
+/*
+ * Set (or, if both `bounds` and `cam` are NULL, remove) the area that
+ * transient bodies must stay within.
+ *
+ * bounds       Fixed area in world coordinates.
+ * cam          Camera whose visible area is used instead of `bounds`.
+ * margin       How far outside the area a body may go before it is culled.
+ * recycle      If true, culled bodies are recycled (body_recycle()) instead of
+ *              destroyed.
+ * func         Lua function to receive an array of culled bodies once per step
+ *              (zero if none).
+ * cb_data      User argument ID for `func`.
+ */
+void
+world_set_bounds(World *world, const BB *bounds, Camera *cam, int margin,
+                 int recycle, intptr_t func, intptr_t cb_data)
+{
+        assert(cam == NULL || cam->body.world == world);
+        world->bounds_on = (bounds != NULL || cam != NULL);
+        world->bounds = (bounds != NULL) ? *bounds : (BB){0, 0, 0, 0};
+        world->bounds_cam = cam;
+        world->bounds_margin = margin;
+        world->bounds_recycle = recycle;
+        world->bounds_func = func;
+        world->bounds_cb_data = cb_data;
+}
+
+/*
+ * Destroy or recycle transient bodies that are outside world bounds, then tell
+ * Lua about them with a single call.
+ */
+static void
+cull_transient(World *world, lua_State *L)
+{
+        if (!world->bounds_on || world->transient == NULL)
+                return;
+        
+        /* Figure out area, either fixed or camera's current view. */
+        BB area = world->bounds;
+        Camera *cam = world->bounds_cam;
+        if (cam != NULL) {
+                vect_f pos = body_pos(&cam->body);
+                float half_w = cam->size.x / cam->zoom / 2;
+                float half_h = cam->size.y / cam->zoom / 2;
+                area = (BB){
+                        .l=floorf(pos.x - half_w), .r=ceilf(pos.x + half_w),
+                        .b=floorf(pos.y - half_h), .t=ceilf(pos.y + half_h)
+                };
+        }
+        area.l -= world->bounds_margin;
+        area.r += world->bounds_margin;
+        area.b -= world->bounds_margin;
+        area.t += world->bounds_margin;
+        
+        /*
+         * Collect bodies first: destroying them changes the list. A body that
+         * has no extent (no shapes) is outside if its position is.
+         */
+        unsigned num_culled = 0;
+        for (Body *b = world->transient; b != NULL; b = b->transient_next) {
+                if (!body_active(b))
+                        continue;       /* Ignore paused bodies. */
+                BB bb = body_world_bb(b);
+                if (bb.l == bb.r) {
+                        bb.l--;
+                        bb.r++;
+                }
+                if (bb.b == bb.t) {
+                        bb.b--;
+                        bb.t++;
+                }
+                if (bb_overlap(&bb, &area))
+                        continue;
+                ARRAY_RESERVE(world->culled, world->max_culled, num_culled + 1,
+                              "Culled bodies");
+                world->culled[num_culled++] = b->handle;
+        }
+        if (num_culled == 0)
+                return;
+        
+        /*
+         * Culling a body also removes its transient descendants, so skip those
+         * that are gone already.
+         */
+        for (unsigned i = 0; i < num_culled; i++) {
+                Body *b = handle_get(world->culled[i]);
+                if (b == NULL)
+                        continue;
+                if (world->bounds_recycle)
+                        body_recycle(b);
+                else
+                        body_free(b);
+        }
+#if ENABLE_LUA
+        /* Notify: func({body, ...}, args...). Bodies are no longer valid. */
+        if (world->bounds_func != 0) {
+                L_callback_push(L, world->bounds_func);         /* + func */
+                lua_createtable(L, num_culled, 0);              /* + array */
+                for (unsigned i = 0; i < num_culled; i++) {
+                        lua_pushlightuserdata(L, (void *)world->culled[i]);
+                        lua_rawseti(L, -2, i + 1);
+                }
+                L_callback_call(L, world->bounds_func, world->bounds_cb_data,
+                                0, 1, 0);
+        }
+#else
+        UNUSED(L);
+#endif
+}
+
 /*
  * Perform one world step.
  *
@@ -598,99 +990,67 @@ world_step(World *world, lua_State *L)
         if (world->paused)
                 return;         /* Do nothing if world is paused. */
         
-        /*
-         * Put body/shape array pointers in global variables so smart_filter()
-         * can access them.
-         */
-        extern Camera *cam_list;
-        Camera *cam;
-        Body  *active_bodies[ACTIVE_BODIES_MAX];
-        Shape *active_shapes[ACTIVE_SHAPES_MAX];
-        g_active_bodies = active_bodies;
-        g_active_shapes = active_shapes;
-        g_num_active_bodies = 0;
-        g_num_active_shapes = 0;
-#if !ALL_NOCTURNAL && ENABLE_TILE_GRID
-        /*
-         * Get shapes and bodies within camera vicinity.
-         */
-        DL_FOREACH(cam_list, cam) {
-                if (cam->body.world != world)
-                        continue;       /* Camera not inside this world. */
-                
-                vect_f cam_pos = body_pos(&cam->body);
-                vect_f vicinity = {
-                        cam->size.x * config.cam_vicinity_factor,
-                        cam->size.y * config.cam_vicinity_factor
-                };
-                BB activity_bb = {
-                        .l=cam_pos.x - cam->size.x/2 - vicinity.x,
-                        .r=cam_pos.x + cam->size.x/2 + vicinity.x,
-                        .b=cam_pos.y - cam->size.y/2 - vicinity.y,
-                        .t=cam_pos.y + cam->size.y/2 + vicinity.y
-                };
-                grid_lookup(&world->grid, activity_bb, NULL, 0, smart_filter);
-        }
-                
-        /*
-         * Unset VISITED flag for both bodies and shapes.
-         */
-        unsigned num_bodies = g_num_active_bodies;
-        for (unsigned i = 0; i < num_bodies; i++) {
-                active_bodies[i]->flags &= ~BODY_VISITED;
-        }
-        unsigned num_shapes = g_num_active_shapes;
-        for (unsigned i = 0; i < num_shapes; i++) {
-                active_shapes[i]->flags &= ~SHAPE_VISITED;
-        }
+        /* Memory freed during previous steps may now be reused. */
+        mem_advance_epoch();
         
-        /* Process nocturnal bodies. */
-        for (Body *noc = world->nocturnal; noc != NULL;
-             noc = noc->nocturnal_next) {
-                if (!body_active(noc))
-                        continue;       /* Ignore paused bodies. */
-                
-                /* Add body to `active_bodies`. */
-                assert(num_bodies < ARRAYSZ(active_bodies));
-                active_bodies[num_bodies++] = noc;
-                
-                /* Add shapes to `active_shapes`. */
-                Shape *s;
-                DL_FOREACH(noc->shapes, s) {
-                        if (s->group->num_handlers > 0) {
-                                assert(num_shapes < ARRAYSZ(active_shapes));
-                                active_shapes[num_shapes++] = s;
-                        }
-                }
-        }        
-#else   /* !ALL_NOCTURNAL && ENABLE_TILE_GRID */
-        /*
-         * Since all bodies are nocturnal, add all shapes and bodies to
-         * activity arrays.
-         */
-        dumb_add_all(&world->static_body);
-        DL_FOREACH(cam_list, cam) {
-                if (cam->body.world != world)
-                        continue;       /* Camera not inside this world. */
-                dumb_add_all(&cam->body);
+        world->num_step_bodies = 0;
+        world->num_step_shapes = 0;
+        if (world->allow_sleep) {
+                /* Only bodies near cameras (and nocturnal ones) are active. */
+                vicinity_add(world);
+        } else {
+                /*
+                 * Sleeping is disabled, so take a copy of the active sets.
+                 * Objects may be created and destroyed while the step runs.
+                 */
+                unsigned nb = world->num_active_bodies;
+                unsigned ns = world->num_active_shapes;
+                ARRAY_RESERVE(world->step_bodies, world->max_step_bodies, nb,
+                              "Step bodies");
+                ARRAY_RESERVE(world->step_shapes, world->max_step_shapes, ns,
+                              "Step shapes");
+                memcpy(world->step_bodies, world->active_bodies,
+                       nb * sizeof(Body *));
+                memcpy(world->step_shapes, world->active_shapes,
+                       ns * sizeof(Shape *));
+                world->num_step_bodies = nb;
+                world->num_step_shapes = ns;
         }
-        unsigned num_bodies = g_num_active_bodies;
-        unsigned num_shapes = g_num_active_shapes;
-#endif  /* ALL_NOCTURNAL || !ENABLE_TILE_GRID */
+        Body **active_bodies = world->step_bodies;
+        Shape **active_shapes = world->step_shapes;
+        unsigned num_bodies = world->num_step_bodies;
+        unsigned num_shapes = world->num_step_shapes;
         
         /* Remember state before continuing with the step. */
         save_state(world, active_bodies, num_bodies);
                 
         /* Execute step functions and timers. */
         step_bodies(world, active_bodies, num_bodies, L, body_step);
+        if (world->killme)
+                return;         /* World destroyed by a script. */
         run_timers(world, active_bodies, num_bodies, L);
+        if (world->killme)
+                return;
 #ifndef NDEBUG
         /* Unset INTERSECT flag from prevous step. */
         unset_intersect_flag(&world->static_body);
 #endif
-        /* Now that body positions have possibly changed, resolve collisions. */
+        /*
+         * Body positions have possibly changed: invalidate cached shape boxes
+         * (zero means "invalid", so skip it on wrap-around) and resolve
+         * collisions.
+         */
+        if (++world->bb_stamp == 0)
+                world->bb_stamp = 1;
         resolve_collisions(world, active_shapes, num_shapes, L);
+        if (world->killme)
+                return;
         
         /* Call after-step functions. */
         step_bodies(world, active_bodies, num_bodies, L, body_afterstep);
+        if (world->killme)
+                return;
+        
+        /* Get rid of transient bodies that have left world bounds. */
+        cull_transient(world, L);
 }
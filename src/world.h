@@ -6,6 +6,7 @@
 #include "common.h"
 #include "shape.h"
 #include "grid.h"
+#include "mem.h"
 
 /*
  * World struct describes a physical world instance.
@@ -23,9 +24,45 @@ typedef struct World_t {
         unsigned trace_skip;
               
         Body     static_body;    /* Topmost body that does not move. */
+        
+        /*
+         * If `allow_sleep` is true, only bodies within camera vicinity and
+         * those in `nocturnal` list are stepped. Otherwise all bodies are.
+         */
+        int      allow_sleep;
         Body     *nocturnal;     /* List of bodies that never sleep. */
+        
+        /*
+         * Transient bodies are destroyed (or recycled) at the end of a step
+         * if they are outside `bounds` grown by `bounds_margin` (see
+         * world_set_bounds()). If `bounds_cam` is set, bounds follow its view.
+         * Lua function `bounds_func` then receives an array of culled bodies.
+         */
+        Body     *transient;
+        int      bounds_on;
+        BB       bounds;
+        struct Camera_t *bounds_cam;
+        int      bounds_margin;
+        int      bounds_recycle;
+        intptr_t bounds_func, bounds_cb_data;
+        Handle   *culled;        /* Scratch array used while culling. */
+        unsigned max_culled;
+        
+        /*
+         * Incremented once per step after step functions and timers have run.
+         * Shapes cache their world bounding boxes against this value.
+         */
+        unsigned bb_stamp;
 
         Grid     grid;           /* Spatial partitioning structure. */
+        
+        /*
+         * World's own memory pools (arena). Bodies, tiles, shapes, timers,
+         * and collisions of this world live here, so that world_kill() does
+         * not have to free them one by one: world_free() drops the pools
+         * whole.
+         */
+        mem_pool body_pool, tile_pool, shape_pool, timer_pool, collision_pool;
                 
         unsigned next_group_id;  /* Consecutive IDs for collision groups. */
         Group    *groups;        /* Collision group hash. */
@@ -35,15 +72,43 @@ typedef struct World_t {
         
         /* Ongoing collisions. */
         Collision *collisions;
+        
+        /*
+         * Bodies (except static and camera bodies) that are not paused, and
+         * shapes of such bodies that have collision handlers. These dense
+         * arrays are kept up to date as objects are created, destroyed,
+         * paused, and resumed, so world_step() does not have to walk the body
+         * tree when sleeping is off.
+         */
+        Body     **active_bodies;
+        unsigned num_active_bodies, max_active_bodies;
+        Shape    **active_shapes;
+        unsigned num_active_shapes, max_active_shapes;
+        
+        /* What is actually processed during a step (grown as necessary). */
+        Body     **step_bodies;
+        unsigned num_step_bodies, max_step_bodies;
+        Shape    **step_shapes;
+        unsigned num_step_shapes, max_step_shapes;
 
         int     killme;         /* If true, world should be freed as soon
                                    as possible. */
 } World;
 
 World   *world_new(const char *name, unsigned step_ms, BB grid_area,
-                   unsigned cell_size, unsigned trace_skip);
+                   unsigned cell_size, unsigned trace_skip, unsigned pool_hint);
 void     world_free(World *world);
 void     world_kill(World *world);
 void     world_step(World *world, lua_State *L);
+void     world_set_bounds(World *world, const BB *bounds,
+                          struct Camera_t *cam, int margin, int recycle,
+                          intptr_t func, intptr_t cb_data);
+
+/* Active set maintenance. */
+void     world_body_changed(Body *b);
+void     world_body_removed(Body *b);
+void     world_shape_changed(Shape *s);
+void     world_shape_removed(Shape *s);
+void     world_group_changed(World *world, Group *group);
 
 #endif